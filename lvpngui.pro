@@ -17,9 +17,33 @@ SOURCES += \
     src/installergui.cpp \
     src/main.cpp \
     src/vpngui.cpp \
+    src/vpncore.cpp \
+    src/vpndaemon.cpp \
+    src/controlserver.cpp \
+    src/controlclient.cpp \
+    src/reconnector.cpp \
+    src/netwatch.cpp \
+    src/protocolprobe.cpp \
+    src/dohresolver.cpp \
+    src/dnscache.cpp \
+    src/mtuprobe.cpp \
+    src/cipherbench.cpp \
+    src/compressionpolicy.cpp \
+    src/addressfamilies.cpp \
+    src/sockettuning.cpp \
+    src/loopbackbench.cpp \
+    src/tunnelmanager.cpp \
+    src/statuspoller.cpp \
+    src/statussnapshot.cpp \
+    src/logstore.cpp \
+    src/logentry.cpp \
+    src/logexport.cpp \
+    src/diagnostics.cpp \
     src/installer.cpp \
     src/openvpn.cpp \
+    src/openvpnio.cpp \
     src/pwstore.cpp \
+    src/securebuffer.cpp \
     src/authdialog.cpp \
     src/logwindow.cpp \
     src/settingswindow.cpp
@@ -27,10 +51,35 @@ SOURCES += \
 HEADERS  += \
     src/installergui.h \
     src/vpngui.h \
+    src/vpncore.h \
+    src/vpndaemon.h \
+    src/controlserver.h \
+    src/controlclient.h \
+    src/reconnector.h \
+    src/netwatch.h \
+    src/protocolprobe.h \
+    src/dohresolver.h \
+    src/dnscache.h \
+    src/mtuprobe.h \
+    src/cipherbench.h \
+    src/compressionpolicy.h \
+    src/addressfamilies.h \
+    src/sockettuning.h \
+    src/loopbackbench.h \
+    src/tunnelmanager.h \
+    src/statuspoller.h \
+    src/statussnapshot.h \
+    src/logstore.h \
+    src/logentry.h \
+    src/logexport.h \
+    src/diagnostics.h \
     src/installer.h \
     src/config.h \
     src/openvpn.h \
+    src/openvpnio.h \
+    src/spscqueue.h \
     src/pwstore.h \
+    src/securebuffer.h \
     src/authdialog.h \
     src/logwindow.h \
     src/settingswindow.h \
@@ -67,7 +116,7 @@ PRE_TARGETDEPS += CHANGELOG.html
 
 win32 {
     RC_FILE = lvpngui.rc
-    LIBS += -lole32 -lshell32 -luuid
+    LIBS += -lole32 -lshell32 -luuid -liphlpapi
 
     WIN_PWD = $$replace(PWD, /, \\)
     OUT_PWD_WIN = $$replace(OUT_PWD, /, \\)
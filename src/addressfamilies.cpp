@@ -0,0 +1,64 @@
+#include "addressfamilies.h"
+
+#include <algorithm>
+#include <random>
+
+static QString familyName(QAbstractSocket::NetworkLayerProtocol family) {
+    return family == QAbstractSocket::IPv6Protocol ? "ipv6" : "ipv4";
+}
+
+AddressFamilies::AddressFamilies(QSettings &settings)
+    : m_settings(settings)
+{}
+
+bool AddressFamilies::preferIPv6() const {
+    // Laplace smoothing, no data is a tie
+    double rate[2];
+    QStringList families;
+    families << "ipv4" << "ipv6";
+    for (int i=0; i<2; ++i) {
+        double ok = m_settings.value("address_stats/" + families[i] + "_ok", 0).toDouble();
+        double failed = m_settings.value("address_stats/" + families[i] + "_failed", 0).toDouble();
+        rate[i] = (ok + 1) / (ok + failed + 2);
+    }
+    return rate[1] >= rate[0];
+}
+
+void AddressFamilies::record(QAbstractSocket::NetworkLayerProtocol family, bool ok) {
+    QString prefix("address_stats/" + familyName(family));
+    int okCount = m_settings.value(prefix + "_ok", 0).toInt();
+    int failedCount = m_settings.value(prefix + "_failed", 0).toInt();
+    if (ok) {
+        okCount++;
+    } else {
+        failedCount++;
+    }
+
+    // Recent history matters more
+    if (okCount + failedCount > MaxStats) {
+        okCount /= 2;
+        failedCount /= 2;
+    }
+    m_settings.setValue(prefix + "_ok", okCount);
+    m_settings.setValue(prefix + "_failed", failedCount);
+}
+
+QStringList AddressFamilies::interleave(QStringList v4, QStringList v6, bool preferIPv6) {
+    std::mt19937 rng((std::random_device())());
+    std::shuffle(v4.begin(), v4.end(), rng);
+    std::shuffle(v6.begin(), v6.end(), rng);
+
+    const QStringList &first = preferIPv6 ? v6 : v4;
+    const QStringList &second = preferIPv6 ? v4 : v6;
+
+    QStringList addresses;
+    for (int i=0; i<qMax(first.size(), second.size()); ++i) {
+        if (i < first.size()) {
+            addresses.append(first[i]);
+        }
+        if (i < second.size()) {
+            addresses.append(second[i]);
+        }
+    }
+    return addresses;
+}
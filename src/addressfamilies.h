@@ -0,0 +1,39 @@
+#ifndef ADDRESSFAMILIES_H
+#define ADDRESSFAMILIES_H
+
+#include <QAbstractSocket>
+#include <QSettings>
+#include <QStringList>
+
+/*
+ * Order of a gateway's remotes, for gateways with IPv4 and IPv6.
+ *
+ * The families alternate (RFC 8305 section 4), starting with the one that
+ * worked best: every connect records whether openvpn got through on the
+ * family tried first, or fell back to the other one. IPv6 goes first as
+ * long as it does as well as IPv4. Only the last MaxStats attempts or so
+ * count, networks change.
+ *
+ * Settings: address_stats/ipv4_ok, ipv4_failed, ipv6_ok, ipv6_failed
+ */
+class AddressFamilies
+{
+public:
+    enum {
+        MaxStats = 50,
+    };
+
+    explicit AddressFamilies(QSettings &settings);
+
+    bool preferIPv6() const;
+    void record(QAbstractSocket::NetworkLayerProtocol family, bool ok);
+
+    // Shuffled within a family (instead of remote-random, which would
+    // undo the interleaving), preferred family first
+    static QStringList interleave(QStringList v4, QStringList v6, bool preferIPv6);
+
+private:
+    QSettings &m_settings;
+};
+
+#endif // ADDRESSFAMILIES_H
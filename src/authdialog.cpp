@@ -2,6 +2,8 @@
 #include "ui_authdialog.h"
 #include "vpngui.h"
 
+#include <QLineEdit>
+
 AuthDialog::AuthDialog(QWidget *parent, const VPNGUI &vpngui)
     : QDialog(parent)
     , ui(new Ui::AuthDialog)
@@ -14,12 +16,32 @@ AuthDialog::~AuthDialog() {
     delete ui;
 }
 
-QString AuthDialog::getUsername() const {
-    return ui->usernameInput->text();
+// text() shares the QLineEdit's own buffer, which takeString() can't wipe
+// (it only wipes unshared data). Overwrite that buffer in place with
+// filler of the same length, so the field always holds a valid string,
+// then clear the field.
+static SecureBuffer takeInput(QLineEdit *input) {
+    QString text(input->text());
+    SecureBuffer b(SecureBuffer::takeString(text));
+
+    QString shared(input->text());
+    if (!shared.isEmpty() && !shared.data_ptr()->ref.isStatic()) {
+        QChar *c = const_cast<QChar *>(shared.constData());
+        for (int i=0; i<shared.size(); ++i) {
+            c[i] = QLatin1Char('*');
+        }
+    }
+    shared.clear();
+    input->clear();
+    return b;
+}
+
+SecureBuffer AuthDialog::takeUsername() {
+    return takeInput(ui->usernameInput);
 }
 
-QString AuthDialog::getPassword() const {
-    return ui->passwordInput->text();
+SecureBuffer AuthDialog::takePassword() {
+    return takeInput(ui->passwordInput);
 }
 
 bool AuthDialog::getRemember() const {
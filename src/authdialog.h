@@ -3,6 +3,8 @@
 
 #include <QDialog>
 
+#include "securebuffer.h"
+
 class VPNGUI;
 
 namespace Ui {
@@ -17,8 +19,9 @@ public:
     explicit AuthDialog(QWidget *parent, const VPNGUI &vpngui);
     ~AuthDialog();
 
-    QString getUsername() const;
-    QString getPassword() const;
+    // Take the input out of the dialog and wipe it
+    SecureBuffer takeUsername();
+    SecureBuffer takePassword();
     bool getRemember() const;
 
 private:
@@ -0,0 +1,113 @@
+#include "cipherbench.h"
+
+#include <algorithm>
+#include <cstring>
+#include <QElapsedTimer>
+#include <QSysInfo>
+#include <QThread>
+#include <QDebug>
+
+#include <cryptopp/config.h>
+#include <cryptopp/cpu.h>
+#include <cryptopp/aes.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/secblock.h>
+#if CRYPTOPP_VERSION >= 810
+#include <cryptopp/chachapoly.h>
+#endif
+
+// Encrypt PacketSize packets, each with its own IV like OpenVPN does
+static double measure(CryptoPP::AuthenticatedSymmetricCipher &enc, int keyLength, int duration) {
+    CryptoPP::SecByteBlock key(keyLength);
+    memset(key.data(), 0x42, key.size());
+    byte iv[12] = {0};
+    enc.SetKeyWithIV(key, key.size(), iv, sizeof(iv));
+
+    CryptoPP::SecByteBlock in(CipherBenchmark::PacketSize);
+    CryptoPP::SecByteBlock out(CipherBenchmark::PacketSize);
+    memset(in.data(), 0x17, in.size());
+    byte tag[16];
+    byte aad[8] = {0};
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 bytes = 0;
+    quint32 counter = 0;
+    while (timer.elapsed() < duration) {
+        for (int i=0; i<64; ++i) {
+            counter++;
+            memcpy(iv + 8, &counter, sizeof(counter));
+            enc.EncryptAndAuthenticate(out, tag, sizeof(tag), iv, sizeof(iv),
+                                       aad, sizeof(aad), in, in.size());
+            bytes += in.size();
+        }
+    }
+
+    qint64 ms = qMax<qint64>(timer.elapsed(), 1);
+    return bytes / 1000.0 / ms;
+}
+
+CipherBenchmark::CipherBenchmark()
+    : QObject(nullptr)
+{}
+
+QList<CipherBenchmark::Result> CipherBenchmark::run(int duration) {
+    QList<Result> results;
+    Result r;
+
+    CryptoPP::GCM<CryptoPP::AES>::Encryption aes128;
+    r.cipher = "AES-128-GCM";
+    r.mbPerSecond = measure(aes128, 16, duration);
+    results << r;
+
+    CryptoPP::GCM<CryptoPP::AES>::Encryption aes256;
+    r.cipher = "AES-256-GCM";
+    r.mbPerSecond = measure(aes256, 32, duration);
+    results << r;
+
+#if CRYPTOPP_VERSION >= 810
+    CryptoPP::ChaCha20Poly1305::Encryption chacha;
+    r.cipher = "CHACHA20-POLY1305";
+    r.mbPerSecond = measure(chacha, 32, duration);
+    results << r;
+#endif
+
+    std::stable_sort(results.begin(), results.end(), [](const Result &a, const Result &b) {
+        return a.mbPerSecond > b.mbPerSecond;
+    });
+
+    foreach (const Result &result, results) {
+        qDebug() << "Cipher benchmark:" << result.cipher << result.mbPerSecond << "MB/s";
+    }
+    return results;
+}
+
+QString CipherBenchmark::cacheKey() {
+    QStringList parts;
+    parts << QSysInfo::currentCpuArchitecture();
+#if CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X32 || CRYPTOPP_BOOL_X64
+    parts << (CryptoPP::HasAESNI() ? "aesni" : "noaesni");
+    parts << (CryptoPP::HasCLMUL() ? "clmul" : "noclmul");
+#endif
+    parts << QString("cryptopp%1").arg(CRYPTOPP_VERSION);
+    return parts.join('-');
+}
+
+void CipherBenchmark::start() {
+    QThread *thread = new QThread;
+    moveToThread(thread);
+
+    connect(thread, SIGNAL(started()), this, SLOT(runThreaded()));
+    connect(thread, SIGNAL(finished()), this, SLOT(deleteLater()));
+    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+    thread->start(QThread::LowPriority);
+}
+
+void CipherBenchmark::runThreaded() {
+    QStringList order;
+    foreach (const Result &r, run()) {
+        order.append(r.cipher);
+    }
+    emit finished(order);
+    thread()->quit();
+}
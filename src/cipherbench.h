@@ -0,0 +1,51 @@
+#ifndef CIPHERBENCH_H
+#define CIPHERBENCH_H
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/*
+ * Throughput of the OpenVPN data channel ciphers on this CPU, measured
+ * with Crypto++ on VPN sized packets. Without AES-NI, AES-128 is much
+ * faster than AES-256 and ChaCha20-Poly1305 beats both.
+ * A proxy: openvpn itself uses OpenSSL, whose numbers differ, but both
+ * depend on the same CPU features.
+ *
+ * A few hundred ms: run() on a worker thread with start(). The result
+ * only depends on the CPU features, cache it under cacheKey().
+ */
+class CipherBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        PacketSize = 1400,
+        Duration = 200,     // ms per cipher
+    };
+
+    struct Result {
+        QString cipher;     // OpenVPN name
+        double mbPerSecond;
+    };
+
+    CipherBenchmark();
+
+    // Fastest first
+    static QList<Result> run(int duration = Duration);
+    static QString cacheKey();
+
+    // run() on a new thread, finished() is emitted on the thread that
+    // called start() and the benchmark deletes itself after that.
+    void start();
+
+signals:
+    // Cipher names, fastest first
+    void finished(const QStringList &order);
+
+private slots:
+    void runThreaded();
+};
+
+#endif // CIPHERBENCH_H
@@ -0,0 +1,85 @@
+#include "compressionpolicy.h"
+#include "config.h"
+
+#include <QDateTime>
+#include <QDebug>
+
+static QString key(const QString &hostname, const QString &name) {
+    return "compression/" + hostname + "/" + name;
+}
+
+CompressionPolicy::CompressionPolicy(QSettings &settings)
+    : m_settings(settings)
+{}
+
+bool CompressionPolicy::isMeasured(const QString &hostname) const {
+    if (!VpnFeatures::compression) {
+        return false;
+    }
+
+    QDateTime lowSavingAt(m_settings.value(key(hostname, "low_saving_at")).toDateTime());
+    return !lowSavingAt.isValid()
+        || lowSavingAt.addDays(RetryDays) < QDateTime::currentDateTimeUtc();
+}
+
+void CompressionPolicy::track(const QString &hostname) {
+    if (!isMeasured(hostname)) {
+        m_baselines.remove(hostname);
+        return;
+    }
+
+    Sample s;
+    s.raw = -1;
+    s.compressed = -1;
+    m_baselines[hostname] = s;
+}
+
+double CompressionPolicy::saving(const QString &hostname) const {
+    QString ratioKey(key(hostname, "ratio"));
+    if (!m_settings.contains(ratioKey)) {
+        return -1;
+    }
+    return (1 - m_settings.value(ratioKey).toDouble()) * 100;
+}
+
+bool CompressionPolicy::update(const QString &hostname, const StatusSnapshot &s) {
+    if (!m_baselines.contains(hostname) || !s.valid) {
+        return false;
+    }
+    Sample &base = m_baselines[hostname];
+
+    // Outgoing: pre-compress is raw. Incoming: post-decompress is raw.
+    qint64 raw = s.preCompress + s.postDecompress;
+    qint64 compressed = s.postCompress + s.preDecompress;
+
+    // First measure, or counters restarted with a new connection
+    if (base.raw < 0 || raw < base.raw) {
+        base.raw = raw;
+        base.compressed = compressed;
+        return false;
+    }
+    if (raw - base.raw < SampleBytes) {
+        return false;
+    }
+
+    double ratio = double(compressed - base.compressed) / double(raw - base.raw);
+    base.raw = raw;
+    base.compressed = compressed;
+
+    QString ratioKey(key(hostname, "ratio"));
+    if (m_settings.contains(ratioKey)) {
+        ratio = (m_settings.value(ratioKey).toDouble() + ratio) / 2;
+    }
+
+    m_settings.setValue(ratioKey, ratio);
+    double saving = (1 - ratio) * 100;
+    if (saving >= MinSavingPercent) {
+        return false;
+    }
+
+    // Incompressible (already compressed or encrypted traffic)
+    qDebug() << "Compression: low saving for" << hostname << saving << "%";
+    m_settings.setValue(key(hostname, "low_saving_at"), QDateTime::currentDateTimeUtc());
+    m_baselines.remove(hostname);
+    return true;
+}
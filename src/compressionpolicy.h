@@ -0,0 +1,62 @@
+#ifndef COMPRESSIONPOLICY_H
+#define COMPRESSIONPOLICY_H
+
+#include <QMap>
+#include <QSettings>
+#include <QString>
+
+#include "statussnapshot.h"
+
+/*
+ * What LZO compression saves, per gateway.
+ *
+ * The client can't turn compression off on its own: with "comp-lzo no" (or
+ * a bare "compress") openvpn 2.4 uses the compression stub, which drops
+ * every packet the server still compresses. So the config has
+ * "compress lzo" whenever the provider supports it. LZO is adaptive and
+ * stops trying for a while on traffic that doesn't compress, which is
+ * most of the CPU there is to save on our side.
+ *
+ * While a tunnel is measured, the compressed/raw ratio of the traffic (both
+ * directions, from the status counters) is sampled every SampleBytes and
+ * smoothed over time. If compression saves less than MinSavingPercent,
+ * update() says so once, for the log (turning it off is up to the
+ * gateway), and that gateway isn't measured again for RetryDays.
+ *
+ * Settings: compression/<hostname>/ratio, compression/<hostname>/low_saving_at
+ */
+class CompressionPolicy
+{
+public:
+    enum {
+        SampleBytes = 4 * 1024 * 1024,
+        MinSavingPercent = 5,
+        RetryDays = 7,
+    };
+
+    explicit CompressionPolicy(QSettings &settings);
+
+    bool isMeasured(const QString &hostname) const;
+
+    // For a new connection using compression: measure it if due
+    void track(const QString &hostname);
+
+    // Cumulative counters of a connected tunnel, true if compression was
+    // just found not to pay off
+    bool update(const QString &hostname, const StatusSnapshot &s);
+
+    // Smoothed saving in percent, -1 if never measured
+    double saving(const QString &hostname) const;
+
+private:
+    struct Sample {
+        qint64 raw;
+        qint64 compressed;
+    };
+
+    QSettings &m_settings;
+    // Last measure of every tunnel using compression, raw -1 before the first
+    QMap<QString, Sample> m_baselines;
+};
+
+#endif // COMPRESSIONPOLICY_H
@@ -0,0 +1,100 @@
+#include "controlclient.h"
+
+#include <cstdio>
+#include <QJsonDocument>
+#include <QJsonArray>
+
+ControlClient::ControlClient(const QString &socketName)
+    : m_socketName(socketName)
+{}
+
+bool ControlClient::connectToInstance(int timeout) {
+    m_socket.connectToServer(m_socketName);
+    return m_socket.waitForConnected(timeout);
+}
+
+bool ControlClient::readReply(QJsonObject &reply, int timeout) {
+    while (!m_socket.canReadLine()) {
+        if (m_socket.state() != QLocalSocket::ConnectedState) {
+            return false;
+        }
+        if (!m_socket.waitForReadyRead(timeout)) {
+            return false;
+        }
+    }
+
+    QJsonDocument json(QJsonDocument::fromJson(m_socket.readLine()));
+    reply = json.object();
+    return !reply.isEmpty();
+}
+
+void ControlClient::print(const QJsonObject &reply) {
+    if (reply.contains("event")) {
+        QString event(reply["event"].toString());
+        if (event == "log") {
+            fprintf(stdout, "%s\n", reply["line"].toString().toLocal8Bit().constData());
+        } else if (event == "status") {
+            fprintf(stdout, "# status: %s %s\n", reply["host"].toString().toLocal8Bit().constData(),
+                                                 reply["status"].toString().toLocal8Bit().constData());
+        }
+    }
+    else if (!reply["ok"].toBool()) {
+        fprintf(stderr, "Error: %s\n", reply["error"].toString().toLocal8Bit().constData());
+    }
+    else if (reply.contains("timings")) {
+        // JSON as is, for scripts and regression tracking
+        QJsonDocument doc(reply["timings"].toArray());
+        fprintf(stdout, "%s", doc.toJson(QJsonDocument::Indented).constData());
+    }
+    else if (reply.contains("log")) {
+        foreach (QJsonValue line, reply["log"].toArray()) {
+            fprintf(stdout, "%s\n", line.toString().toLocal8Bit().constData());
+        }
+    }
+    else if (reply.contains("gateways")) {
+        foreach (QJsonValue gw, reply["gateways"].toArray()) {
+            QJsonObject o(gw.toObject());
+            fprintf(stdout, "%s\t%s\n", o["host"].toString().toLocal8Bit().constData(),
+                                        o["name"].toString().toLocal8Bit().constData());
+        }
+    }
+    else if (reply.contains("path")) {
+        fprintf(stdout, "%s\n", reply["path"].toString().toLocal8Bit().constData());
+    }
+    else if (reply.contains("tunnels")) {
+        fprintf(stdout, "%s\n", reply["status"].toString().toLocal8Bit().constData());
+        foreach (QJsonValue tunnel, reply["tunnels"].toArray()) {
+            QJsonObject o(tunnel.toObject());
+            if (o["host"].toString().isEmpty()) {
+                continue;
+            }
+            fprintf(stdout, "%s\t%s\n", o["host"].toString().toLocal8Bit().constData(),
+                                        o["status"].toString().toLocal8Bit().constData());
+        }
+    }
+    else if (reply.contains("status")) {
+        fprintf(stdout, "%s\n", reply["status"].toString().toLocal8Bit().constData());
+    }
+    fflush(stdout);
+}
+
+int ControlClient::run(const QJsonObject &request, bool follow, int timeout) {
+    m_socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n");
+    m_socket.flush();
+
+    QJsonObject reply;
+    if (!readReply(reply, timeout)) {
+        fprintf(stderr, "No reply from the running instance.\n");
+        return 1;
+    }
+    print(reply);
+
+    if (!reply["ok"].toBool()) {
+        return 1;
+    }
+
+    while (follow && readReply(reply, -1)) {
+        print(reply);
+    }
+    return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef CONTROLCLIENT_H
+#define CONTROLCLIENT_H
+
+#include <QString>
+#include <QJsonObject>
+#include <QLocalSocket>
+
+/*
+ * Command-line side of the ControlServer.
+ * Forwards a single request to the running instance and prints the reply
+ * on stdout. With follow, keeps printing events until the instance quits.
+ */
+class ControlClient
+{
+public:
+    explicit ControlClient(const QString &socketName);
+
+    bool connectToInstance(int timeout=1000);
+    int run(const QJsonObject &request, bool follow=false, int timeout=5000);
+
+private:
+    bool readReply(QJsonObject &reply, int timeout);
+    void print(const QJsonObject &reply);
+
+    QString m_socketName;
+    QLocalSocket m_socket;
+};
+
+#endif // CONTROLCLIENT_H
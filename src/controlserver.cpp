@@ -0,0 +1,269 @@
+#include "controlserver.h"
+#include "vpncore.h"
+#include "config.h"
+
+#include <stdexcept>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDebug>
+
+ControlServer::ControlServer(VPNCore &core, QObject *parent)
+    : QObject(parent)
+    , m_core(core)
+    , m_server(this)
+{
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+
+    connect(&m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+
+    const TunnelManager &tunnels = m_core.getTunnels();
+    connect(&tunnels, SIGNAL(statusUpdated(OpenVPN*,OpenVPN::Status)), this, SLOT(statusUpdated(OpenVPN*,OpenVPN::Status)));
+    connect(&tunnels, SIGNAL(tunnelRemoved(OpenVPN*)), this, SLOT(tunnelRemoved(OpenVPN*)));
+    connect(&m_core, SIGNAL(diagnosticsFinished(QString,bool,QString)), this, SLOT(diagnosticsFinished(QString,bool,QString)));
+}
+
+ControlServer::~ControlServer() {
+    close();
+}
+
+QString ControlServer::socketName(const Installer &installer) {
+    // {uuid} -> uuid
+    return QString(VPNGUI_NAME "-") + installer.getUuid().toString().mid(1, 36);
+}
+
+bool ControlServer::listen(const QString &name) {
+    // We hold the instance lock at this point, anything left is stale.
+    QLocalServer::removeServer(name);
+
+    if (!m_server.listen(name)) {
+        qDebug() << "ControlServer: cannot listen on" << name << ":" << m_server.errorString();
+        return false;
+    }
+    qDebug() << "ControlServer: listening on" << m_server.fullServerName();
+    return true;
+}
+
+void ControlServer::close() {
+    foreach (QLocalSocket *client, m_followers.keys()) {
+        unfollow(client);
+    }
+    m_server.close();
+}
+
+void ControlServer::newConnection() {
+    while (m_server.hasPendingConnections()) {
+        QLocalSocket *client = m_server.nextPendingConnection();
+        connect(client, SIGNAL(readyRead()), this, SLOT(clientReadyRead()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+    }
+}
+
+void ControlServer::clientDisconnected() {
+    QLocalSocket *client = qobject_cast<QLocalSocket *>(sender());
+    if (!client) {
+        return;
+    }
+    unfollow(client);
+    m_diagnosticsClients.removeAll(client);
+    client->deleteLater();
+}
+
+void ControlServer::clientReadyRead() {
+    // A request may run a nested event loop (connect resolves the gateway),
+    // the client can disconnect and be deleted meanwhile
+    QPointer<QLocalSocket> client(qobject_cast<QLocalSocket *>(sender()));
+    if (!client) {
+        return;
+    }
+
+    while (client && client->canReadLine()) {
+        QByteArray line(client->readLine().trimmed());
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        QJsonParseError error;
+        QJsonDocument json(QJsonDocument::fromJson(line, &error));
+        if (error.error != QJsonParseError::NoError || !json.isObject()) {
+            sendError(client, "invalid request: " + error.errorString());
+            continue;
+        }
+
+        handleRequest(client, json.object());
+    }
+}
+
+void ControlServer::handleRequest(const QPointer<QLocalSocket> &client, const QJsonObject &request) {
+    QString cmd(request["cmd"].toString());
+    QString host(request["host"].toString());
+    const TunnelManager &tunnels = m_core.getTunnels();
+
+    QJsonObject reply;
+    reply["ok"] = true;
+
+    if (cmd == "status") {
+        QJsonArray list;
+        foreach (OpenVPN *openvpn, tunnels.tunnels()) {
+            list.append(tunnels.getTunnelStatus(*openvpn));
+        }
+        reply["status"] = getStatusName(tunnels.getStatus());
+        reply["tunnels"] = list;
+    }
+    else if (cmd == "connect") {
+        if (host.isEmpty()) {
+            sendError(client, "missing host");
+            return;
+        }
+        QString error;
+        try {
+            m_core.vpnConnect(host);
+        }
+        catch (std::exception &e) {
+            error = e.what();
+        }
+        if (!client) {
+            // Gave up while we were resolving
+            return;
+        }
+        if (!error.isEmpty()) {
+            sendError(client, error);
+            return;
+        }
+        reply["status"] = getStatusName(tunnels.getStatus());
+    }
+    else if (cmd == "disconnect") {
+        if (host.isEmpty()) {
+            m_core.vpnDisconnect();
+        } else if (tunnels.find(host)) {
+            m_core.vpnDisconnect(host);
+        } else {
+            sendError(client, "no tunnel to " + host);
+            return;
+        }
+        reply["status"] = getStatusName(tunnels.getStatus());
+    }
+    else if (cmd == "diagnostics") {
+        // Never a path from the client, we may be elevated and it not
+        if (!m_core.createDiagnostics(m_core.newDiagnosticsPath())) {
+            sendError(client, "diagnostics already running");
+            return;
+        }
+        m_diagnosticsClients.append(client);
+        return;
+    }
+    else if (cmd == "timings") {
+        QJsonArray list;
+        foreach (OpenVPN *openvpn, tunnels.tunnels()) {
+            QJsonObject o(openvpn->getTimings().toJson());
+            o["host"] = openvpn->getName();
+            o["status"] = getStatusName(openvpn->getStatus());
+            list.append(o);
+        }
+        reply["timings"] = list;
+    }
+    else if (cmd == "gateways") {
+        QJsonArray gateways;
+        foreach (VPNGateway gw, m_core.getGatewayList()) {
+            QJsonObject o;
+            o["name"] = gw.display_name;
+            o["host"] = gw.hostname;
+            gateways.append(o);
+        }
+        reply["gateways"] = gateways;
+    }
+    else if (cmd == "log") {
+        const OpenVPN *openvpn = host.isEmpty() ? &tunnels.primary() : tunnels.find(host);
+        if (!openvpn) {
+            sendError(client, "no tunnel to " + host);
+            return;
+        }
+
+        QJsonArray lines;
+        foreach (const LogEntry &entry, openvpn->getLog()) {
+            lines.append(entry.text);
+        }
+        reply["log"] = lines;
+        if (request["follow"].toBool()) {
+            unfollow(client);
+            m_followers.insert(client, openvpn);
+            connect(openvpn, SIGNAL(logUpdated(LogEntry)), this, SLOT(logUpdated(LogEntry)), Qt::UniqueConnection);
+        }
+    }
+    else {
+        sendError(client, "unknown command: " + cmd);
+        return;
+    }
+
+    send(client, reply);
+}
+
+void ControlServer::send(QLocalSocket *client, const QJsonObject &object) {
+    client->write(QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n");
+}
+
+void ControlServer::sendError(QLocalSocket *client, const QString &error) {
+    QJsonObject reply;
+    reply["ok"] = false;
+    reply["error"] = error;
+    send(client, reply);
+}
+
+// Stop following, and stop listening to a log nobody follows anymore
+void ControlServer::unfollow(QLocalSocket *client) {
+    const OpenVPN *openvpn = m_followers.take(client);
+    if (openvpn && m_followers.key(openvpn) == nullptr) {
+        disconnect(openvpn, SIGNAL(logUpdated(LogEntry)), this, SLOT(logUpdated(LogEntry)));
+    }
+}
+
+void ControlServer::logUpdated(const LogEntry &entry) {
+    const OpenVPN *openvpn = qobject_cast<const OpenVPN *>(sender());
+
+    QJsonObject event;
+    event["event"] = "log";
+    event["line"] = entry.text;
+    event["level"] = getLevelName(entry.level);
+    event["source"] = getSourceName(entry.source);
+    QMap<QLocalSocket *, const OpenVPN *>::const_iterator it;
+    for (it=m_followers.constBegin(); it != m_followers.constEnd(); ++it) {
+        if (it.value() == openvpn) {
+            send(it.key(), event);
+        }
+    }
+}
+
+void ControlServer::statusUpdated(OpenVPN *openvpn, OpenVPN::Status s) {
+    if (m_followers.isEmpty()) {
+        return;
+    }
+
+    QJsonObject event(m_core.getTunnels().getTunnelStatus(*openvpn));
+    event["event"] = "status";
+    event["status"] = getStatusName(s);
+    foreach (QLocalSocket *client, m_followers.keys()) {
+        send(client, event);
+    }
+}
+
+void ControlServer::diagnosticsFinished(const QString &path, bool ok, const QString &error) {
+    foreach (QLocalSocket *client, m_diagnosticsClients) {
+        if (!ok) {
+            sendError(client, error);
+            continue;
+        }
+        QJsonObject reply;
+        reply["ok"] = true;
+        reply["path"] = path;
+        send(client, reply);
+    }
+    m_diagnosticsClients.clear();
+}
+
+// Followers of a removed tunnel are done, the connection is closed
+void ControlServer::tunnelRemoved(OpenVPN *openvpn) {
+    foreach (QLocalSocket *client, m_followers.keys(openvpn)) {
+        unfollow(client);
+        client->disconnectFromServer();
+    }
+}
+
@@ -0,0 +1,71 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonObject>
+#include <QMap>
+#include <QPointer>
+
+#include "openvpn.h"
+
+class VPNCore;
+class Installer;
+
+/*
+ * Local control socket, only accessible by the current user.
+ * One JSON object per line in both directions.
+ *
+ * Requests: {"cmd": "connect", "host": "..."},
+ *           {"cmd": "disconnect", "host": "..."}, {"cmd": "status"},
+ *           {"cmd": "gateways"}, {"cmd": "diagnostics"},
+ *           {"cmd": "log", "host": "...", "follow": true|false},
+ *           {"cmd": "timings"}
+ * Replies:  {"ok": true, ...} or {"ok": false, "error": "..."}
+ * "host" is optional: all tunnels for disconnect, the primary for log.
+ * The "diagnostics" reply only comes once done, with the bundle's "path"
+ * (in the install dir).
+ *
+ * After a "log" request with "follow", the client keeps receiving
+ * {"event": "log", "line": "..."} lines of that tunnel and
+ * {"event": "status", "host": "...", ...} lines of every tunnel.
+ * A tunnel's log is only forwarded while somebody follows it.
+ */
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ControlServer(VPNCore &core, QObject *parent = nullptr);
+    ~ControlServer();
+
+    bool listen(const QString &name);
+    void close();
+
+    static QString socketName(const Installer &installer);
+
+private slots:
+    void newConnection();
+    void clientReadyRead();
+    void clientDisconnected();
+
+    void logUpdated(const LogEntry &entry);
+    void statusUpdated(OpenVPN *openvpn, OpenVPN::Status s);
+    void tunnelRemoved(OpenVPN *openvpn);
+    void diagnosticsFinished(const QString &path, bool ok, const QString &error);
+
+private:
+    void handleRequest(const QPointer<QLocalSocket> &client, const QJsonObject &request);
+    void send(QLocalSocket *client, const QJsonObject &object);
+    void sendError(QLocalSocket *client, const QString &error);
+    void unfollow(QLocalSocket *client);
+
+    VPNCore &m_core;
+    QLocalServer m_server;
+    // Client -> followed tunnel
+    QMap<QLocalSocket *, const OpenVPN *> m_followers;
+    // Waiting for the diagnostics bundle
+    QList<QLocalSocket *> m_diagnosticsClients;
+};
+
+#endif // CONTROLSERVER_H
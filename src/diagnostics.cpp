@@ -0,0 +1,287 @@
+#include "diagnostics.h"
+#include "logexport.h"
+
+#include <string>
+#include <cstring>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QDebug>
+
+#include <cryptopp/gzip.h>
+#include <cryptopp/filters.h>
+
+/*
+ * Minimal ustar writer, gzip compressed on the fly.
+ * Entries are regular files, their size has to be known beforehand.
+ */
+class TarGzWriter
+{
+public:
+    explicit TarGzWriter(const QString &path)
+        : m_file(path)
+        , m_gzip(new CryptoPP::StringSink(m_compressed))
+    {}
+
+    bool open() {
+        return m_file.open(QFile::WriteOnly | QFile::Truncate);
+    }
+
+    bool addFile(const QString &name, const QByteArray &data) {
+        if (!writeHeader(name, data.size())) {
+            return false;
+        }
+        return put(data.constData(), data.size()) && pad(data.size());
+    }
+
+    // At most size bytes from the file, in chunks
+    bool addFile(const QString &name, const QString &path, qint64 size = -1) {
+        QFile f(path);
+        if (!f.open(QFile::ReadOnly)) {
+            // Gone in the meantime (rotated log, ...), not an error
+            qDebug() << "Diagnostics: skipping" << path << f.errorString();
+            return true;
+        }
+        if (size < 0 || size > f.size()) {
+            size = f.size();
+        }
+        if (!writeHeader(name, size)) {
+            return false;
+        }
+
+        QByteArray chunk;
+        qint64 left = size;
+        while (left > 0) {
+            chunk = f.read(qMin<qint64>(left, LogExporter::ChunkSize));
+            if (chunk.isEmpty()) {
+                // Shorter than expected, keep the archive consistent
+                chunk = QByteArray(static_cast<int>(qMin<qint64>(left, LogExporter::ChunkSize)), '\0');
+            }
+            if (!put(chunk.constData(), chunk.size())) {
+                return false;
+            }
+            left -= chunk.size();
+        }
+        return pad(size);
+    }
+
+    bool finish() {
+        // End of archive: two empty blocks
+        QByteArray end(1024, '\0');
+        if (!put(end.constData(), end.size())) {
+            return false;
+        }
+        m_gzip.MessageEnd();
+        bool ok = flush();
+        m_file.close();
+        return ok;
+    }
+
+    QString errorString() const {
+        return m_file.errorString();
+    }
+
+private:
+    bool writeHeader(const QString &name, qint64 size) {
+        QByteArray h(512, '\0');
+        QByteArray nameUtf8(name.toUtf8().left(99));
+
+        memcpy(h.data(), nameUtf8.constData(), nameUtf8.size());
+        memcpy(h.data() + 100, "0000644", 7);                         // mode
+        memcpy(h.data() + 108, "0000000", 7);                         // uid
+        memcpy(h.data() + 116, "0000000", 7);                         // gid
+        QByteArray sizeOct(QByteArray::number(size, 8).rightJustified(11, '0'));
+        memcpy(h.data() + 124, sizeOct.constData(), 11);
+        QByteArray mtimeOct(QByteArray::number(QDateTime::currentMSecsSinceEpoch() / 1000, 8).rightJustified(11, '0'));
+        memcpy(h.data() + 136, mtimeOct.constData(), 11);
+        h[156] = '0';                                                  // regular file
+        memcpy(h.data() + 257, "ustar", 6);
+        memcpy(h.data() + 263, "00", 2);
+
+        // Checksum, computed with the field itself as spaces
+        memset(h.data() + 148, ' ', 8);
+        unsigned int sum = 0;
+        for (int i=0; i<512; ++i) {
+            sum += static_cast<unsigned char>(h[i]);
+        }
+        QByteArray sumOct(QByteArray::number(sum, 8).rightJustified(6, '0'));
+        memcpy(h.data() + 148, sumOct.constData(), 6);
+        h[154] = '\0';
+
+        return put(h.constData(), h.size());
+    }
+
+    bool pad(qint64 size) {
+        int rest = static_cast<int>(size % 512);
+        if (rest == 0) {
+            return true;
+        }
+        QByteArray zeros(512 - rest, '\0');
+        return put(zeros.constData(), zeros.size());
+    }
+
+    bool put(const char *data, int size) {
+        m_gzip.Put((const byte*)data, size);
+        return flush();
+    }
+
+    // The StringSink is only a staging buffer
+    bool flush() {
+        if (m_compressed.empty()) {
+            return true;
+        }
+        qint64 written = m_file.write(m_compressed.data(), static_cast<qint64>(m_compressed.size()));
+        m_compressed.clear();
+        return written != -1;
+    }
+
+    QFile m_file;
+    std::string m_compressed;
+    CryptoPP::Gzip m_gzip;
+};
+
+
+DiagnosticsBundle::DiagnosticsBundle(const Inputs &inputs, const QString &path)
+    : QObject(nullptr)
+    , m_inputs(inputs)
+    , m_path(path)
+{}
+
+QString DiagnosticsBundle::errorString() const {
+    return m_error;
+}
+
+void DiagnosticsBundle::start() {
+    QThread *thread = new QThread;
+    moveToThread(thread);
+
+    connect(thread, SIGNAL(started()), this, SLOT(run()));
+    connect(thread, SIGNAL(finished()), this, SLOT(deleteLater()));
+    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+    thread->start(QThread::LowPriority);
+}
+
+void DiagnosticsBundle::run() {
+    bool ok = write();
+    emit finished(m_path, ok, m_error);
+    thread()->quit();
+}
+
+bool DiagnosticsBundle::write() {
+    TarGzWriter tar(m_path);
+    if (!tar.open()) {
+        m_error = tar.errorString();
+        return false;
+    }
+
+    QString dir(m_inputs.name + "/");
+    bool ok = tar.addFile(dir + "info.txt", m_inputs.info)
+           && tar.addFile(dir + "settings.ini", m_inputs.settings)
+           && tar.addFile(dir + "tunnels.json", m_inputs.tunnels);
+
+    // Installed files, hashed here rather than on the main thread
+    QByteArray install;
+    QDir installDir(m_inputs.installDir);
+    QMap<QString, QString>::const_iterator it;
+    for (it=m_inputs.index.constBegin(); ok && it != m_inputs.index.constEnd(); ++it) {
+        QString actual("missing");
+        QFile f(installDir.filePath(it.key()));
+        if (f.open(QFile::ReadOnly)) {
+            QCryptographicHash hasher(QCryptographicHash::Sha1);
+            hasher.addData(&f);
+            actual = QString(hasher.result().toHex());
+        }
+        QString state(actual == it.value() ? "ok" : "MISMATCH");
+        install += QString("%1 %2 %3 %4\n").arg(state, it.value(), actual, it.key()).toUtf8();
+    }
+    ok = ok && tar.addFile(dir + "install.txt", install);
+
+    foreach (QString path, m_inputs.configFiles) {
+        if (!ok) {
+            break;
+        }
+        QFile f(path);
+        if (!f.open(QFile::ReadOnly)) {
+            continue;
+        }
+        // Small files, fine in memory
+        QByteArray config(sanitizeConfig(f.readAll()));
+        ok = tar.addFile(dir + "configs/" + QFileInfo(path).fileName(), config);
+    }
+
+    // Logs as text: written to a temporary file first, tar needs the size
+    if (ok) {
+        QTemporaryFile tmp;
+        if (tmp.open()) {
+            tmp.close();
+            LogExporter exporter(tmp.fileName());
+            bool logsOk = exporter.open();
+            foreach (const LogStore::SegmentFile &segment, m_inputs.logSegments) {
+                LogStore::forEachInSegment(segment, [&exporter, &logsOk](const LogEntry &entry) {
+                    logsOk = logsOk && exporter.write(entry);
+                    return logsOk;
+                });
+            }
+            if (exporter.finish() && logsOk) {
+                ok = tar.addFile(dir + "logs.txt", tmp.fileName());
+            } else {
+                qDebug() << "Diagnostics: cannot export logs:" << exporter.errorString();
+            }
+        }
+    }
+
+    if (!ok || !tar.finish()) {
+        m_error = tar.errorString();
+        return false;
+    }
+    return true;
+}
+
+QByteArray DiagnosticsBundle::sanitizeConfig(const QByteArray &config) {
+    QStringList secretTags;
+    secretTags << "key" << "cert" << "pkcs12" << "secret" << "tls-auth"
+               << "tls-crypt" << "auth-user-pass" << "http-proxy-user-pass";
+
+    QByteArray out;
+    QString skipping;
+    foreach (QByteArray line, config.split('\n')) {
+        QString trimmed(QString::fromUtf8(line).trimmed());
+
+        if (!skipping.isEmpty()) {
+            if (trimmed == "</" + skipping + ">") {
+                out += "[removed]\n" + line + "\n";
+                skipping.clear();
+            }
+            continue;
+        }
+
+        foreach (QString tag, secretTags) {
+            if (trimmed == "<" + tag + ">") {
+                skipping = tag;
+                break;
+            }
+        }
+        out += line + "\n";
+    }
+    return out;
+}
+
+QByteArray DiagnosticsBundle::sanitizeSettings(const QSettings &settings) {
+    // Never the credentials, nor passwords in URLs
+    QRegularExpression urlAuth("//[^/@\\s]+@");
+    QByteArray out;
+    foreach (QString key, settings.allKeys()) {
+        if (key == "auth" || key.contains("pass", Qt::CaseInsensitive)) {
+            continue;
+        }
+        QString value(settings.value(key).toString());
+        value.replace(urlAuth, "//[removed]@");
+        out += (key + "=" + value + "\n").toUtf8();
+    }
+    return out;
+}
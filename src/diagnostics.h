@@ -0,0 +1,72 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QSettings>
+#include <QString>
+#include <QStringList>
+
+#include "logstore.h"
+
+/*
+ * Everything a support ticket needs, in one .tar.gz:
+ *   info.txt       versions, OS, install dir
+ *   settings.ini   settings without credentials
+ *   tunnels.json   status & connection stats of every tunnel
+ *   install.txt    installed files with expected and actual hashes
+ *   configs/       generated OpenVPN configs, keys & certs removed
+ *   logs.txt       the whole LogStore as text
+ *
+ * The inputs are collected on the main thread (small, or file paths),
+ * run() only reads files so it can be moved to a worker thread. Files are
+ * streamed in chunks, memory use doesn't depend on the size of the logs.
+ */
+class DiagnosticsBundle : public QObject
+{
+    Q_OBJECT
+public:
+    struct Inputs {
+        QString name;   // top directory in the archive
+        QString installDir;
+        QByteArray info;
+        QByteArray settings;
+        QByteArray tunnels;
+        // Installed file -> expected SHA1 (hex)
+        QMap<QString, QString> index;
+        QStringList configFiles;
+        QList<LogStore::SegmentFile> logSegments;
+    };
+
+    DiagnosticsBundle(const Inputs &inputs, const QString &path);
+
+    // Blocking, see start() for the threaded version
+    bool write();
+    QString errorString() const;
+
+    // Run write() on a new thread, finished() is emitted on the thread
+    // that called start() and the bundle deletes itself after that.
+    void start();
+
+    // Remove inline keys/certs/secrets from an OpenVPN config
+    static QByteArray sanitizeConfig(const QByteArray &config);
+
+    // "key=value" lines, without the credentials nor passwords
+    static QByteArray sanitizeSettings(const QSettings &settings);
+
+signals:
+    void finished(const QString &path, bool ok, const QString &error);
+
+private slots:
+    void run();
+
+private:
+    Inputs m_inputs;
+    QString m_path;
+    QString m_error;
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,119 @@
+#include "dnscache.h"
+
+#include <QDateTime>
+#include <QDnsLookup>
+#include <QHostAddress>
+#include <QDebug>
+
+DnsCache::DnsCache(QObject *parent)
+    : QObject(parent)
+    , m_ipv6(false)
+{}
+
+bool DnsCache::lookup(const QString &hostname, bool ipv6, QStringList &v4, QStringList &v6) const {
+    QHash<QString, Entry>::const_iterator it(m_cache.constFind(hostname.toLower()));
+    if (it == m_cache.constEnd() || it->expires < QDateTime::currentMSecsSinceEpoch()) {
+        return false;
+    }
+    if (ipv6 && !it->ipv6) {
+        return false;
+    }
+
+    v4 = it->v4;
+    v6 = ipv6 ? it->v6 : QStringList();
+    return true;
+}
+
+void DnsCache::store(const QString &hostname, bool ipv6, const QStringList &v4,
+                     const QStringList &v6, int ttl) {
+    Entry e;
+    e.v4 = v4;
+    e.v6 = v6;
+    e.ipv6 = ipv6;
+    ttl = qBound(static_cast<int>(MinTtl), ttl, static_cast<int>(MaxTtl));
+    e.expires = QDateTime::currentMSecsSinceEpoch() + ttl * 1000LL;
+    m_cache[hostname.toLower()] = e;
+}
+
+void DnsCache::prefetch(const QStringList &hostnames, const QString &nameserver, bool ipv6) {
+    m_nameserver = nameserver;
+    m_ipv6 = ipv6;
+
+    QStringList v4, v6;
+    foreach (const QString &hostname, hostnames) {
+        QString host(hostname.toLower());
+        if (host.isEmpty() || m_queue.contains(host) || m_running.contains(host)
+                || lookup(host, ipv6, v4, v6)) {
+            continue;
+        }
+        m_queue.append(host);
+    }
+    startLookups();
+}
+
+void DnsCache::startLookups() {
+    while (m_running.size() < MaxLookups && !m_queue.isEmpty()) {
+        QString hostname(m_queue.takeFirst());
+
+        QList<QDnsLookup::Type> types;
+        types << QDnsLookup::A;
+        if (m_ipv6) {
+            types << QDnsLookup::AAAA;
+        }
+
+        Running r;
+        r.lookups = types.size();
+        r.failed = false;
+        r.ttl = MaxTtl;
+        m_running.insert(hostname, r);
+
+        foreach (QDnsLookup::Type type, types) {
+            QDnsLookup *dns = new QDnsLookup(type, hostname, this);
+            if (!m_nameserver.isEmpty()) {
+                dns->setNameserver(QHostAddress(m_nameserver));
+            }
+            dns->setProperty("ipv6", m_ipv6);
+            connect(dns, SIGNAL(finished()), this, SLOT(lookupFinished()));
+            dns->lookup();
+        }
+    }
+}
+
+void DnsCache::lookupFinished() {
+    QDnsLookup *dns = qobject_cast<QDnsLookup *>(sender());
+    if (!dns) {
+        return;
+    }
+    dns->deleteLater();
+
+    QString hostname(dns->name());
+    if (!m_running.contains(hostname)) {
+        return;
+    }
+    Running &r = m_running[hostname];
+
+    if (dns->error() == QDnsLookup::NoError) {
+        foreach (QDnsHostAddressRecord record, dns->hostAddressRecords()) {
+            if (record.value().protocol() == QAbstractSocket::IPv6Protocol) {
+                r.v6.append(record.value().toString());
+            } else {
+                r.v4.append(record.value().toString());
+            }
+            r.ttl = qMin(r.ttl, static_cast<int>(record.timeToLive()));
+        }
+    } else if (dns->type() == QDnsLookup::A || dns->error() != QDnsLookup::NotFoundError) {
+        // No AAAA is fine, anything else is retried on connect
+        qDebug() << "DNS prefetch failed:" << hostname << dns->errorString();
+        r.failed = true;
+    }
+
+    if (--r.lookups > 0) {
+        return;
+    }
+
+    if (!r.failed && !r.v4.isEmpty()) {
+        store(hostname, dns->property("ipv6").toBool(), r.v4, r.v6, r.ttl);
+    }
+    m_running.remove(hostname);
+    startLookups();
+}
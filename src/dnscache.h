@@ -0,0 +1,64 @@
+#ifndef DNSCACHE_H
+#define DNSCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+/*
+ * Resolved gateways, kept for their TTL (clamped to [MinTtl, MaxTtl]).
+ *
+ * prefetch() resolves a list of hosts in the background, A and AAAA
+ * together, at most MaxLookups hosts at a time so a long gateway list
+ * doesn't flood the resolver. A host already cached or queued is skipped.
+ */
+class DnsCache : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        MaxLookups = 4,
+        MinTtl = 60,
+        MaxTtl = 3600,
+    };
+
+    explicit DnsCache(QObject *parent = nullptr);
+
+    // A cached entry without AAAA doesn't count when ipv6 is wanted
+    bool lookup(const QString &hostname, bool ipv6, QStringList &v4, QStringList &v6) const;
+    void store(const QString &hostname, bool ipv6, const QStringList &v4,
+               const QStringList &v6, int ttl);
+
+    // nameserver: empty for the system default
+    void prefetch(const QStringList &hostnames, const QString &nameserver, bool ipv6);
+
+private slots:
+    void lookupFinished();
+
+private:
+    struct Entry {
+        QStringList v4;
+        QStringList v6;
+        bool ipv6;
+        qint64 expires;
+    };
+
+    struct Running {
+        int lookups;
+        bool failed;
+        int ttl;
+        QStringList v4;
+        QStringList v6;
+    };
+
+    void startLookups();
+
+    QHash<QString, Entry> m_cache;
+    QStringList m_queue;
+    QHash<QString, Running> m_running;
+    QString m_nameserver;
+    bool m_ipv6;
+};
+
+#endif // DNSCACHE_H
@@ -0,0 +1,200 @@
+#include "dohresolver.h"
+
+#include <QDateTime>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <QUrlQuery>
+#include <QDebug>
+
+DohResolver::DohResolver(QNetworkAccessManager &qnam, QObject *parent)
+    : QObject(parent)
+    , m_qnam(qnam)
+{}
+
+void DohResolver::setServer(const QUrl &server) {
+    if (server == m_server) {
+        return;
+    }
+    m_server = server;
+    m_cache.clear();
+}
+
+QUrl DohResolver::server() const {
+    return m_server;
+}
+
+QString DohResolver::cacheKey(const QString &hostname, int type) {
+    return QString::number(type) + ":" + hostname.toLower();
+}
+
+bool DohResolver::fromCache(const QString &key, QStringList &addresses) const {
+    QHash<QString, Entry>::const_iterator it(m_cache.constFind(key));
+    if (it == m_cache.constEnd() || it->expires < QDateTime::currentMSecsSinceEpoch()) {
+        return false;
+    }
+    addresses = it->addresses;
+    return true;
+}
+
+QNetworkReply *DohResolver::query(const QString &hostname, int type) {
+    QString key(cacheKey(hostname, type));
+    if (m_pending.contains(key)) {
+        return m_pending[key];
+    }
+
+    QUrl url(m_server);
+    QUrlQuery q(url);
+    q.addQueryItem("name", hostname);
+    q.addQueryItem("type", type == TypeAAAA ? "AAAA" : "A");
+    url.setQuery(q);
+
+    QNetworkRequest request(url);
+    request.setRawHeader("Accept", "application/dns-json");
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif
+
+    QNetworkReply *reply = m_qnam.get(request);
+    reply->setProperty("dohKey", key);
+    reply->setProperty("dohType", type);
+    connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+    m_pending[key] = reply;
+    return reply;
+}
+
+void DohResolver::prefetch(const QStringList &hostnames, bool ipv6) {
+    if (m_server.isEmpty()) {
+        return;
+    }
+
+    QList<int> types;
+    types << TypeA;
+    if (ipv6) {
+        types << TypeAAAA;
+    }
+
+    QStringList unused;
+    foreach (const QString &hostname, hostnames) {
+        foreach (int type, types) {
+            if (!fromCache(cacheKey(hostname, type), unused)) {
+                query(hostname, type);
+            }
+        }
+    }
+}
+
+bool DohResolver::resolve(const QString &hostname, bool ipv6, QStringList &v4, QStringList &v6) {
+    if (m_server.isEmpty()) {
+        return false;
+    }
+
+    QList<int> types;
+    types << TypeA;
+    if (ipv6) {
+        types << TypeAAAA;
+    }
+
+    // Wait for what isn't cached
+    QList<QNetworkReply *> replies;
+    QStringList unused;
+    foreach (int type, types) {
+        if (!fromCache(cacheKey(hostname, type), unused)) {
+            replies << query(hostname, type);
+        }
+    }
+
+    if (!replies.isEmpty()) {
+        QEventLoop loop;
+        int pending = replies.size();
+        foreach (QNetworkReply *reply, replies) {
+            connect(reply, &QNetworkReply::finished, &loop, [&pending, &loop]() {
+                if (--pending == 0) {
+                    loop.quit();
+                }
+            }, Qt::QueuedConnection);
+        }
+        // Still cached when they arrive late
+        QTimer::singleShot(Timeout, &loop, SLOT(quit()));
+        loop.exec();
+    }
+
+    if (!fromCache(cacheKey(hostname, TypeA), v4)) {
+        return false;
+    }
+    if (ipv6) {
+        fromCache(cacheKey(hostname, TypeAAAA), v6);
+    }
+    return true;
+}
+
+bool DohResolver::isCached(const QString &hostname, bool ipv6) const {
+    QStringList unused;
+    return !m_server.isEmpty() && fromCache(cacheKey(hostname, TypeA), unused)
+            && (!ipv6 || fromCache(cacheKey(hostname, TypeAAAA), unused));
+}
+
+void DohResolver::replyFinished() {
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply) {
+        return;
+    }
+    reply->deleteLater();
+
+    QString key(reply->property("dohKey").toString());
+    int type = reply->property("dohType").toInt();
+    m_pending.remove(key);
+
+    if (reply->error() != QNetworkReply::NoError) {
+        qDebug() << "DoH query failed:" << key << reply->errorString();
+        return;
+    }
+
+    Entry entry;
+    int ttl;
+    if (!parseAnswer(reply->readAll(), type, entry.addresses, ttl)) {
+        qDebug() << "DoH query failed:" << key;
+        return;
+    }
+    entry.expires = QDateTime::currentMSecsSinceEpoch() + ttl * 1000LL;
+    m_cache[key] = entry;
+
+    qDebug() << "DoH resolved:" << key << entry.addresses;
+}
+
+bool DohResolver::parseAnswer(const QByteArray &json, int type, QStringList &addresses, int &ttl) {
+    QJsonObject root(QJsonDocument::fromJson(json).object());
+    // 0: NOERROR, 3: NXDOMAIN, both are answers
+    int status = root["Status"].toInt(-1);
+    if (status != 0 && status != 3) {
+        return false;
+    }
+
+    addresses.clear();
+    ttl = MaxTtl;
+    foreach (const QJsonValue &v, root["Answer"].toArray()) {
+        QJsonObject answer(v.toObject());
+        // CNAMEs on the way
+        if (answer["type"].toInt() != type) {
+            continue;
+        }
+        QHostAddress address(answer["data"].toString());
+        if (address.isNull()) {
+            continue;
+        }
+        addresses.append(address.toString());
+        ttl = qMin(ttl, answer["TTL"].toInt(MinTtl));
+    }
+    if (addresses.isEmpty()) {
+        // Negative answer, no TTL to go by
+        ttl = MinTtl;
+    }
+    ttl = qBound(static_cast<int>(MinTtl), ttl, static_cast<int>(MaxTtl));
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef DOHRESOLVER_H
+#define DOHRESOLVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/*
+ * DNS-over-HTTPS, JSON API (application/dns-json, as served by Cloudflare,
+ * Google and most public resolvers): GET <server>?name=<host>&type=A
+ *
+ * Queries go through the shared QNetworkAccessManager, which keeps the
+ * connection to the server open (multiplexed over HTTP/2 when available),
+ * so after the first one a lookup is a single request on a warm connection.
+ * Answers are cached for their TTL, clamped to [MinTtl, MaxTtl].
+ */
+class DohResolver : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        Timeout = 5000,
+        MinTtl = 60,
+        MaxTtl = 3600,
+        // DNS record types
+        TypeA = 1,
+        TypeAAAA = 28,
+    };
+
+    explicit DohResolver(QNetworkAccessManager &qnam, QObject *parent = nullptr);
+
+    // Empty to disable. Changing it clears the cache.
+    void setServer(const QUrl &server);
+    QUrl server() const;
+
+    // Start the lookups of every host not already cached, all at once
+    void prefetch(const QStringList &hostnames, bool ipv6);
+
+    // Blocking (local event loop) unless cached. false if the server
+    // couldn't be used, true with empty lists if the host has no address.
+    bool resolve(const QString &hostname, bool ipv6, QStringList &v4, QStringList &v6);
+    // resolve() would answer right away
+    bool isCached(const QString &hostname, bool ipv6) const;
+
+    // A server's JSON answer: the addresses of that type (empty if none)
+    // and their TTL, clamped. false if the server couldn't answer.
+    static bool parseAnswer(const QByteArray &json, int type, QStringList &addresses, int &ttl);
+
+private slots:
+    void replyFinished();
+
+private:
+    struct Entry {
+        QStringList addresses;
+        qint64 expires;
+    };
+
+    static QString cacheKey(const QString &hostname, int type);
+    bool fromCache(const QString &key, QStringList &addresses) const;
+    QNetworkReply *query(const QString &hostname, int type);
+
+    QNetworkAccessManager &m_qnam;
+    QUrl m_server;
+    QHash<QString, Entry> m_cache;
+    // In flight, shared by prefetch() and resolve()
+    QHash<QString, QNetworkReply *> m_pending;
+};
+
+#endif // DOHRESOLVER_H
@@ -483,6 +483,7 @@ void Installer::uninstall(bool waitForOpenVPN) {
     }
 
     if (waitForOpenVPN) {
+        // Only for --uninstall, VPNGUI::uninstall() waits asynchronously.
         // Try to delete openvpn.exe for up to a second
         // Even if it's killed before, the file is somehow still opened
         // at this point.
@@ -566,6 +567,10 @@ void Installer::uninstallTAP() {
     QProcess::startDetached(path);
 }
 
+const QMap<QString, QString> &Installer::getIndex() const {
+    return m_index;
+}
+
 void Installer::loadIndex() {
     QFile index(":/openvpn/openvpn-" OPENVPN_VERSION "-" + getArch() + "/index.txt");
     if (!index.open(QIODevice::ReadOnly | QIODevice::Text)) {
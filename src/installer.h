@@ -40,6 +40,8 @@ public:
     inline QDir getDir() const { return m_baseDir; }
     QUuid getUuid() const;
     QString getGuid() const;
+    // Installed file -> expected SHA1 (hex)
+    const QMap<QString, QString> &getIndex() const;
 
 private:
     QString getArch();
@@ -0,0 +1,41 @@
+#include "logentry.h"
+
+#include <QDateTime>
+
+LogEntry::LogEntry()
+    : time(0)
+    , level(Info)
+    , source(Status)
+{}
+
+LogEntry::LogEntry(Source source, Level level, const QString &tunnel, const QString &text)
+    : time(QDateTime::currentMSecsSinceEpoch())
+    , level(level)
+    , source(source)
+    , tunnel(tunnel)
+    , text(text)
+{}
+
+QString getLevelName(quint8 level) {
+    if (level == LogEntry::Debug) {
+        return "debug";
+    } else if (level == LogEntry::Info) {
+        return "info";
+    } else if (level == LogEntry::Warning) {
+        return "warning";
+    } else if (level == LogEntry::Error) {
+        return "error";
+    }
+    return "unknown";
+}
+
+QString getSourceName(quint8 source) {
+    if (source == LogEntry::Status) {
+        return "status";
+    } else if (source == LogEntry::Management) {
+        return "management";
+    } else if (source == LogEntry::Process) {
+        return "openvpn";
+    }
+    return "unknown";
+}
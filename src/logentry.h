@@ -0,0 +1,41 @@
+#ifndef LOGENTRY_H
+#define LOGENTRY_H
+
+#include <QMetaType>
+#include <QString>
+
+/*
+ * A log line, classified once when OpenVPN receives it so the windows,
+ * the LogStore and the control socket never parse the text again.
+ */
+struct LogEntry {
+    enum Level {
+        Debug,
+        Info,
+        Warning,
+        Error,
+    };
+
+    enum Source {
+        Status,     // our own "# ..." lines
+        Management, // "> notification" and ">> response"
+        Process,    // openvpn's stdout
+    };
+
+    qint64 time;    // ms since epoch
+    quint8 level;
+    quint8 source;
+    QString tunnel;
+    QString text;
+
+    LogEntry();
+    LogEntry(Source source, Level level, const QString &tunnel, const QString &text);
+};
+
+Q_DECLARE_METATYPE(LogEntry)
+
+// Stable names for the control API, not translated.
+QString getLevelName(quint8 level);
+QString getSourceName(quint8 source);
+
+#endif // LOGENTRY_H
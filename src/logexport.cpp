@@ -0,0 +1,150 @@
+#include "logexport.h"
+
+#include <QDateTime>
+#include <QThread>
+
+#include <cryptopp/gzip.h>
+#include <cryptopp/filters.h>
+
+LogExporter::LogExporter(const QString &path)
+    : m_file(path)
+    , m_compress(path.endsWith(".gz", Qt::CaseInsensitive))
+    , m_count(0)
+{}
+
+// QScopedPointer needs the complete CryptoPP::Gzip type here
+LogExporter::~LogExporter() {}
+
+bool LogExporter::open() {
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    if (m_compress) {
+        // The StringSink is only a staging buffer, emptied after every chunk
+        m_gzip.reset(new CryptoPP::Gzip(new CryptoPP::StringSink(m_compressed)));
+    }
+    m_chunk.reserve(ChunkSize + 1024);
+    return true;
+}
+
+bool LogExporter::write(const LogEntry &entry) {
+    m_chunk += QDateTime::fromMSecsSinceEpoch(entry.time).toString("yyyy-MM-dd hh:mm:ss ").toUtf8();
+    if (!entry.tunnel.isEmpty()) {
+        m_chunk += "[" + entry.tunnel.toUtf8() + "] ";
+    }
+    m_chunk += entry.text.toUtf8();
+    m_chunk += '\n';
+    m_count++;
+
+    if (m_chunk.size() >= ChunkSize) {
+        return flushChunk();
+    }
+    return true;
+}
+
+bool LogExporter::flushChunk() {
+    if (m_chunk.isEmpty()) {
+        return true;
+    }
+
+    if (m_compress) {
+        m_gzip->Put((const byte*)m_chunk.constData(), m_chunk.size());
+        // Keeps the reserved buffer, clear() would free it
+        m_chunk.resize(0);
+        return writeCompressed();
+    }
+
+    qint64 written = m_file.write(m_chunk);
+    m_chunk.resize(0);
+    if (written == -1) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool LogExporter::writeCompressed() {
+    if (m_compressed.empty()) {
+        return true;
+    }
+    qint64 written = m_file.write(m_compressed.data(), static_cast<qint64>(m_compressed.size()));
+    m_compressed.clear();
+    if (written == -1) {
+        m_error = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool LogExporter::finish() {
+    if (!m_file.isOpen()) {
+        return false;
+    }
+
+    bool ok = flushChunk();
+    if (ok && m_compress) {
+        m_gzip->MessageEnd();
+        ok = writeCompressed();
+    }
+    m_file.close();
+    return ok;
+}
+
+QString LogExporter::errorString() const {
+    return m_error;
+}
+
+qint64 LogExporter::getCount() const {
+    return m_count;
+}
+
+
+LogExportJob::LogExportJob(const QString &path, const QList<LogEntry> &entries)
+    : m_path(path)
+    , m_entries(entries)
+{}
+
+LogExportJob::LogExportJob(const QString &path, const QList<LogStore::SegmentFile> &segments,
+                           const LogQuery &query)
+    : m_path(path)
+    , m_segments(segments)
+    , m_query(query)
+{}
+
+void LogExportJob::start() {
+    QThread *thread = new QThread;
+    moveToThread(thread);
+
+    connect(thread, SIGNAL(started()), this, SLOT(run()));
+    connect(thread, SIGNAL(finished()), this, SLOT(deleteLater()));
+    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+    thread->start(QThread::LowPriority);
+}
+
+void LogExportJob::run() {
+    LogExporter exporter(m_path);
+    bool ok = exporter.open();
+
+    if (ok) {
+        foreach (const LogEntry &entry, m_entries) {
+            if (!(ok = exporter.write(entry))) {
+                break;
+            }
+        }
+    }
+    foreach (const LogStore::SegmentFile &segment, m_segments) {
+        if (!ok) {
+            break;
+        }
+        LogStore::forEachInSegment(segment, [&exporter, &ok](const LogEntry &entry) {
+            ok = exporter.write(entry);
+            return ok;
+        }, m_query);
+    }
+
+    ok = exporter.finish() && ok;
+    emit finished(m_path, ok, exporter.errorString());
+    thread()->quit();
+}
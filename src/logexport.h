@@ -0,0 +1,85 @@
+#ifndef LOGEXPORT_H
+#define LOGEXPORT_H
+
+#include <string>
+#include <QObject>
+#include <QFile>
+#include <QByteArray>
+#include <QList>
+#include <QScopedPointer>
+#include <QString>
+
+#include "logentry.h"
+#include "logstore.h"
+
+namespace CryptoPP {
+class Gzip;
+}
+
+/*
+ * Writes log entries to a file as they come, in ChunkSize chunks,
+ * gzip compressed if the path ends with ".gz".
+ * Memory use doesn't depend on how much is exported.
+ */
+class LogExporter
+{
+public:
+    explicit LogExporter(const QString &path);
+    ~LogExporter();
+
+    bool open();
+    bool write(const LogEntry &entry);
+    // Flush everything, the file is incomplete without it
+    bool finish();
+
+    QString errorString() const;
+    qint64 getCount() const;
+
+    enum {
+        ChunkSize = 64 * 1024,
+    };
+
+private:
+    bool flushChunk();
+    bool writeCompressed();
+
+    QFile m_file;
+    bool m_compress;
+    QByteArray m_chunk;
+    std::string m_compressed;
+    QScopedPointer<CryptoPP::Gzip> m_gzip;
+    qint64 m_count;
+    QString m_error;
+};
+
+/*
+ * A LogExporter on a worker thread, large exports would freeze the GUI:
+ * either the given entries, or what matches query in the LogStore
+ * segments (LogStore::getSegmentFiles(), read without the LogStore).
+ * finished() is emitted on the thread that called start() and the job
+ * deletes itself after that.
+ */
+class LogExportJob : public QObject
+{
+    Q_OBJECT
+public:
+    LogExportJob(const QString &path, const QList<LogEntry> &entries);
+    LogExportJob(const QString &path, const QList<LogStore::SegmentFile> &segments,
+                 const LogQuery &query);
+
+    void start();
+
+signals:
+    void finished(const QString &path, bool ok, const QString &error);
+
+private slots:
+    void run();
+
+private:
+    QString m_path;
+    QList<LogEntry> m_entries;
+    QList<LogStore::SegmentFile> m_segments;
+    LogQuery m_query;
+};
+
+#endif // LOGEXPORT_H
@@ -0,0 +1,377 @@
+#include "logstore.h"
+
+#include <cstring>
+#include <limits>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QtEndian>
+#include <QDebug>
+
+// u32 length + i64 time + u8 level + u8 source + u16 tunnel length
+static const int RecordHeaderSize = 4 + 8 + 1 + 1 + 2;
+static const quint32 IndexMagic = 0x4c564c49; // "LVLI"
+static const quint32 IndexVersion = 1;
+
+LogQuery::LogQuery()
+    : from(0)
+    , to(std::numeric_limits<qint64>::max())
+    , levelMask(LogStore::AllLevels)
+    , limit(1000)
+{}
+
+LogStore::Segment::Segment()
+    : seq(0)
+    , size(0)
+    , minTime(std::numeric_limits<qint64>::max())
+    , maxTime(std::numeric_limits<qint64>::min())
+    , levelMask(0)
+    , count(0)
+{}
+
+void LogStore::Segment::add(qint64 time, quint8 level, qint64 offset) {
+    if (count % IndexInterval == 0) {
+        sparse.append(qMakePair(time, offset));
+    }
+    minTime = qMin(minTime, time);
+    maxTime = qMax(maxTime, time);
+    levelMask |= (1 << level);
+    count++;
+}
+
+
+LogStore::LogStore(QObject *parent)
+    : QObject(parent)
+{}
+
+LogStore::~LogStore() {
+    close();
+}
+
+QString LogStore::segmentPath(int seq) const {
+    return m_dir.filePath(QString("%1.seg").arg(seq, 8, 10, QChar('0')));
+}
+
+QString LogStore::indexPath(int seq) const {
+    return m_dir.filePath(QString("%1.idx").arg(seq, 8, 10, QChar('0')));
+}
+
+bool LogStore::open(const QString &path) {
+    close();
+
+    m_dir = QDir(path);
+    if (!m_dir.exists() && !m_dir.mkpath(".")) {
+        qDebug() << "LogStore: cannot create" << path;
+        return false;
+    }
+
+    QStringList names(m_dir.entryList(QStringList("*.seg"), QDir::Files, QDir::Name));
+    foreach (QString name, names) {
+        Segment s;
+        bool ok = false;
+        s.seq = name.left(name.indexOf('.')).toInt(&ok);
+        if (!ok) {
+            continue;
+        }
+        s.size = QFileInfo(segmentPath(s.seq)).size();
+
+        // No index, or a stale one from a crash
+        if (!loadIndex(s)) {
+            scanSegment(s);
+            saveIndex(s);
+        }
+        m_segments.append(s);
+    }
+
+    return openActive();
+}
+
+void LogStore::close() {
+    if (!m_active.isOpen()) {
+        return;
+    }
+    m_active.close();
+    if (!m_segments.isEmpty()) {
+        saveIndex(m_segments.last());
+    }
+    m_segments.clear();
+}
+
+bool LogStore::isOpen() const {
+    return m_active.isOpen();
+}
+
+bool LogStore::openActive() {
+    if (m_segments.isEmpty() || m_segments.last().size >= SegmentSize) {
+        Segment s;
+        s.seq = m_segments.isEmpty() ? 1 : m_segments.last().seq + 1;
+        m_segments.append(s);
+    }
+
+    m_active.setFileName(segmentPath(m_segments.last().seq));
+    if (!m_active.open(QFile::WriteOnly | QFile::Append)) {
+        qDebug() << "LogStore: cannot open" << m_active.fileName();
+        return false;
+    }
+    // Written again on rotation/close, an old one would look valid
+    QFile::remove(indexPath(m_segments.last().seq));
+
+    while (m_segments.size() > MaxSegments) {
+        Segment old(m_segments.takeFirst());
+        QFile::remove(segmentPath(old.seq));
+        QFile::remove(indexPath(old.seq));
+    }
+    return true;
+}
+
+void LogStore::rotate() {
+    m_active.close();
+    saveIndex(m_segments.last());
+    openActive();
+}
+
+bool LogStore::loadIndex(Segment &s) const {
+    QFile f(indexPath(s.seq));
+    if (!f.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&f);
+    quint32 magic, version, nSparse;
+    qint64 size;
+    in >> magic >> version >> size;
+    if (magic != IndexMagic || version != IndexVersion || size != s.size) {
+        return false;
+    }
+
+    in >> s.minTime >> s.maxTime >> s.levelMask >> s.count >> nSparse;
+    s.sparse.resize(static_cast<int>(nSparse));
+    for (quint32 i=0; i<nSparse; ++i) {
+        in >> s.sparse[i].first >> s.sparse[i].second;
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+void LogStore::saveIndex(const Segment &s) const {
+    QFile f(indexPath(s.seq));
+    if (!f.open(QFile::WriteOnly | QFile::Truncate)) {
+        qDebug() << "LogStore: cannot write" << f.fileName();
+        return;
+    }
+
+    QDataStream out(&f);
+    out << IndexMagic << IndexVersion << s.size;
+    out << s.minTime << s.maxTime << s.levelMask << s.count;
+    out << static_cast<quint32>(s.sparse.size());
+    for (int i=0; i<s.sparse.size(); ++i) {
+        out << s.sparse[i].first << s.sparse[i].second;
+    }
+}
+
+// Rebuild the index from the records, drop a partly written last record
+void LogStore::scanSegment(Segment &s) {
+    int seq = s.seq;
+    s = Segment();
+    s.seq = seq;
+
+    QFile f(segmentPath(seq));
+    if (!f.open(QFile::ReadWrite)) {
+        return;
+    }
+    QByteArray data(f.readAll());
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+
+    qint64 offset = 0;
+    while (offset + RecordHeaderSize <= data.size()) {
+        quint32 length = qFromLittleEndian<quint32>(p + offset);
+        if (length < RecordHeaderSize - 4 || offset + 4 + length > data.size()) {
+            break;
+        }
+        qint64 time = qFromLittleEndian<qint64>(p + offset + 4);
+        quint8 level = p[offset + 12];
+        s.add(time, level, offset);
+        offset += 4 + length;
+    }
+
+    if (offset != data.size()) {
+        qDebug() << "LogStore: truncating" << f.fileName() << "at" << offset;
+        f.resize(offset);
+    }
+    s.size = offset;
+}
+
+void LogStore::append(const LogEntry &entry) {
+    if (!m_active.isOpen()) {
+        return;
+    }
+    qint64 time = entry.time;
+    quint8 level = entry.level;
+
+    QByteArray tunnelUtf8(entry.tunnel.toUtf8().left(0xffff));
+    QByteArray textUtf8(entry.text.toUtf8());
+    quint32 length = RecordHeaderSize - 4 + tunnelUtf8.size() + textUtf8.size();
+
+    QByteArray record(RecordHeaderSize, '\0');
+    uchar *p = reinterpret_cast<uchar *>(record.data());
+    qToLittleEndian<quint32>(length, p);
+    qToLittleEndian<qint64>(time, p + 4);
+    p[12] = level;
+    p[13] = entry.source;
+    qToLittleEndian<quint16>(static_cast<quint16>(tunnelUtf8.size()), p + 14);
+    record += tunnelUtf8;
+    record += textUtf8;
+
+    if (m_segments.last().size > 0
+        && m_segments.last().size + record.size() > SegmentSize) {
+        rotate();
+        if (!m_active.isOpen()) {
+            return;
+        }
+    }
+
+    Segment &s = m_segments.last();
+    if (m_active.write(record) != record.size()) {
+        qDebug() << "LogStore: write failed:" << m_active.errorString();
+        return;
+    }
+    // Searches read the file, don't keep anything in the buffer
+    m_active.flush();
+
+    s.add(time, level, s.size);
+    s.size += record.size();
+}
+
+QList<LogEntry> LogStore::search(const LogQuery &query) const {
+    QList<LogEntry> results;
+    QByteArray tunnel(query.tunnel.toUtf8());
+
+    // Newest first, until we have enough
+    for (int i=m_segments.size() - 1; i >= 0 && results.size() < query.limit; --i) {
+        const Segment &s = m_segments[i];
+        if (!matchesSegment(s, query)) {
+            continue;
+        }
+
+        QList<LogEntry> found;
+        searchSegment(s, query, tunnel, [&found](const LogEntry &entry) {
+            found.append(entry);
+            return true;
+        });
+        found.append(results);
+        results.swap(found);
+    }
+
+    while (results.size() > query.limit) {
+        results.removeFirst();
+    }
+    return results;
+}
+
+void LogStore::forEach(const LogQuery &query, const Visitor &visit) const {
+    QByteArray tunnel(query.tunnel.toUtf8());
+
+    foreach (const Segment &s, m_segments) {
+        if (!matchesSegment(s, query)) {
+            continue;
+        }
+        if (!searchSegment(s, query, tunnel, visit)) {
+            return;
+        }
+    }
+}
+
+bool LogStore::matchesSegment(const Segment &s, const LogQuery &query) const {
+    return s.count > 0
+        && s.maxTime >= query.from && s.minTime <= query.to
+        && (s.levelMask & query.levelMask) != 0;
+}
+
+QList<LogStore::SegmentFile> LogStore::getSegmentFiles() const {
+    QList<SegmentFile> files;
+    foreach (const Segment &s, m_segments) {
+        SegmentFile f;
+        f.path = segmentPath(s.seq);
+        f.size = s.size;
+        files.append(f);
+    }
+    return files;
+}
+
+bool LogStore::forEachInSegment(const SegmentFile &file, const Visitor &visit,
+                                const LogQuery &query) {
+    return searchFile(file.path, 0, file.size, query, query.tunnel.toUtf8(), visit);
+}
+
+// Returns false if visit asked to stop
+bool LogStore::searchSegment(const Segment &s, const LogQuery &query,
+                             const QByteArray &tunnel, const Visitor &visit) const {
+    // Start from the last indexed record before the range
+    qint64 start = 0;
+    for (int i=0; i<s.sparse.size() && s.sparse[i].first < query.from; ++i) {
+        start = s.sparse[i].second;
+    }
+    return searchFile(segmentPath(s.seq), start, s.size, query, tunnel, visit);
+}
+
+// Records between start and end (offsets of record boundaries)
+bool LogStore::searchFile(const QString &path, qint64 start, qint64 end,
+                          const LogQuery &query, const QByteArray &tunnel,
+                          const Visitor &visit) {
+    QFile f(path);
+    if (!f.open(QFile::ReadOnly)) {
+        return true;
+    }
+    if (!f.seek(start)) {
+        return true;
+    }
+    QByteArray data(f.read(end - start));
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+
+    qint64 offset = 0;
+    while (offset + RecordHeaderSize <= data.size()) {
+        quint32 length = qFromLittleEndian<quint32>(p + offset);
+        qint64 next = offset + 4 + length;
+        if (next > data.size()) {
+            break;
+        }
+
+        qint64 time = qFromLittleEndian<qint64>(p + offset + 4);
+        quint8 level = p[offset + 12];
+        quint8 source = p[offset + 13];
+        int tunnelSize = qFromLittleEndian<quint16>(p + offset + 14);
+        if (RecordHeaderSize + tunnelSize > 4 + static_cast<qint64>(length)) {
+            // Corrupted, the rest of the segment can't be trusted
+            break;
+        }
+        const char *tunnelData = data.constData() + offset + RecordHeaderSize;
+        const char *textData = tunnelData + tunnelSize;
+        int textSize = static_cast<int>(next - (offset + RecordHeaderSize) - tunnelSize);
+        offset = next;
+
+        if (time > query.to) {
+            break;
+        }
+        if (time < query.from || (query.levelMask & (1 << level)) == 0) {
+            continue;
+        }
+        if (!tunnel.isEmpty()
+            && (tunnelSize != tunnel.size() || memcmp(tunnelData, tunnel.constData(), tunnelSize) != 0)) {
+            continue;
+        }
+
+        QString text(QString::fromUtf8(textData, textSize));
+        if (!query.text.isEmpty() && !text.contains(query.text, Qt::CaseInsensitive)) {
+            continue;
+        }
+
+        LogEntry e;
+        e.time = time;
+        e.level = level;
+        e.source = source;
+        e.tunnel = QString::fromUtf8(tunnelData, tunnelSize);
+        e.text = text;
+        if (!visit(e)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,115 @@
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QList>
+#include <QVector>
+#include <QPair>
+#include <QString>
+#include <functional>
+
+#include "logentry.h"
+
+struct LogQuery {
+    qint64 from;
+    qint64 to;
+    quint8 levelMask;   // 1 << LogEntry::Level
+    QString tunnel;     // empty for any
+    QString text;       // case insensitive substring, empty for any
+    int limit;          // most recent matches kept
+
+    LogQuery();
+};
+
+/*
+ * Persistent log, shared by all the tunnels.
+ *
+ * Append-only segments (<seq>.seg) rotated at SegmentSize, the oldest
+ * deleted past MaxSegments. Each record is:
+ *   u32 length (of what follows), i64 time, u8 level, u8 source,
+ *   u16 tunnel length, tunnel (UTF-8), text (UTF-8)
+ * all little endian.
+ *
+ * Every segment has an index (<seq>.idx) with its time range, the levels
+ * it contains and the offset of every IndexInterval-th record, so a search
+ * skips whole segments and seeks close to the start of a time range.
+ * The index of the segment being written is kept in memory and only saved
+ * on rotation/close, it's rebuilt from the segment after a crash.
+ */
+class LogStore : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        AllLevels = 0xff,
+        SegmentSize = 4 * 1024 * 1024,
+        MaxSegments = 16,
+        IndexInterval = 128,
+    };
+
+    explicit LogStore(QObject *parent = nullptr);
+    ~LogStore();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+
+    void append(const LogEntry &entry);
+
+    // Chronological order, at most query.limit entries (the most recent).
+    // Reads one segment at a time.
+    QList<LogEntry> search(const LogQuery &query) const;
+
+    // Every match in chronological order, query.limit is ignored.
+    // Stops when visit returns false. Reads one segment at a time.
+    typedef std::function<bool(const LogEntry &entry)> Visitor;
+    void forEach(const LogQuery &query, const Visitor &visit) const;
+
+    // For readers on another thread: the segments as they are now, oldest
+    // first, and how to read them without touching the LogStore.
+    // forEachInSegment() returns false if visit asked to stop.
+    struct SegmentFile {
+        QString path;
+        qint64 size;
+    };
+    QList<SegmentFile> getSegmentFiles() const;
+    static bool forEachInSegment(const SegmentFile &file, const Visitor &visit,
+                                 const LogQuery &query = LogQuery());
+
+private:
+    struct Segment {
+        int seq;
+        qint64 size;
+        qint64 minTime;
+        qint64 maxTime;
+        quint8 levelMask;
+        quint32 count;
+        // (time, offset) of every IndexInterval-th record
+        QVector<QPair<qint64, qint64> > sparse;
+
+        Segment();
+        void add(qint64 time, quint8 level, qint64 offset);
+    };
+
+    QString segmentPath(int seq) const;
+    QString indexPath(int seq) const;
+    bool loadIndex(Segment &s) const;
+    void saveIndex(const Segment &s) const;
+    void scanSegment(Segment &s);
+    bool openActive();
+    void rotate();
+    bool matchesSegment(const Segment &s, const LogQuery &query) const;
+    bool searchSegment(const Segment &s, const LogQuery &query,
+                       const QByteArray &tunnel, const Visitor &visit) const;
+    static bool searchFile(const QString &path, qint64 start, qint64 end,
+                           const LogQuery &query, const QByteArray &tunnel,
+                           const Visitor &visit);
+
+    QDir m_dir;
+    QList<Segment> m_segments;
+    QFile m_active;
+};
+
+#endif // LOGSTORE_H
@@ -4,11 +4,18 @@
 
 #include <QApplication>
 #include <QClipboard>
+#include <QDateTime>
+#include <QFileDialog>
+#include <QMessageBox>
 #include <QDebug>
 
+#include "logexport.h"
+
 LogWindow::LogWindow(QWidget *parent, const VPNGUI &vpngui, const OpenVPN &openvpn)
     : QWidget(parent)
     , m_openvpn(openvpn)
+    , m_logStore(vpngui.getLogStore())
+    , m_poller(vpngui.getTunnels().getStatusPoller(&openvpn))
     , ui(new Ui::LogWindow)
 {
     ui->setupUi(this);
@@ -16,12 +23,25 @@ LogWindow::LogWindow(QWidget *parent, const VPNGUI &vpngui, const OpenVPN &openv
 
     connect(ui->closeButton, SIGNAL(clicked(bool)), this, SLOT(close()));
     connect(ui->copyButton, SIGNAL(clicked(bool)), this, SLOT(copyLog()));
+    connect(ui->exportButton, SIGNAL(clicked(bool)), this, SLOT(exportLog()));
+    ui->copyButton->setToolTip(tr("Copy the last %1 lines").arg(MaxCopyLines));
+
+    m_searchTimer.setSingleShot(true);
+    m_searchTimer.setInterval(300);
+    connect(&m_searchTimer, SIGNAL(timeout()), this, SLOT(search()));
+    connect(ui->searchEdit, SIGNAL(textChanged(QString)), this, SLOT(filterChanged()));
+    connect(ui->levelBox, SIGNAL(currentIndexChanged(int)), this, SLOT(search()));
 
-    connect(&openvpn, SIGNAL(logUpdated(QString)), this, SLOT(newLogLine(QString)));
+    connect(&openvpn, SIGNAL(logUpdated(LogEntry)), this, SLOT(newLogLine(LogEntry)));
     connect(&openvpn, SIGNAL(statusUpdated(OpenVPN::Status)), this, SLOT(statusUpdated(OpenVPN::Status)));
 
-    foreach (QString line, m_openvpn.getLog()) {
-        appendLine(line);
+    foreach (const LogEntry &entry, m_openvpn.getLog()) {
+        appendLine(entry);
+    }
+
+    if (m_poller) {
+        connect(m_poller, SIGNAL(snapshotUpdated()), this, SLOT(snapshotUpdated()));
+        snapshotUpdated();
     }
 
     statusUpdated(openvpn.getStatus());
@@ -29,37 +49,177 @@ LogWindow::LogWindow(QWidget *parent, const VPNGUI &vpngui, const OpenVPN &openv
 
 LogWindow::~LogWindow()
 {
+    if (m_poller) {
+        m_poller->setFast(false);
+    }
     delete ui;
 }
 
-void LogWindow::appendLine(const QString &line) {
-    if (line.startsWith('#')) {
+const OpenVPN &LogWindow::getOpenVPN() const {
+    return m_openvpn;
+}
+
+void LogWindow::appendLine(const LogEntry &entry, bool showTime) {
+    if (entry.level == LogEntry::Error) {
+        ui->log->setTextColor(QColor("#ff5555"));
+    } else if (entry.level == LogEntry::Warning) {
+        ui->log->setTextColor(QColor("#ff8c00"));
+    } else if (entry.source == LogEntry::Status) {
         ui->log->setTextColor(QColor("#eeeeee"));
-        ui->log->append(line);
-    } else if (line.startsWith('>')) {
+    } else if (entry.source == LogEntry::Management) {
         ui->log->setTextColor(QColor("#aaaaaa"));
-        ui->log->append(line);
     } else {
         ui->log->setTextColor(QColor("#ffbf00"));
-        ui->log->append(line);
+    }
+
+    if (showTime) {
+        QString timeStr(QDateTime::fromMSecsSinceEpoch(entry.time).toString("yyyy-MM-dd hh:mm:ss"));
+        ui->log->append(timeStr + " " + entry.text);
+    } else {
+        ui->log->append(entry.text);
     }
 }
 
-void LogWindow::newLogLine(const QString &line) {
-    appendLine(line);
+void LogWindow::newLogLine(const LogEntry &entry) {
+    if (!isFiltering()) {
+        appendLine(entry);
+        return;
+    }
+
+    // Same test as LogStore::search()
+    LogQuery q(getQuery());
+    if ((q.levelMask & (1 << entry.level)) == 0
+        || !entry.text.contains(q.text, Qt::CaseInsensitive)) {
+        return;
+    }
+    appendLine(entry, true);
+}
+
+bool LogWindow::isFiltering() const {
+    return !ui->searchEdit->text().isEmpty() || ui->levelBox->currentIndex() > 0;
+}
+
+LogQuery LogWindow::getQuery() const {
+    LogQuery q;
+    q.tunnel = m_openvpn.getName();
+    q.text = ui->searchEdit->text();
+
+    // All, Info and above, Warnings and errors, Errors
+    int minLevel = ui->levelBox->currentIndex();
+    q.levelMask = 0;
+    for (int l=LogEntry::Debug; l <= LogEntry::Error; ++l) {
+        if (l >= minLevel) {
+            q.levelMask |= (1 << l);
+        }
+    }
+    return q;
+}
+
+void LogWindow::filterChanged() {
+    m_searchTimer.start();
+}
+
+// Filtering shows the matching history from disk, with timestamps.
+// Without a filter, back to this session's log.
+void LogWindow::search() {
+    m_searchTimer.stop();
+    ui->log->clear();
+
+    if (!isFiltering()) {
+        foreach (const LogEntry &entry, m_openvpn.getLog()) {
+            appendLine(entry);
+        }
+        return;
+    }
+
+    foreach (const LogEntry &entry, m_logStore.search(getQuery())) {
+        appendLine(entry, true);
+    }
 }
 
 void LogWindow::statusUpdated(OpenVPN::Status s) {
     ui->statusLabel->setText(getStatusString(s));
 }
 
+void LogWindow::snapshotUpdated() {
+    const StatusSnapshot &s = m_poller->getSnapshot();
+    if (!s.valid) {
+        ui->detailsLabel->clear();
+        return;
+    }
+
+    QStringList parts;
+    parts << tr("IP: %1").arg(s.localIP);
+    if (!s.localIPv6.isEmpty()) {
+        parts << s.localIPv6;
+    }
+    parts << tr("Remote: %1:%2").arg(s.remoteIP).arg(s.remotePort);
+    if (!s.cipher.isEmpty()) {
+        parts << tr("Cipher: %1").arg(s.cipher);
+    }
+    parts << tr("Received: %1 (%2/s)").arg(formatBytes(s.linkRead), formatBytes(s.readRate));
+    parts << tr("Sent: %1 (%2/s)").arg(formatBytes(s.linkWrite), formatBytes(s.writeRate));
+    ui->detailsLabel->setText(parts.join("  "));
+}
+
+void LogWindow::showEvent(QShowEvent *event) {
+    QWidget::showEvent(event);
+    if (m_poller) {
+        m_poller->setFast(true);
+    }
+}
+
+void LogWindow::hideEvent(QHideEvent *event) {
+    QWidget::hideEvent(event);
+    if (m_poller) {
+        m_poller->setFast(false);
+    }
+}
+
 void LogWindow::copyLog() {
     QClipboard *clipboard = QApplication::clipboard();
+    const QList<LogEntry> &log = m_openvpn.getLog();
+    int first = qMax(0, log.size() - MaxCopyLines);
+
+    int size = 0;
+    for (int i=first; i<log.size(); ++i) {
+        size += log[i].text.size() + 1;
+    }
 
     QString plaintextLog;
-    foreach (QString line, m_openvpn.getLog()) {
-        plaintextLog.append(line + "\n");
+    plaintextLog.reserve(size);
+    for (int i=first; i<log.size(); ++i) {
+        plaintextLog.append(log[i].text);
+        plaintextLog.append('\n');
     }
 
     clipboard->setText(plaintextLog);
 }
+
+// With a filter, what matches it in the whole history, else this session.
+void LogWindow::exportLog() {
+    QString name(QString("%1-%2.log.gz").arg(m_openvpn.getName().isEmpty() ? "log" : m_openvpn.getName(),
+                                             QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+    QString path(QFileDialog::getSaveFileName(this, tr("Export log"), name,
+                                              tr("Compressed log (*.log.gz);;Text log (*.log *.txt)")));
+    if (path.isEmpty()) {
+        return;
+    }
+
+    LogExportJob *job;
+    if (isFiltering()) {
+        job = new LogExportJob(path, m_logStore.getSegmentFiles(), getQuery());
+    } else {
+        job = new LogExportJob(path, m_openvpn.getLog());
+    }
+    connect(job, SIGNAL(finished(QString,bool,QString)), this, SLOT(exportFinished(QString,bool,QString)));
+    ui->exportButton->setEnabled(false);
+    job->start();
+}
+
+void LogWindow::exportFinished(const QString &path, bool ok, const QString &error) {
+    ui->exportButton->setEnabled(true);
+    if (!ok) {
+        QMessageBox::warning(this, tr("Export log"), tr("Cannot write %1: %2").arg(path, error));
+    }
+}
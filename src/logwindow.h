@@ -2,8 +2,12 @@
 #define LOGWINDOW_H
 
 #include <QWidget>
+#include <QPointer>
+#include <QTimer>
 
 #include "openvpn.h"
+#include "statuspoller.h"
+#include "logstore.h"
 
 namespace Ui {
 class LogWindow;
@@ -17,18 +21,43 @@ class LogWindow : public QWidget
     Q_OBJECT
 
 public:
+    enum {
+        // The clipboard gets the most recent lines only, export for the rest
+        MaxCopyLines = 2000,
+    };
+
     explicit LogWindow(QWidget *parent, const VPNGUI &vpngui, const OpenVPN &openvpn);
     ~LogWindow();
 
+    const OpenVPN &getOpenVPN() const;
+
 public slots:
-    void newLogLine(const QString &line);
+    void newLogLine(const LogEntry &entry);
     void statusUpdated(OpenVPN::Status s);
+    void snapshotUpdated();
     void copyLog();
+    void exportLog();
+
+private slots:
+    void filterChanged();
+    void search();
+    void exportFinished(const QString &path, bool ok, const QString &error);
+
+protected:
+    // Poll the status faster while visible
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
 
 private:
-    void appendLine(const QString &line);
+    void appendLine(const LogEntry &entry, bool showTime = false);
+    bool isFiltering() const;
+    LogQuery getQuery() const;
 
     const OpenVPN &m_openvpn;
+    const LogStore &m_logStore;
+    QPointer<StatusPoller> m_poller;
+    // Don't search on every key press
+    QTimer m_searchTimer;
     Ui::LogWindow *ui;
 };
 
@@ -0,0 +1,337 @@
+#include "loopbackbench.h"
+#include "vpncore.h"
+#include "config.h"
+
+#include <stdexcept>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTcpServer>
+#include <QTextStream>
+#include <QUdpSocket>
+#include <QDebug>
+
+// openvpn config quoting
+static QString quoted(const QString &path) {
+    QString s(path);
+    s.replace("\\", "\\\\").replace("\"", "\\\"");
+    return "\"" + s + "\"";
+}
+
+static int pickLocalPort(bool udp) {
+    if (udp) {
+        QUdpSocket s;
+        s.bind(QHostAddress::LocalHost, 0);
+        return s.localPort();
+    }
+    QTcpServer s;
+    s.listen(QHostAddress::LocalHost, 0);
+    return s.serverPort();
+}
+
+LoopbackBenchmark::LoopbackBenchmark(VPNCore &core, const QString &openvpnPath,
+                                     const QString &serverConfig, int rounds)
+    : QObject(nullptr)
+    , m_core(core)
+    , m_openvpnPath(openvpnPath)
+    , m_serverConfig(QFileInfo(serverConfig).absoluteFilePath())
+    , m_rounds(rounds)
+    , m_tuned(false)
+    , m_port(0)
+    , m_stage(Idle)
+    , m_restarts(0)
+    , m_client(nullptr)
+{
+    m_server.setProcessChannelMode(QProcess::MergedChannels);
+    connect(&m_server, SIGNAL(readyRead()), this, SLOT(serverOutput()));
+    connect(&m_server, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(serverFinished()));
+
+    m_timeout.setSingleShot(true);
+    m_timeout.setInterval(StepTimeout);
+    connect(&m_timeout, SIGNAL(timeout()), this, SLOT(timeout()));
+}
+
+LoopbackBenchmark::~LoopbackBenchmark() {
+    m_stage = Idle;
+    delete m_client;
+    if (m_server.state() != QProcess::NotRunning) {
+        m_server.kill();
+        m_server.waitForFinished(1000);
+    }
+}
+
+void LoopbackBenchmark::start() {
+    // Any credentials, from a file so nobody is asked
+    if (!m_credentials.open()) {
+        m_result["error"] = "cannot create the credentials file";
+        emit finished(m_result);
+        return;
+    }
+    m_credentials.write("benchmark\nbenchmark\n");
+    m_credentials.close();
+
+    foreach (const ProtocolProbe::Target &t, getProtocolTargets()) {
+        Run run;
+        run.target = t;
+        run.tuned = false;
+        m_runs.append(run);
+        run.tuned = true;
+        m_runs.append(run);
+    }
+    nextTarget();
+}
+
+const QJsonObject &LoopbackBenchmark::getResult() const {
+    return m_result;
+}
+
+void LoopbackBenchmark::nextTarget() {
+    if (m_runs.isEmpty()) {
+        m_result["openvpn"] = QString(OPENVPN_VERSION);
+        m_result["version"] = m_core.getFullVersion();
+        m_result["rounds"] = m_rounds;
+        m_result["results"] = m_results;
+        emit finished(m_result);
+        return;
+    }
+
+    Run run(m_runs.takeFirst());
+    m_target = run.target;
+    m_tuned = run.tuned;
+    m_current = QJsonObject();
+    m_current["protocol"] = m_target.protocol;
+    m_current["buffers"] = m_tuned ? "tuned" : "default";
+    if (m_tuned) {
+        m_tuning = m_core.getSocketTuning(m_target.udp);
+        m_current["sndbuf"] = m_tuning.sndbuf;
+        m_current["rcvbuf"] = m_tuning.rcvbuf;
+        m_current["fast_io"] = m_tuning.fastIo;
+    }
+    m_connections = QJsonArray();
+    m_restarts = 0;
+    m_port = pickLocalPort(m_target.udp);
+
+    QStringList args;
+    args << "--config" << m_serverConfig
+         << "--dev" << "null"
+         << "--local" << "127.0.0.1"
+         << "--port" << QString::number(m_port)
+         << "--proto" << (m_target.udp ? "udp" : "tcp-server");
+
+    qDebug() << "Benchmark:" << m_target.protocol << m_current["buffers"].toString()
+             << "buffers, server on port" << m_port;
+    m_serverLog.clear();
+    m_stage = StartingServer;
+    m_server.setWorkingDirectory(QFileInfo(m_serverConfig).absolutePath());
+    m_server.start(m_openvpnPath, args);
+    m_timeout.start();
+}
+
+void LoopbackBenchmark::serverOutput() {
+    m_serverLog += m_server.readAll();
+    if (m_stage == StartingServer && m_serverLog.contains("Initialization Sequence Completed")) {
+        startClient();
+    }
+    // Enough to explain a failure
+    m_serverLog = m_serverLog.right(4096);
+}
+
+void LoopbackBenchmark::serverFinished() {
+    if (m_stage != Idle && m_stage != Stopping) {
+        fail("server exited");
+    }
+}
+
+void LoopbackBenchmark::startClient() {
+    QString path;
+    try {
+        // Nothing learned about real gateways goes in, nor is changed
+        path = m_core.makeOpenVPNConfig("127.0.0.1", QStringList(m_target.protocol),
+                                        QStringList("127.0.0.1"), false);
+    }
+    catch (std::exception &e) {
+        fail(e.what());
+        return;
+    }
+    if (!writeClientConfig(path)) {
+        fail("cannot write the client config");
+        return;
+    }
+
+    m_client = new OpenVPN(&m_core, m_openvpnPath);
+    m_client->setName("benchmark-" + m_target.protocol);
+    connect(m_client, SIGNAL(statusUpdated(OpenVPN::Status)), this, SLOT(clientStatus(OpenVPN::Status)));
+    connect(m_client, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+
+    m_stage = Connecting;
+    m_timeout.start();
+    m_client->connect(path);
+}
+
+void LoopbackBenchmark::clientStatus(OpenVPN::Status s) {
+    if (s != OpenVPN::Connected || (m_stage != Connecting && m_stage != Restarting)) {
+        return;
+    }
+
+    m_connections.append(m_client->getTimings().toJson());
+    if (!m_current.contains("socket_buffers")) {
+        m_current["socket_buffers"] = socketBuffers();
+    }
+
+    if (m_restarts < m_rounds && m_client->restart()) {
+        m_restarts++;
+        m_stage = Restarting;
+        m_timeout.start();
+        return;
+    }
+
+    m_current["connections"] = m_connections;
+    m_results.append(m_current);
+    stopTarget();
+}
+
+void LoopbackBenchmark::fail(const QString &error) {
+    if (m_stage == Idle || m_stage == Stopping) {
+        return;
+    }
+    qDebug() << "Benchmark:" << m_target.protocol << "failed:" << error;
+
+    m_current["error"] = error;
+    m_current["server_log"] = QString::fromLocal8Bit(m_serverLog);
+    m_current["connections"] = m_connections;
+    m_results.append(m_current);
+    stopTarget();
+}
+
+void LoopbackBenchmark::timeout() {
+    if (m_stage != Stopping) {
+        fail("timeout");
+        return;
+    }
+
+    // The client doesn't want to stop, its destructor kills it
+    delete m_client;
+    m_client = nullptr;
+    clientDisconnected();
+}
+
+void LoopbackBenchmark::stopTarget() {
+    m_stage = Stopping;
+    m_timeout.start();
+    if (m_client && m_client->getStatus() != OpenVPN::Disconnected) {
+        // clientDisconnected() follows
+        m_client->disconnect();
+        return;
+    }
+    clientDisconnected();
+}
+
+void LoopbackBenchmark::clientDisconnected() {
+    if (m_stage != Stopping) {
+        fail("client disconnected");
+        return;
+    }
+    m_timeout.stop();
+
+    // From its own signal, can't be deleted right away
+    if (m_client) {
+        m_client->deleteLater();
+        m_client = nullptr;
+    }
+
+    m_stage = Idle;
+    m_server.kill();
+    m_server.waitForFinished(3000);
+    nextTarget();
+}
+
+// What the system gave, from openvpn's "Socket Buffers: R=[...] S=[...]"
+QString LoopbackBenchmark::socketBuffers() const {
+    static const QString prefix("Socket Buffers: ");
+    const QList<LogEntry> &log(m_client->getLog());
+    for (int i=log.size() - 1; i >= 0; --i) {
+        int pos = log[i].text.indexOf(prefix);
+        if (pos >= 0) {
+            return log[i].text.mid(pos + prefix.size()).trimmed();
+        }
+    }
+    return QString();
+}
+
+// The server's CA, as a config option or inline block, empty if none
+QString LoopbackBenchmark::serverCa() const {
+    QFile f(m_serverConfig);
+    if (!f.open(QFile::ReadOnly)) {
+        return QString();
+    }
+
+    QString inlineCa;
+    bool inCa = false;
+    foreach (QString line, QString::fromUtf8(f.readAll()).split('\n')) {
+        line = line.trimmed();
+        if (inCa) {
+            inlineCa += line + "\n";
+            if (line == "</ca>") {
+                return inlineCa;
+            }
+            continue;
+        }
+        if (line == "<ca>") {
+            inCa = true;
+            inlineCa = line + "\n";
+        } else if (line.startsWith("ca ")) {
+            QString file(line.mid(3).trimmed());
+            if (file.startsWith('"') && file.endsWith('"')) {
+                file = file.mid(1, file.size() - 2);
+            }
+            QDir dir(QFileInfo(m_serverConfig).absolutePath());
+            return "ca " + quoted(QFileInfo(dir, file).absoluteFilePath()) + "\n";
+        }
+    }
+    return QString();
+}
+
+// The generated config, pointed at our server, with nothing that needs
+// admin rights
+bool LoopbackBenchmark::writeClientConfig(const QString &path) {
+    QFile f(path);
+    if (!f.open(QFile::ReadOnly)) {
+        return false;
+    }
+    QStringList lines(QString::fromUtf8(f.readAll()).split('\n'));
+    f.close();
+
+    QString ca(serverCa());
+    QString out;
+    bool skipping = false;
+    foreach (const QString &line, lines) {
+        if (skipping) {
+            skipping = line.trimmed() != "</ca>";
+            continue;
+        }
+        if (line.trimmed() == "<ca>" && !ca.isEmpty()) {
+            out += ca;
+            skipping = true;
+        } else if (line.startsWith("remote ")) {
+            out += QString("remote 127.0.0.1 %1 %2\n").arg(m_port).arg(m_target.udp ? "udp" : "tcp");
+        } else if (line.trimmed() == "auth-user-pass") {
+            out += "auth-user-pass " + quoted(m_credentials.fileName()) + "\n";
+        } else if (line.trimmed() == "register-dns") {
+            continue;
+        } else {
+            out += line + "\n";
+        }
+    }
+    out += "dev null\nifconfig-noexec\nroute-noexec\n";
+    if (m_tuned) {
+        out += QString("sndbuf %1\nrcvbuf %2\n").arg(m_tuning.sndbuf).arg(m_tuning.rcvbuf);
+        if (m_tuning.fastIo) {
+            out += "fast-io\n";
+        }
+    }
+
+    if (!f.open(QFile::WriteOnly | QFile::Truncate)) {
+        return false;
+    }
+    return f.write(out.toUtf8()) != -1;
+}
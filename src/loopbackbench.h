@@ -0,0 +1,115 @@
+#ifndef LOOPBACKBENCH_H
+#define LOOPBACKBENCH_H
+
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QProcess>
+#include <QTemporaryFile>
+#include <QTimer>
+
+#include "openvpn.h"
+#include "protocolprobe.h"
+#include "sockettuning.h"
+
+class VPNCore;
+
+/*
+ * The whole client stack against a local openvpn server, for every
+ * protocol: makeOpenVPNConfig() output, without anything learned about
+ * the gateways or the network (pointed at 127.0.0.1, with
+ * "dev null" and no ifconfig/route, so nothing needs admin rights) run by
+ * a real OpenVPN manager. Each protocol is connected once, then restarted
+ * `rounds` times in the same process; the ConnectionTimings of every
+ * connection go in the JSON result. The core only writes the configs,
+ * a VPNCore::ConfigOnly one is enough.
+ *
+ * Every protocol runs twice: with openvpn's default socket buffers, then
+ * with the ones a real connect would use on this network
+ * (VPNCore::getSocketTuning(), without txqueuelen: there's no tun). With
+ * "dev null" there's no traffic to time, the result has the connection
+ * timings and the buffers the system actually gave (openvpn's "Socket
+ * Buffers" line) for both.
+ *
+ * The server config is the caller's, in the spirit of OpenVPN's
+ * sample-config-files/loopback-server: its CA must be given with "ca",
+ * it's used by the client too. --dev, --local, --port and --proto are set
+ * here. Any username/password is sent. The client has the same framing
+ * as a real connect: with compression in the provider's features it has
+ * "compress lzo", so must the server.
+ */
+class LoopbackBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        StepTimeout = 30000,
+        Rounds = 3,
+    };
+
+    LoopbackBenchmark(VPNCore &core, const QString &openvpnPath,
+                      const QString &serverConfig, int rounds = Rounds);
+    ~LoopbackBenchmark();
+
+    void start();
+    // Also given by finished()
+    const QJsonObject &getResult() const;
+
+signals:
+    void finished(const QJsonObject &result);
+
+private slots:
+    void serverOutput();
+    void serverFinished();
+    void clientStatus(OpenVPN::Status s);
+    void clientDisconnected();
+    void timeout();
+
+private:
+    enum Stage {
+        Idle,
+        StartingServer,
+        Connecting,
+        Restarting,
+        Stopping,
+    };
+
+    void nextTarget();
+    void startClient();
+    void fail(const QString &error);
+    QString socketBuffers() const;
+    void stopTarget();
+    bool writeClientConfig(const QString &path);
+    QString serverCa() const;
+
+    VPNCore &m_core;
+    QString m_openvpnPath;
+    QString m_serverConfig;
+    int m_rounds;
+
+    struct Run {
+        ProtocolProbe::Target target;
+        bool tuned;
+    };
+    QList<Run> m_runs;
+    ProtocolProbe::Target m_target;
+    bool m_tuned;
+    SocketTuning m_tuning;
+    int m_port;
+    Stage m_stage;
+    int m_restarts;
+
+    QProcess m_server;
+    QByteArray m_serverLog;
+    OpenVPN *m_client;
+    QTemporaryFile m_credentials;
+    QTimer m_timeout;
+
+    QJsonObject m_result;
+    QJsonArray m_results;
+    QJsonObject m_current;
+    QJsonArray m_connections;
+};
+
+#endif // LOOPBACKBENCH_H
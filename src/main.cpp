@@ -1,23 +1,147 @@
 #include "config.h"
 #include "vpngui.h"
+#include "vpndaemon.h"
+#include "controlclient.h"
 #include "installer.h"
 #include "installergui.h"
+#include "cipherbench.h"
+#include "loopbackbench.h"
+#include "vpncore.h"
 #include <QApplication>
+#include <QCoreApplication>
 #include <QMessageBox>
 #include <QTranslator>
 #include <QLockFile>
 #include <QObject>
 #include <QCommandLineParser>
+#include <QScopedPointer>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QEventLoop>
+#include <QSet>
 #include <stdexcept>
 #include <fstream>
+#include <cstdio>
 
 
+// Has to be known before the Q*Application is created
+bool needsGUI(int argc, char *argv[]) {
+    QSet<QByteArray> headless;
+    headless << "--daemon" << "--connect" << "--disconnect" << "--status"
+             << "--gateways" << "--tail-log" << "--diagnostics" << "--cipher-benchmark"
+             << "--timings" << "--benchmark";
+
+    for (int i=1; i<argc; i++) {
+        QByteArray arg(argv[i]);
+        if (arg.contains('=')) {
+            arg = arg.left(arg.indexOf('='));
+        }
+        if (headless.contains(arg)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Forward a command to the running instance
+int runClient(const QJsonObject &request, bool follow, int timeout=5000) {
+    try {
+        Installer installer;
+        ControlClient client(ControlServer::socketName(installer));
+        if (!client.connectToInstance()) {
+            fprintf(stderr, "%s is not running.\n", VpnFeatures::name);
+            return 1;
+        }
+        return client.run(request, follow, timeout);
+    }
+    catch(std::exception &e) {
+        fprintf(stderr, "Exception: %s\n", e.what());
+        return 1;
+    }
+}
+
+// Local, doesn't need the running instance
+int runCipherBenchmark() {
+    printf("%s\n", qPrintable(CipherBenchmark::cacheKey()));
+    foreach (const CipherBenchmark::Result &r, CipherBenchmark::run(1000)) {
+        printf("%-20s %8.1f MB/s\n", qPrintable(r.cipher), r.mbPerSecond);
+    }
+    return 0;
+}
+
+// In this process, never through the control socket: the server config
+// is run by openvpn with our rights. Needs the instance lock, VPNCore owns
+// the install dir.
+int runBenchmark(const QString &serverConfig) {
+    try {
+        Installer installer;
+        if (installer.detectState() != Installer::Installed) {
+            fprintf(stderr, "%s is not installed, run it once without --benchmark.\n", VpnFeatures::name);
+            return 1;
+        }
+
+        QLockFile lockFile(installer.getDir().filePath("lvpngui.lock"));
+        if (!lockFile.tryLock(100)) {
+            fprintf(stderr, "%s is running, quit it before running the benchmark.\n", VpnFeatures::name);
+            return 1;
+        }
+
+        // Not the instance: no control socket, nothing measured or cleaned up
+        VPNCore core(installer, nullptr, VPNCore::ConfigOnly);
+        LoopbackBenchmark bench(core, installer.getDir().filePath("openvpn.exe"), serverConfig);
+        QEventLoop loop;
+        QObject::connect(&bench, SIGNAL(finished(QJsonObject)), &loop, SLOT(quit()), Qt::QueuedConnection);
+        bench.start();
+        loop.exec();
+
+        // JSON as is, for scripts and regression tracking
+        const QJsonObject &result = bench.getResult();
+        fprintf(stdout, "%s", QJsonDocument(result).toJson(QJsonDocument::Indented).constData());
+        return result.contains("error") ? 1 : 0;
+    }
+    catch(std::exception &e) {
+        fprintf(stderr, "Exception: %s\n", e.what());
+        return 1;
+    }
+}
+
+int runDaemon() {
+    try {
+        Installer installer;
+        if (installer.detectState() != Installer::Installed) {
+            fprintf(stderr, "%s is not installed, run it once without --daemon.\n", VpnFeatures::name);
+            return 1;
+        }
+
+        QLockFile lockFile(installer.getDir().filePath("lvpngui.lock"));
+        if (!lockFile.tryLock(100)) {
+            fprintf(stderr, "%s is already running.\n", VpnFeatures::name);
+            return 1;
+        }
+
+        VPNDaemon d(installer);
+        return QCoreApplication::exec();
+    }
+    catch(std::exception &e) {
+        fprintf(stderr, "Exception: %s\n", e.what());
+        return 1;
+    }
+}
+
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
-    a.setQuitOnLastWindowClosed(false);
+    bool gui = needsGUI(argc, argv);
+
+    QScopedPointer<QCoreApplication> app;
+    if (!gui) {
+        app.reset(new QCoreApplication(argc, argv));
+    } else {
+        app.reset(new QApplication(argc, argv));
+        QApplication::setQuitOnLastWindowClosed(false);
+        QApplication::setApplicationDisplayName(VpnFeatures::display_name);
+    }
+    QCoreApplication &a = *app;
     a.setApplicationName(VpnFeatures::name);
-    a.setApplicationDisplayName(VpnFeatures::display_name);
     a.setApplicationVersion(VPNGUI_VERSION);
 
     QTranslator translator;
@@ -34,6 +158,26 @@ int main(int argc, char *argv[])
     parser.addOption(checkInstallOpt);
     QCommandLineOption renameBinaryOpt("rename-binary");
     parser.addOption(renameBinaryOpt);
+    QCommandLineOption daemonOpt("daemon", "Run without GUI, controlled through the local control socket.");
+    parser.addOption(daemonOpt);
+    QCommandLineOption connectOpt("connect", "Connect the running instance to a gateway.", "hostname");
+    parser.addOption(connectOpt);
+    QCommandLineOption disconnectOpt("disconnect", "Disconnect the running instance.");
+    parser.addOption(disconnectOpt);
+    QCommandLineOption statusOpt("status", "Print the running instance status.");
+    parser.addOption(statusOpt);
+    QCommandLineOption gatewaysOpt("gateways", "List the running instance gateways.");
+    parser.addOption(gatewaysOpt);
+    QCommandLineOption tailLogOpt("tail-log", "Print the running instance log and follow it.");
+    parser.addOption(tailLogOpt);
+    QCommandLineOption diagnosticsOpt("diagnostics", "Save a diagnostics bundle from the running instance, prints its path.");
+    parser.addOption(diagnosticsOpt);
+    QCommandLineOption cipherBenchmarkOpt("cipher-benchmark", "Measure the data channel ciphers on this CPU.");
+    parser.addOption(cipherBenchmarkOpt);
+    QCommandLineOption timingsOpt("timings", "Print the connection timings of the running instance (JSON).");
+    parser.addOption(timingsOpt);
+    QCommandLineOption benchmarkOpt("benchmark", "Benchmark connecting to a local openvpn server run with the given config (JSON). The application must not be running.", "server-config");
+    parser.addOption(benchmarkOpt);
     parser.process(a);
 
     if (parser.isSet(renameBinaryOpt)) {
@@ -44,6 +188,41 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    if (parser.isSet(daemonOpt)) {
+        return runDaemon();
+    }
+
+    if (parser.isSet(cipherBenchmarkOpt)) {
+        return runCipherBenchmark();
+    }
+
+    if (parser.isSet(benchmarkOpt)) {
+        return runBenchmark(parser.value(benchmarkOpt));
+    }
+
+    if (!gui) {
+        QJsonObject request;
+        if (parser.isSet(connectOpt)) {
+            request["cmd"] = "connect";
+            request["host"] = parser.value(connectOpt);
+        } else if (parser.isSet(disconnectOpt)) {
+            request["cmd"] = "disconnect";
+        } else if (parser.isSet(gatewaysOpt)) {
+            request["cmd"] = "gateways";
+        } else if (parser.isSet(tailLogOpt)) {
+            request["cmd"] = "log";
+            request["follow"] = true;
+        } else if (parser.isSet(timingsOpt)) {
+            request["cmd"] = "timings";
+        } else if (parser.isSet(diagnosticsOpt)) {
+            request["cmd"] = "diagnostics";
+            return runClient(request, false, 120000);
+        } else {
+            request["cmd"] = "status";
+        }
+        return runClient(request, parser.isSet(tailLogOpt));
+    }
+
     try {
         Installer installer;
         QLockFile lockFile(installer.getDir().filePath("lvpngui.lock"));
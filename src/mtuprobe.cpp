@@ -0,0 +1,194 @@
+#include "mtuprobe.h"
+
+#include <cstring>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QThread>
+#include <QDebug>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#include <iphlpapi.h>
+#include <icmpapi.h>
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+MtuProbe::MtuProbe(const QString &address)
+    : QObject(nullptr)
+    , m_address(address)
+{}
+
+void MtuProbe::start() {
+    QThread *thread = new QThread;
+    moveToThread(thread);
+
+    connect(thread, SIGNAL(started()), this, SLOT(run()));
+    connect(thread, SIGNAL(finished()), this, SLOT(deleteLater()));
+    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+    thread->start(QThread::LowPriority);
+}
+
+void MtuProbe::run() {
+    int rtt = 0;
+    int mtu = probe(m_address, &rtt);
+    emit finished(m_address, mtu, rtt);
+    thread()->quit();
+}
+
+int MtuProbe::probe(const QString &address, int *rtt) {
+    QElapsedTimer timer;
+    timer.start();
+
+    int mtu = search([&address](int size) {
+        return echo(address, size);
+    }, rtt);
+
+    if (mtu > 0) {
+        qDebug() << "MTU probe:" << address << mtu << "in" << timer.elapsed() << "ms";
+    } else {
+        qDebug() << "MTU probe:" << address << "no answer";
+    }
+    return mtu;
+}
+
+int MtuProbe::search(const EchoFunction &echo, int *rtt) {
+    // Retried, a single lost echo isn't a black hole
+    auto fits = [&echo](int size) {
+        for (int i=0; i<Attempts; ++i) {
+            Result r = echo(size);
+            if (r != Lost) {
+                return r;
+            }
+        }
+        return Lost;
+    };
+
+    QElapsedTimer echoTimer;
+    echoTimer.start();
+    Result r = fits(MinMtu);
+    if (r != Fits) {
+        // Nothing to compare with
+        return 0;
+    }
+    if (rtt) {
+        *rtt = static_cast<int>(echoTimer.elapsed());
+    }
+    if (fits(MaxMtu) == Fits) {
+        return MaxMtu;
+    }
+
+    int low = MinMtu;
+    int high = MaxMtu;
+    while (high - low > Precision) {
+        int mid = (low + high) / 2;
+        if (fits(mid) == Fits) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+#ifdef _WIN32
+
+MtuProbe::Result MtuProbe::echo(const QString &address, int size) {
+    QHostAddress host(address);
+    if (host.protocol() != QAbstractSocket::IPv4Protocol) {
+        return Unavailable;
+    }
+
+    HANDLE icmp = IcmpCreateFile();
+    if (icmp == INVALID_HANDLE_VALUE) {
+        return Unavailable;
+    }
+
+    IP_OPTION_INFORMATION options;
+    memset(&options, 0, sizeof(options));
+    options.Ttl = 128;
+    options.Flags = IP_FLAG_DF;
+
+    QByteArray payload(size - Overhead, 'M');
+    QByteArray reply(sizeof(ICMP_ECHO_REPLY) + payload.size() + 8 + 64, '\0');
+
+    DWORD n = IcmpSendEcho(icmp, htonl(host.toIPv4Address()),
+                           payload.data(), static_cast<WORD>(payload.size()), &options,
+                           reply.data(), static_cast<DWORD>(reply.size()), EchoTimeout);
+    DWORD error = GetLastError();
+    IcmpCloseHandle(icmp);
+
+    if (n > 0) {
+        ICMP_ECHO_REPLY *r = reinterpret_cast<ICMP_ECHO_REPLY *>(reply.data());
+        if (r->Status == IP_SUCCESS) {
+            return Fits;
+        }
+        if (r->Status == IP_PACKET_TOO_BIG) {
+            return TooBig;
+        }
+        return Lost;
+    }
+    return error == IP_PACKET_TOO_BIG ? TooBig : Lost;
+}
+
+#else
+
+MtuProbe::Result MtuProbe::echo(const QString &address, int size) {
+    QHostAddress host(address);
+    if (host.protocol() != QAbstractSocket::IPv4Protocol) {
+        return Unavailable;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+    if (fd < 0) {
+        return Unavailable;
+    }
+
+#ifdef IP_MTU_DISCOVER
+    // DF set, and don't cap the size with the cached path MTU
+    int pmtu = IP_PMTUDISC_PROBE;
+    setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &pmtu, sizeof(pmtu));
+#endif
+
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(host.toIPv4Address());
+
+    // Echo request, the kernel sets the id and checksum
+    QByteArray packet(size - 20, 'M');
+    memset(packet.data(), 0, 8);
+    packet[0] = 8;
+
+    Result result = Lost;
+    if (sendto(fd, packet.constData(), packet.size(), 0,
+               reinterpret_cast<sockaddr *>(&sa), sizeof(sa)) < 0) {
+        result = errno == EMSGSIZE ? TooBig : Lost;
+    } else {
+        pollfd p;
+        p.fd = fd;
+        p.events = POLLIN;
+        p.revents = 0;
+        if (poll(&p, 1, EchoTimeout) > 0 && (p.revents & POLLIN)) {
+            char buf[2048];
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n > 0 && static_cast<unsigned char>(buf[0]) == 0) {
+                result = Fits;
+            } else if (n < 0 && errno == EMSGSIZE) {
+                result = TooBig;
+            }
+        }
+    }
+
+    close(fd);
+    return result;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef MTUPROBE_H
+#define MTUPROBE_H
+
+#include <QObject>
+#include <QString>
+#include <functional>
+
+/*
+ * Path MTU to an IPv4 address: ICMP echos with Don't Fragment set,
+ * binary search between MinMtu and MaxMtu. A size counts as too big if
+ * the router says so or if the echo is lost (black hole routers).
+ * Windows: IcmpSendEcho. Linux: unprivileged ICMP socket, where allowed
+ * by net.ipv4.ping_group_range.
+ *
+ * Blocking, a few seconds at worst: run() on a worker thread with start().
+ */
+class MtuProbe : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        MinMtu = 576,
+        MaxMtu = 1500,
+        Precision = 8,
+        EchoTimeout = 700,
+        Attempts = 2,
+        // IPv4 + ICMP headers
+        Overhead = 28,
+    };
+
+    enum Result {
+        Fits,
+        TooBig,
+        Lost,
+        Unavailable,
+    };
+
+    explicit MtuProbe(const QString &address);
+
+    // 0 if it can't be found (ICMP blocked or not allowed, IPv6).
+    // rtt: round trip time of a small echo, in ms.
+    static int probe(const QString &address, int *rtt = nullptr);
+    static Result echo(const QString &address, int size);
+
+    // The search itself, with any way of sending a packet of that size
+    typedef std::function<Result(int size)> EchoFunction;
+    static int search(const EchoFunction &echo, int *rtt = nullptr);
+
+    // probe() on a new thread, finished() is emitted on the thread that
+    // called start() and the probe deletes itself after that.
+    void start();
+
+signals:
+    void finished(const QString &address, int mtu, int rtt);
+
+private slots:
+    void run();
+
+private:
+    QString m_address;
+};
+
+#endif // MTUPROBE_H
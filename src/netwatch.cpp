@@ -0,0 +1,93 @@
+#include "netwatch.h"
+
+#include <QNetworkInterface>
+#include <QCryptographicHash>
+#include <QDebug>
+
+NetworkWatcher::NetworkWatcher(QObject *parent)
+    : QObject(parent)
+    , m_timer(this)
+{
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+void NetworkWatcher::start(int interval) {
+    reset();
+    m_timer.start(interval);
+}
+
+void NetworkWatcher::stop() {
+    m_timer.stop();
+}
+
+bool NetworkWatcher::isRunning() const {
+    return m_timer.isActive();
+}
+
+void NetworkWatcher::reset() {
+    m_snapshot = snapshot();
+}
+
+// Running, and neither loopback nor a tunnel: point-to-point (tun) and
+// TAP-Windows adapters (00:FF:...) come and go with our own tunnels
+static bool isNetworkInterface(const QNetworkInterface &iface) {
+    QNetworkInterface::InterfaceFlags flags = iface.flags();
+    if (flags & (QNetworkInterface::IsLoopBack | QNetworkInterface::IsPointToPoint)) {
+        return false;
+    }
+    if (!(flags & QNetworkInterface::IsUp) || !(flags & QNetworkInterface::IsRunning)) {
+        return false;
+    }
+    return !iface.hardwareAddress().startsWith("00:FF", Qt::CaseInsensitive);
+}
+
+QByteArray NetworkWatcher::snapshot() {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    foreach (QNetworkInterface iface, QNetworkInterface::allInterfaces()) {
+        if (!isNetworkInterface(iface)) {
+            continue;
+        }
+
+        hash.addData(iface.name().toUtf8());
+        foreach (QNetworkAddressEntry entry, iface.addressEntries()) {
+            hash.addData(entry.ip().toString().toUtf8());
+            hash.addData(QByteArray::number(entry.prefixLength()));
+        }
+    }
+
+    return hash.result();
+}
+
+QByteArray NetworkWatcher::networkId() {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    foreach (QNetworkInterface iface, QNetworkInterface::allInterfaces()) {
+        if (!isNetworkInterface(iface)) {
+            continue;
+        }
+
+        hash.addData(iface.hardwareAddress().toUtf8());
+        foreach (QNetworkAddressEntry entry, iface.addressEntries()) {
+            if (entry.ip().protocol() != QAbstractSocket::IPv4Protocol) {
+                continue;
+            }
+            quint32 subnet = entry.ip().toIPv4Address() & entry.netmask().toIPv4Address();
+            hash.addData(QByteArray::number(subnet));
+            hash.addData(QByteArray::number(entry.prefixLength()));
+        }
+    }
+
+    return hash.result();
+}
+
+void NetworkWatcher::poll() {
+    QByteArray current(snapshot());
+    if (current == m_snapshot) {
+        return;
+    }
+
+    qDebug() << "NetworkWatcher: network changed";
+    m_snapshot = current;
+    emit changed();
+}
@@ -0,0 +1,47 @@
+#ifndef NETWATCH_H
+#define NETWATCH_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QTimer>
+
+/*
+ * Polls the network interfaces and emits changed() when the set of
+ * running interfaces or their addresses differ from the last snapshot.
+ * Tunnel interfaces are left out: the watcher is shared by every tunnel,
+ * one going up must not look like a network change to the others.
+ * QNetworkConfigurationManager is too slow and unreliable on Windows
+ * for this, a cheap poll is good enough.
+ */
+class NetworkWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NetworkWatcher(QObject *parent = nullptr);
+
+    void start(int interval=2000);
+    void stop();
+    bool isRunning() const;
+
+    // Take the current state as the new reference, without emitting
+    // (ie: after our own tunnel interface went up)
+    void reset();
+
+    static QByteArray snapshot();
+
+    // The network we're on, stable across reconnects and DHCP leases:
+    // hardware addresses and IPv4 subnets, tunnels left out.
+    static QByteArray networkId();
+
+signals:
+    void changed();
+
+private slots:
+    void poll();
+
+private:
+    QTimer m_timer;
+    QByteArray m_snapshot;
+};
+
+#endif // NETWATCH_H
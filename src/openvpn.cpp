@@ -1,14 +1,13 @@
 #include "openvpn.h"
-#include "vpngui.h"
 #include "config.h"
 
-#include <stdexcept>
 #include <QDebug>
 #include <QTimer>
 #include <cryptopp/osrng.h>
 #include <QTcpServer>
 #include <QCoreApplication>
 #include <QApplication>
+#include <QFile>
 
 int pickPort() {
     QTcpServer s;
@@ -19,52 +18,100 @@ int pickPort() {
 }
 
 
-OpenVPN::OpenVPN(VPNGUI *parent, QString openvpnPath)
+ConnectionTimings::ConnectionTimings() {
+    reset(false);
+}
+
+void ConnectionTimings::reset(bool reconnect) {
+    this->reconnect = reconnect;
+    managementReady = handshake = connected = -1;
+    events = eventLatencyTotal = eventLatencyMax = 0;
+}
+
+QJsonObject ConnectionTimings::toJson() const {
+    QJsonObject o;
+    o["reconnect"] = reconnect;
+    o["management_ready_ms"] = managementReady;
+    o["handshake_ms"] = handshake;
+    o["connected_ms"] = connected;
+    o["events"] = events;
+    o["event_latency_avg_us"] = events ? eventLatencyTotal / events : 0;
+    o["event_latency_max_us"] = eventLatencyMax;
+    return o;
+}
+
+
+VPNCreds::VPNCreds() {}
+VPNCreds::~VPNCreds() {
+    clear();
+}
+
+void VPNCreds::clear() {
+    username.clear();
+    password.clear();
+}
+
+
+OpenVPN::OpenVPN(QObject *parent, QString openvpnPath)
     : QObject(parent)
-    , m_vpngui(parent)
     , m_openvpnPath(openvpnPath)
-    , m_openvpnProc(this)
+    , m_io(new OpenVPNIO)
+    , m_procRunning(false)
+    , m_mgmtReady(false)
     , m_status(Disconnected)
     , m_authFailed(false)
+    , m_abort(false)
+    , m_stopStage(StopTerminate)
     , m_mgmtHost("127.0.0.1")
     , m_mgmtPort(0)
 {
-    if (parent == nullptr) {
-        qDebug() << "OpenVPN(): *parent is required";
-        throw std::runtime_error("OpenVPN(): *parent is required");
-    }
-
-    QObject::connect(&m_openvpnProc, SIGNAL(readyRead()), this, SLOT(procReadyRead()));
-    QObject::connect(&m_openvpnProc, SIGNAL(error(QProcess::ProcessError)), this, SLOT(procError(QProcess::ProcessError)));
-    QObject::connect(&m_openvpnProc, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(procFinished(int,QProcess::ExitStatus)));
-
-    QObject::connect(&m_mgmtSocket, SIGNAL(readyRead()), this, SLOT(mgmtReadyRead()));
-    QObject::connect(&m_mgmtSocket, SIGNAL(connected()), this, SLOT(mgmtConnected()));
+    m_io->moveToThread(&m_ioThread);
+    QObject::connect(&m_ioThread, SIGNAL(finished()), m_io, SLOT(deleteLater()));
+    QObject::connect(m_io, SIGNAL(eventsReady()), this, SLOT(ioEventsReady()));
+    m_ioThread.start();
 
-    QObject::connect(&m_mgmtSocketTimer, SIGNAL(timeout()), this, SLOT(mgmtTryConnect()));
-    m_mgmtSocketTimer.setInterval(100);
+    QObject::connect(&m_stopTimer, SIGNAL(timeout()), this, SLOT(stopTimeout()));
+    m_stopTimer.setSingleShot(true);
 
-    logStatus(QString("%1 - %2 %3").arg(m_vpngui->getDisplayName(),
-                                        m_vpngui->getName(),
-                                        m_vpngui->getFullVersion()));
+    logStatus(QString("%1 - %2 %3").arg(VpnFeatures::display_name,
+                                        VpnFeatures::name,
+                                        VPNGUI_VERSION));
 }
 
 OpenVPN::~OpenVPN() {
-    m_mgmtSocket.close();
+    m_stopTimer.stop();
+    m_mgmtQueries.clear();
 
-    m_openvpnProc.terminate();
-    m_openvpnProc.waitForFinished(1000);
-    m_openvpnProc.kill();
+    // Too late to be nice, disconnect() first for a clean exit.
+    QMetaObject::invokeMethod(m_io, "shutdown", Qt::BlockingQueuedConnection);
+    m_ioThread.quit();
+    m_ioThread.wait();
 }
 
 bool OpenVPN::connect(const QString &configPath) {
+    if (m_procRunning) {
+        // Start again once the current one has exited
+        disconnect();
+        m_pendingConfigPath = configPath;
+        return true;
+    }
+    m_pendingConfigPath.clear();
+
     m_openvpnLog.clear();
-    m_mgmtSocket.close();
+    failManagementQueries();
+    m_io->sendCommand(OpenVPNCommand(OpenVPNCommand::MgmtAbort));
+    m_mgmtReady = false;
 
     m_mgmtPort = pickPort();
     QString portStr(QString::number(m_mgmtPort));
 
+    m_configPath = configPath;
     m_authFailed = false;
+    m_abort = false;
+    m_pendingAuthType.clear();
+    m_authToken.clear();
+    m_connectTimer.start();
+    m_timings.reset(false);
     setStatus(Connecting);
 
     logStatus(m_openvpnPath);
@@ -80,34 +127,186 @@ bool OpenVPN::connect(const QString &configPath) {
     args.append(m_mgmtHost);
     args.append(portStr);
 
+    // Wait for us before connecting, and after every restart.
+    // Lets us reuse this process to reconnect or switch gateway.
+    args.append("--management-hold");
+
     args.append("--management-query-passwords");
     args.append("--auth-retry");
     args.append("interact");
 
-    m_openvpnProc.start(m_openvpnPath, args);
+    OpenVPNCommand start(OpenVPNCommand::Start);
+    start.program = m_openvpnPath;
+    start.args = args;
+    m_io->sendCommand(start);
+    m_procRunning = true;
+
+    OpenVPNCommand mgmtConnect(OpenVPNCommand::MgmtConnect);
+    mgmtConnect.host = m_mgmtHost;
+    mgmtConnect.port = m_mgmtPort;
+    m_io->sendCommand(mgmtConnect);
 
-    m_mgmtSocketTimer.start();
+    return true;
+}
 
+// Restart the running openvpn in place (reconnect to the remote, keep the
+// process and its config). Returns false if that's not possible.
+bool OpenVPN::restart() {
+    if (!m_procRunning || !m_mgmtReady) {
+        return false;
+    }
+
+    logStatus("Restarting");
+    m_connectTimer.start();
+    m_timings.reset(true);
+    setStatus(Connecting);
+    mgmtSend("signal SIGUSR1");
     return true;
 }
 
+// Switch the running openvpn to another config (ie: another gateway)
+// without spawning a new process: the config file is replaced and openvpn
+// re-reads it on SIGHUP.
+// Falls back to a new process if openvpn isn't usable.
+bool OpenVPN::switchConfig(const QString &configPath) {
+    if (!m_procRunning || !m_mgmtReady || m_status == Disconnecting) {
+        return connect(configPath);
+    }
+
+    if (configPath != m_configPath) {
+        QFile::remove(m_configPath);
+        if (!QFile::rename(configPath, m_configPath)) {
+            logStatus("Cannot replace " + m_configPath + ", restarting openvpn");
+            return connect(configPath);
+        }
+    }
+
+    logStatus("Switching config: " + configPath);
+    m_authFailed = false;
+    m_pendingAuthType.clear();
+    m_authToken.clear();
+    m_connectTimer.start();
+    m_timings.reset(true);
+    setStatus(Connecting);
+    mgmtSend("signal SIGHUP");
+    return true;
+}
+
+/*
+ * Asynchronous stop, never blocks the event loop:
+ * 1. SIGTERM through the management socket, openvpn cleans up routes & co
+ * 2. QProcess::terminate() if it's still there after a while
+ * 3. QProcess::kill()
+ * disconnected() is emitted when the process is gone.
+ */
 void OpenVPN::disconnect() {
+    m_abort = true;
+    m_pendingConfigPath.clear();
+    m_pendingAuthType.clear();
+    m_authToken.clear();
+
+    if (!m_procRunning) {
+        if (m_status != Disconnected) {
+            setStatus(Disconnected);
+        }
+        return;
+    }
+
+    if (m_stopTimer.isActive()) {
+        // Already stopping
+        return;
+    }
+
     setStatus(Disconnecting);
+    m_io->sendCommand(OpenVPNCommand(OpenVPNCommand::MgmtCancelConnect));
 
-    if (m_openvpnProc.state() != QProcess::NotRunning) {
-        if (m_mgmtSocket.isOpen()) {
-            mgmtSend("signal SIGTERM");
-        }
-        m_openvpnProc.terminate();
-        m_openvpnProc.waitForFinished(1000);
-        m_openvpnProc.kill();
+    if (m_mgmtReady) {
+        mgmtSend("signal SIGTERM");
+        m_stopStage = StopTerminate;
+        m_stopTimer.start(3000);
+    } else {
+        m_io->sendCommand(OpenVPNCommand(OpenVPNCommand::Terminate));
+        m_stopStage = StopKill;
+        m_stopTimer.start(1000);
+    }
+}
+
+void OpenVPN::stopTimeout() {
+    if (!m_procRunning) {
+        return;
+    }
+
+    if (m_stopStage == StopTerminate) {
+        logStatus("openvpn did not exit, terminating");
+        m_io->sendCommand(OpenVPNCommand(OpenVPNCommand::Terminate));
+        m_stopStage = StopKill;
+        m_stopTimer.start(1000);
+    } else {
+        logStatus("openvpn did not exit, killing");
+        m_io->sendCommand(OpenVPNCommand(OpenVPNCommand::Kill));
     }
 }
 
 void OpenVPN::logStatus(const QString &line) {
     qDebug() << "OpenVPN: status:" << line;
-    m_openvpnLog.append("# " + line);
-    emit logUpdated("# " + line);
+    appendLog(LogEntry::Status, line, "# " + line);
+}
+
+// line is what gets classified, display what gets shown & stored
+void OpenVPN::appendLog(LogEntry::Source source, const QString &line, const QString &display) {
+    LogEntry entry(source, classify(source, line), m_name, display);
+    m_openvpnLog.append(entry);
+    emit logUpdated(entry);
+}
+
+LogEntry::Level OpenVPN::classify(LogEntry::Source source, const QString &line) {
+    if (source == LogEntry::Status) {
+        return line.startsWith(tr("Error:")) ? LogEntry::Error : LogEntry::Info;
+    }
+
+    if (source == LogEntry::Management) {
+        if (!line.startsWith('>')) {
+            // Command response
+            return line.startsWith(QLatin1String("ERROR:")) ? LogEntry::Error : LogEntry::Debug;
+        }
+        // ">LOG:<time>,<flags>,<message>", flags from openvpn's msg()
+        if (line.startsWith(QLatin1String(">LOG:"))) {
+            int start = line.indexOf(',');
+            int end = line.indexOf(',', start + 1);
+            if (start == -1 || end == -1) {
+                return LogEntry::Info;
+            }
+            QStringRef flags(line.midRef(start + 1, end - start - 1));
+            if (flags.contains('F') || flags.contains('N')) {
+                return LogEntry::Error;
+            } else if (flags.contains('W')) {
+                return LogEntry::Warning;
+            } else if (flags.contains('D')) {
+                return LogEntry::Debug;
+            }
+            return LogEntry::Info;
+        }
+        if (line.startsWith(QLatin1String(">FATAL:"))
+            || line.startsWith(QLatin1String(">PASSWORD:Verification Failed"))) {
+            return LogEntry::Error;
+        }
+        return LogEntry::Info;
+    }
+
+    // stdout has no flags, only the usual wording of msg(M_FATAL/M_ERR/M_WARN)
+    if (line.contains(QLatin1String("ERROR"))
+        || line.contains(QLatin1String("Error"))
+        || line.contains(QLatin1String("Options error"))
+        || line.contains(QLatin1String("AUTH_FAILED"))
+        || line.contains(QLatin1String("fatal error"))
+        || line.contains(QLatin1String("(code="))) {
+        return LogEntry::Error;
+    }
+    if (line.contains(QLatin1String("WARNING"))
+        || line.contains(QLatin1String("Warning"))) {
+        return LogEntry::Warning;
+    }
+    return LogEntry::Info;
 }
 
 bool OpenVPN::isUp() const {
@@ -118,109 +317,284 @@ OpenVPN::Status OpenVPN::getStatus() const {
     return m_status;
 }
 
+const ConnectionTimings &OpenVPN::getTimings() const {
+    return m_timings;
+}
+
 void OpenVPN::setStatus(Status s) {
     m_status = s;
+    if (s == Connected) {
+        // The credentials worked, next time start with them again
+        m_authFailed = false;
+    }
     emit statusUpdated(s);
     logStatus(tr("Status:") + " " + getStatusString(s));
 }
 
-void OpenVPN::procReadyRead() {
-    while (m_openvpnProc.canReadLine()) {
-        QString line(QString::fromLocal8Bit(m_openvpnProc.readLine()));
-
-        if (line.endsWith("\r\n")) {
-            line = line.left(line.size() - 2);
+// Everything the I/O thread has for us, in order
+void OpenVPN::ioEventsReady() {
+    OpenVPNEvent event;
+    while (m_io->takeEvent(event)) {
+        qint64 latency = OpenVPNEvent::now() - event.time;
+        m_timings.events++;
+        m_timings.eventLatencyTotal += latency;
+        m_timings.eventLatencyMax = qMax(m_timings.eventLatencyMax, latency);
+
+        switch (event.type) {
+        case OpenVPNEvent::ProcessLine:
+            procLine(event.text);
+            break;
+        case OpenVPNEvent::ProcessError:
+            procError(event.text, event.code != 0);
+            break;
+        case OpenVPNEvent::ProcessFinished:
+            procFinished(event.code);
+            break;
+        case OpenVPNEvent::MgmtConnected:
+            mgmtConnected();
+            break;
+        case OpenVPNEvent::MgmtDisconnected:
+            mgmtDisconnected();
+            break;
+        case OpenVPNEvent::MgmtLine:
+            mgmtLine(event.text);
+            break;
         }
+    }
+}
 
-        m_openvpnLog.append(line);
-        qDebug() << "ovpn:" << line;
+void OpenVPN::procLine(const QString &line) {
+    qDebug() << "ovpn:" << line;
+    appendLog(LogEntry::Process, line, line);
 
-        emit logUpdated(line);
+    if (line.contains("TLS: Initial packet from")) {
+        m_handshakeTimer.start();
+    } else if (line.contains("Peer Connection Initiated") && m_handshakeTimer.isValid()) {
+        m_timings.handshake = m_handshakeTimer.elapsed();
+        m_handshakeTimer.invalidate();
+    }
 
-        if (line.contains("Initialization Sequence Completed")) {
-            setStatus(Connected);
-        }
+    if (line.contains("Initialization Sequence Completed")) {
+        m_timings.connected = m_connectTimer.elapsed();
+        setStatus(Connected);
+        logStatus(QString("Connected in %1 ms").arg(m_timings.connected));
+        emit connected();
     }
 }
 
-void OpenVPN::procError(QProcess::ProcessError) {
-    logStatus(tr("Error:") + " " + m_openvpnProc.errorString());
+void OpenVPN::procError(const QString &error, bool notRunning) {
+    if (notRunning) {
+        // Failed to start: no finished event will come
+        m_procRunning = false;
+    }
+    logStatus(tr("Error:") + " " + error);
 }
 
-void OpenVPN::procFinished(int exitCode, QProcess::ExitStatus) {
+void OpenVPN::procFinished(int exitCode) {
     logStatus(tr("Finished:") + " code=" + QString::number(exitCode));
 
+    m_procRunning = false;
+    m_mgmtReady = false;
+    m_stopTimer.stop();
+    failManagementQueries();
+    m_io->sendCommand(OpenVPNCommand(OpenVPNCommand::MgmtAbort));
+
     setStatus(Disconnected);
+    emit disconnected();
+
+    if (!m_pendingConfigPath.isEmpty()) {
+        connect(m_pendingConfigPath);
+        return;
+    }
+
+    if (!m_abort) {
+        emit connectionLost();
+    }
 }
 
-const QStringList &OpenVPN::getLog() const {
+const QList<LogEntry> &OpenVPN::getLog() const {
     return m_openvpnLog;
 }
 
-void OpenVPN::mgmtTryConnect() {
-    qDebug() << "mgmtTryConnect(): " << m_mgmtSocket.state();
-
-    if (m_mgmtSocket.state() == QTcpSocket::ConnectedState) {
-        m_mgmtSocketTimer.stop();
-        return;
-    }
+const QString &OpenVPN::getConfigPath() const {
+    return m_configPath;
+}
 
-    // Abort and try again, hoping it's ready this time
-    m_mgmtSocket.abort();
-    m_mgmtSocket.close();
+void OpenVPN::setName(const QString &name) {
+    m_name = name;
+}
 
-    m_mgmtSocket.connectToHost(m_mgmtHost, static_cast<quint16>(m_mgmtPort));
+const QString &OpenVPN::getName() const {
+    return m_name;
 }
 
 void OpenVPN::mgmtConnected() {
-    m_mgmtSocketTimer.stop();
+    m_mgmtReady = true;
+    if (m_timings.managementReady < 0) {
+        m_timings.managementReady = m_connectTimer.elapsed();
+    }
     logStatus("Management socket ready");
     //mgmtSend("state all");
 }
 
-void OpenVPN::mgmtReadyRead() {
+void OpenVPN::mgmtDisconnected() {
+    m_mgmtReady = false;
+    failManagementQueries();
+}
+
+// Responses are still read while disconnecting, notifications are not
+// handled anymore.
+void OpenVPN::mgmtLine(QString line) {
+    // The session token must not end up in the log, the log store or a
+    // diagnostics bundle.
+    QString logged = line;
+    if (logged.startsWith(">PASSWORD:Auth-Token:")) {
+        logged = ">PASSWORD:Auth-Token:[redacted]";
+    }
+    qDebug() << "OpenVPN: mgmt:" << logged;
+
+    // Logging, display responses with ">>"
+    if (logged.startsWith('>')) {
+        appendLog(LogEntry::Management, logged, "> " + logged.mid(1));
+    } else if (m_mgmtQueries.isEmpty() || m_mgmtQueries.head().logResponse) {
+        appendLog(LogEntry::Management, logged, ">> " + logged);
+    }
+
+    // Handling
+    if (!line.startsWith('>')) {
+        handleManagementResponse(line);
+        return;
+    }
     if (m_status != Connected && m_status != Connecting) {
         return;
     }
-    while (m_mgmtSocket.canReadLine()) {
-        QString line(QString::fromLocal8Bit(m_mgmtSocket.readLine()));
+    line = line.mid(1);
 
-        if (line.endsWith("\r\n")) {
-            line = line.left(line.size() - 2);
-        }
+    handleManagementCommand(line);
+}
+
+bool OpenVPN::isManagementReady() const {
+    return m_mgmtReady;
+}
 
-        if (line.isEmpty()) {
-            continue;
+bool OpenVPN::queryManagement(const QString &command, MgmtCallback callback,
+                              bool logResponse) {
+    if (!isManagementReady()) {
+        if (callback) {
+            // Always asynchronous for the caller
+            QTimer::singleShot(0, this, [callback]() {
+                callback(false, QStringList("ERROR: management interface not connected"));
+            });
         }
+        return false;
+    }
 
-        qDebug() << "OpenVPN: mgmt:" << line;
+    MgmtQuery q;
+    q.command = command;
+    q.callback = callback;
+    q.logResponse = logResponse;
+    m_mgmtQueries.enqueue(q);
 
-        // Logging
-        QString logLine;
-        if (line.startsWith('>')) {
-            logLine = "> " + line.mid(1);
-        } else {
-            // Display responses with ">>"
-            logLine = ">> " + line;
-        }
+    OpenVPNCommand write(OpenVPNCommand::MgmtWrite);
+    write.data = (command + "\n").toLocal8Bit();
+    m_io->sendCommand(write);
+    return true;
+}
 
-        m_openvpnLog.append(logLine);
-        emit logUpdated(logLine);
+// Fire & forget, still queued to keep responses in sync
+void OpenVPN::mgmtSend(const QString &line) {
+    queryManagement(line, MgmtCallback(), true);
+}
 
-        // Handling
-        if (!line.startsWith('>')) {
-            // TODO: to handle command returning things, append that to a
-            // QStringList
-            continue;
+// Like mgmtSend(), but the line is only ever built in locked memory and the
+// value quoted, so it may contain spaces and quotes.
+void OpenVPN::mgmtSendCredential(const QString &command, const QString &type,
+                                 const SecureBuffer &value) {
+    if (!isManagementReady()) {
+        return;
+    }
+
+    QString header(command + " \"" + type + "\"");
+    QByteArray prefix((header + " \"").toLocal8Bit());
+
+    SecureBuffer line;
+    line.append(prefix.constData(), prefix.size());
+    for (int i=0; i<value.size(); ++i) {
+        char c = value.constData()[i];
+        if (c == '"' || c == '\\') {
+            line.append('\\');
         }
-        line = line.mid(1);
+        line.append(c);
+    }
+    line.append("\"\n", 2);
+
+    MgmtQuery q;
+    q.command = header;
+    q.logResponse = true;
+    m_mgmtQueries.enqueue(q);
 
-        handleManagementCommand(line);
+    OpenVPNCommand write(OpenVPNCommand::MgmtWrite);
+    write.secret = line;
+    m_io->sendCommand(write);
+}
+
+void OpenVPN::sendCredentials(const VPNCreds &c) {
+    // Disconnected or restarted in the meantime
+    if (m_pendingAuthType.isEmpty() || (m_status != Connected && m_status != Connecting)) {
+        return;
     }
+
+    QString type(m_pendingAuthType);
+    m_pendingAuthType.clear();
+    m_authUsername = c.username;
+
+    mgmtSendCredential("username", type, c.username);
+    mgmtSendCredential("password", type, c.password);
 }
 
-void OpenVPN::mgmtSend(const QString &line) {
-    m_mgmtSocket.write((line + "\n").toLocal8Bit());
+void OpenVPN::handleManagementResponse(const QString &line) {
+    if (m_mgmtQueries.isEmpty()) {
+        qDebug() << "OpenVPN: unexpected management response:" << line;
+        return;
+    }
+
+    MgmtQuery &q = m_mgmtQueries.head();
+    bool done = false;
+    bool ok = true;
+
+    if (q.lines.isEmpty() && line.startsWith("SUCCESS:")) {
+        q.lines.append(line);
+        done = true;
+    } else if (q.lines.isEmpty() && line.startsWith("ERROR:")) {
+        q.lines.append(line);
+        done = true;
+        ok = false;
+    } else if (line == "END") {
+        done = true;
+    } else {
+        q.lines.append(line);
+    }
+
+    if (!done) {
+        return;
+    }
+
+    // Dequeue first, the callback may send other commands
+    MgmtQuery finished(m_mgmtQueries.dequeue());
+    if (finished.callback) {
+        finished.callback(ok, finished.lines);
+    }
+}
+
+void OpenVPN::failManagementQueries() {
+    QQueue<MgmtQuery> queries;
+    queries.swap(m_mgmtQueries);
+
+    foreach (const MgmtQuery &q, queries) {
+        if (q.callback) {
+            q.callback(false, QStringList("ERROR: management interface closed"));
+        }
+    }
 }
 
 void OpenVPN::handleManagementCommand(const QString &line) {
@@ -230,23 +604,33 @@ void OpenVPN::handleManagementCommand(const QString &line) {
             return;
         }
 
-        VPNCreds c = m_vpngui->handleAuth(m_authFailed);
-        while (c.username.isEmpty()) {
-            if (m_status != Connected && m_status != Connecting) {
-                // "Cancel" button calls disconnect() that sets to Disconnecting
-                // openvpn will be killed and the socket too.
-                return;
-            }
-            c = m_vpngui->handleAuth(true);
+        QString type(parts[1]);
+        if (type == "Auth" && !m_authFailed && !m_authToken.isEmpty()) {
+            logStatus("Authenticating with the session token");
+            mgmtSendCredential("username", type, m_authUsername);
+            mgmtSendCredential("password", type, m_authToken);
+            return;
         }
 
-        QString type(parts[1]);
-        mgmtSend("username \"" + type + "\" " + c.username);
-        mgmtSend("password \"" + type + "\" " + c.password);
+        // Don't wait here for a dialog, the socket has to keep being read.
+        // The answer comes through sendCredentials().
+        m_pendingAuthType = type;
+        emit authRequested(m_authFailed);
+        return;
+    }
+    if (line.startsWith("PASSWORD:Auth-Token:")) {
+        QString token(line.mid(20));
+        m_authToken = SecureBuffer::takeString(token);
         return;
     }
     if (line.startsWith("PASSWORD:Verification Failed: ")) {
         m_authFailed = true;
+        m_authToken.clear();
+        return;
+    }
+    if (line.startsWith("HOLD:")) {
+        mgmtSend("hold release");
+        return;
     }
 }
 
@@ -266,3 +650,16 @@ QString getStatusString(OpenVPN::Status s) {
     }
     return statusText;
 }
+
+QString getStatusName(OpenVPN::Status s) {
+    if (s == OpenVPN::Connected) {
+        return "connected";
+    } else if (s == OpenVPN::Connecting) {
+        return "connecting";
+    } else if (s == OpenVPN::Disconnected) {
+        return "disconnected";
+    } else if (s == OpenVPN::Disconnecting) {
+        return "disconnecting";
+    }
+    return "unknown";
+}
@@ -3,15 +3,57 @@
 
 #include <QObject>
 #include <QString>
-#include <QTcpSocket>
-#include <QProcess>
+#include <QThread>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QQueue>
+#include <QStringList>
+#include <functional>
+
+#include "logentry.h"
+#include "securebuffer.h"
+#include "openvpnio.h"
+
+// UTF-8, in locked memory from the dialog to the management socket
+struct VPNCreds {
+    SecureBuffer username;
+    SecureBuffer password;
+
+    VPNCreds();
+    VPNCreds(const VPNCreds &) = default;
+    ~VPNCreds();
+    void clear();
+};
 
-class VPNGUI;
+/*
+ * Phases of the last connection (or restart of the same process), in ms,
+ * -1 until reached:
+ *   managementReady  connect() to the management socket being usable
+ *   handshake        first packet from the server to the TLS handshake done
+ *   connected        connect()/restart() to "Initialization Sequence Completed"
+ * and how long process/management events wait between the I/O thread and
+ * their handling (in us), since connect()/restart().
+ */
+struct ConnectionTimings {
+    bool reconnect;
+    qint64 managementReady;
+    qint64 handshake;
+    qint64 connected;
+
+    qint64 events;
+    qint64 eventLatencyTotal;
+    qint64 eventLatencyMax;
+
+    ConnectionTimings();
+    void reset(bool reconnect);
+    QJsonObject toJson() const;
+};
 
 /*
  * Manages an OpenVPN client
  * Handles management socket & auth & reconnection
+ * The process and the socket themselves live on an OpenVPNIO thread.
  *
  * TODO: Resolve host, put a "remote" line for every IP address in config
  * so when a connection fail it doesnt have to resolve it again.
@@ -28,59 +70,130 @@ public:
         Connected,
     };
 
-    explicit OpenVPN(VPNGUI *parent, QString openvpnPath);
+    /*
+     * Called once with the response to a management command.
+     * ok is false on "ERROR:" or if the management socket went away.
+     * lines is the "SUCCESS:"/"ERROR:" line, or every line before "END"
+     * for commands with multi-line output (status, state, version, ...).
+     */
+    typedef std::function<void(bool ok, const QStringList &lines)> MgmtCallback;
+
+    explicit OpenVPN(QObject *parent, QString openvpnPath);
     ~OpenVPN();
 
     bool connect(const QString &configPath);
+    bool restart();
+    bool switchConfig(const QString &configPath);
     void disconnect();
-    const QStringList &getLog() const;
+    const QList<LogEntry> &getLog() const;
+    const QString &getConfigPath() const;
+
+    // Gateway hostname, set by the TunnelManager
+    void setName(const QString &name);
+    const QString &getName() const;
 
     bool isUp() const;
     Status getStatus() const;
+    const ConnectionTimings &getTimings() const;
 
-private slots:
-    void procReadyRead();
-    void procError(QProcess::ProcessError);
-    void procFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void logStatus(const QString &line);
 
-    void mgmtTryConnect();
-    void mgmtReadyRead();
-    void mgmtConnected();
+    // Answer to authRequested(), now or later
+    void sendCredentials(const VPNCreds &c);
+
+    // Send a command now, without waiting for the previous ones.
+    // openvpn answers in order, responses are matched to the queries FIFO.
+    // Responses only go to the log with logResponse, polling would flood it.
+    bool queryManagement(const QString &command, MgmtCallback callback,
+                         bool logResponse = false);
+    bool isManagementReady() const;
+
+    // Severity of a line, from openvpn's flags when it gives them
+    static LogEntry::Level classify(LogEntry::Source source, const QString &line);
+
+private slots:
+    void ioEventsReady();
+    void stopTimeout();
 
 signals:
     void statusUpdated(OpenVPN::Status s);
-    void logUpdated(QString line);
+    void logUpdated(const LogEntry &entry);
+
+    // openvpn needs credentials, answer with sendCredentials().
+    // failed: the last ones were refused.
+    void authRequested(bool failed);
 
     void connected();
     void disconnected();
+    // openvpn exited without disconnect() being called
+    void connectionLost();
 
 private:
+    void procLine(const QString &line);
+    void procError(const QString &error, bool notRunning);
+    void procFinished(int exitCode);
+    void mgmtConnected();
+    void mgmtDisconnected();
+    void mgmtLine(QString line);
+
     void mgmtSend(const QString &line);
+    void mgmtSendCredential(const QString &command, const QString &type, const SecureBuffer &value);
     void handleManagementCommand(const QString &line);
-    //QString queryManagement(const QString &command);
+    void handleManagementResponse(const QString &line);
+    void failManagementQueries();
 
-    void logStatus(const QString &line);
     void setStatus(Status s);
+    void appendLog(LogEntry::Source source, const QString &line, const QString &display);
 
-    VPNGUI *m_vpngui;
-
+    QString m_name;
     QString m_openvpnPath;
-    QProcess m_openvpnProc;
-    QStringList m_openvpnLog;
+    QString m_configPath;
+    QString m_pendingConfigPath;
+    QList<LogEntry> m_openvpnLog;
 
-    QString m_username;
-    QString m_password;
+    QThread m_ioThread;
+    OpenVPNIO *m_io;
+    // As last reported by the I/O thread
+    bool m_procRunning;
+    bool m_mgmtReady;
 
     Status m_status;
     bool m_authFailed;
+    // "Auth", ... while authRequested() waits for credentials
+    QString m_pendingAuthType;
+    // Pushed by the server (auth-token), replaces the password until it
+    // fails or we connect somewhere else
+    SecureBuffer m_authToken;
+    SecureBuffer m_authUsername;
     bool m_abort;
 
-    QTcpSocket m_mgmtSocket;
+    enum StopStage {
+        StopTerminate,
+        StopKill,
+    };
+    StopStage m_stopStage;
+    QTimer m_stopTimer;
+
     QString m_mgmtHost;
     int m_mgmtPort;
-    QTimer m_mgmtSocketTimer;
+
+    struct MgmtQuery {
+        QString command;
+        MgmtCallback callback;
+        QStringList lines;
+        bool logResponse;
+    };
+    // Sent and waiting for a response, oldest first
+    QQueue<MgmtQuery> m_mgmtQueries;
+
+    // Time from connect/restart to Connected
+    QElapsedTimer m_connectTimer;
+    QElapsedTimer m_handshakeTimer;
+    ConnectionTimings m_timings;
 };
 
 QString getStatusString(OpenVPN::Status s);
+// Stable status names for the control API, not translated.
+QString getStatusName(OpenVPN::Status s);
 
 #endif // OPENVPN_H
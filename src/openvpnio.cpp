@@ -0,0 +1,240 @@
+#include "openvpnio.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDebug>
+
+OpenVPNEvent::OpenVPNEvent()
+    : type(ProcessLine)
+    , code(0)
+    , time(0)
+{}
+
+OpenVPNEvent::OpenVPNEvent(Type type, const QString &text, int code)
+    : type(type)
+    , text(text)
+    , code(code)
+    , time(now())
+{}
+
+qint64 OpenVPNEvent::now() {
+    // Thread-safe initialization, read-only after that
+    static const QElapsedTimer clock = []() {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+    return clock.nsecsElapsed() / 1000;
+}
+
+OpenVPNCommand::OpenVPNCommand()
+    : type(MgmtWrite)
+    , port(0)
+{}
+
+OpenVPNCommand::OpenVPNCommand(Type type)
+    : type(type)
+    , port(0)
+{}
+
+
+OpenVPNIO::OpenVPNIO()
+    : QObject(nullptr)
+    , m_process(this)
+    , m_mgmtSocket(this)
+    , m_mgmtPort(0)
+    , m_connectTimer(this)
+    , m_backlogTimer(this)
+    , m_eventsNotified(0)
+    , m_commandsNotified(0)
+{
+    connect(&m_process, SIGNAL(readyRead()), this, SLOT(procReadyRead()));
+    connect(&m_process, SIGNAL(error(QProcess::ProcessError)), this, SLOT(procError(QProcess::ProcessError)));
+    connect(&m_process, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(procFinished(int,QProcess::ExitStatus)));
+
+    connect(&m_mgmtSocket, SIGNAL(readyRead()), this, SLOT(mgmtReadyRead()));
+    connect(&m_mgmtSocket, SIGNAL(connected()), this, SLOT(mgmtConnected()));
+    connect(&m_mgmtSocket, SIGNAL(disconnected()), this, SLOT(mgmtDisconnected()));
+
+    connect(&m_connectTimer, SIGNAL(timeout()), this, SLOT(mgmtTryConnect()));
+    m_connectTimer.setInterval(ConnectRetryInterval);
+
+    connect(&m_backlogTimer, SIGNAL(timeout()), this, SLOT(flushBacklog()));
+    m_backlogTimer.setInterval(BacklogRetryInterval);
+}
+
+void OpenVPNIO::sendCommand(const OpenVPNCommand &command) {
+    // Only full if the I/O thread is stuck, it never waits for us
+    while (!m_commands.push(command)) {
+        QThread::yieldCurrentThread();
+    }
+    if (!m_commandsNotified.fetchAndStoreOrdered(1)) {
+        QMetaObject::invokeMethod(this, "processCommands", Qt::QueuedConnection);
+    }
+}
+
+bool OpenVPNIO::takeEvent(OpenVPNEvent &event) {
+    if (m_events.pop(event)) {
+        return true;
+    }
+    // Empty: the next post() has to notify again. Look once more in case
+    // one came in between.
+    m_eventsNotified.fetchAndStoreOrdered(0);
+    return m_events.pop(event);
+}
+
+void OpenVPNIO::processCommands() {
+    m_commandsNotified.fetchAndStoreOrdered(0);
+
+    OpenVPNCommand command;
+    while (m_commands.pop(command)) {
+        runCommand(command);
+    }
+}
+
+void OpenVPNIO::runCommand(const OpenVPNCommand &command) {
+    switch (command.type) {
+    case OpenVPNCommand::Start:
+        m_process.start(command.program, command.args);
+        break;
+    case OpenVPNCommand::Terminate:
+        m_process.terminate();
+        break;
+    case OpenVPNCommand::Kill:
+        m_process.kill();
+        break;
+    case OpenVPNCommand::MgmtConnect:
+        m_mgmtHost = command.host;
+        m_mgmtPort = command.port;
+        m_connectTimer.start();
+        break;
+    case OpenVPNCommand::MgmtCancelConnect:
+        m_connectTimer.stop();
+        break;
+    case OpenVPNCommand::MgmtAbort:
+        m_connectTimer.stop();
+        m_mgmtSocket.abort();
+        break;
+    case OpenVPNCommand::MgmtWrite:
+        if (!command.secret.isEmpty()) {
+            m_mgmtSocket.write(command.secret.constData(), command.secret.size());
+        } else {
+            m_mgmtSocket.write(command.data);
+        }
+        break;
+    }
+}
+
+void OpenVPNIO::post(const OpenVPNEvent &event) {
+    // Keep the order: nothing jumps ahead of the backlog
+    if (!m_backlog.isEmpty() || !m_events.push(event)) {
+        m_backlog.enqueue(event);
+        if (!m_backlogTimer.isActive()) {
+            m_backlogTimer.start();
+        }
+    }
+    notifyEvents();
+}
+
+void OpenVPNIO::flushBacklog() {
+    while (!m_backlog.isEmpty() && m_events.push(m_backlog.head())) {
+        m_backlog.dequeue();
+    }
+    if (m_backlog.isEmpty()) {
+        m_backlogTimer.stop();
+    }
+    notifyEvents();
+}
+
+void OpenVPNIO::notifyEvents() {
+    if (!m_eventsNotified.fetchAndStoreOrdered(1)) {
+        emit eventsReady();
+    }
+}
+
+void OpenVPNIO::shutdown() {
+    m_connectTimer.stop();
+    m_backlogTimer.stop();
+    m_mgmtSocket.blockSignals(true);
+    m_mgmtSocket.abort();
+
+    // Too late to be nice, OpenVPN::disconnect() first for a clean exit.
+    m_process.blockSignals(true);
+    if (m_process.state() != QProcess::NotRunning) {
+        m_process.kill();
+        m_process.waitForFinished(3000);
+    }
+}
+
+void OpenVPNIO::procReadyRead() {
+    while (m_process.canReadLine()) {
+        QString line(QString::fromLocal8Bit(m_process.readLine()));
+
+        if (line.endsWith("\r\n")) {
+            line.chop(2);
+        } else if (line.endsWith('\n')) {
+            line.chop(1);
+        }
+
+        post(OpenVPNEvent(OpenVPNEvent::ProcessLine, line));
+    }
+}
+
+void OpenVPNIO::procError(QProcess::ProcessError error) {
+    Q_UNUSED(error);
+    int notRunning = m_process.state() == QProcess::NotRunning ? 1 : 0;
+    post(OpenVPNEvent(OpenVPNEvent::ProcessError, m_process.errorString(), notRunning));
+}
+
+void OpenVPNIO::procFinished(int exitCode, QProcess::ExitStatus exitStatus) {
+    Q_UNUSED(exitStatus);
+
+    // What's left of the output comes first
+    procReadyRead();
+
+    m_connectTimer.stop();
+    m_mgmtSocket.abort();
+    post(OpenVPNEvent(OpenVPNEvent::ProcessFinished, QString(), exitCode));
+}
+
+void OpenVPNIO::mgmtTryConnect() {
+    qDebug() << "mgmtTryConnect(): " << m_mgmtSocket.state();
+
+    if (m_mgmtSocket.state() == QTcpSocket::ConnectedState) {
+        m_connectTimer.stop();
+        return;
+    }
+
+    // Abort and try again, hoping it's ready this time
+    m_mgmtSocket.abort();
+    m_mgmtSocket.close();
+
+    m_mgmtSocket.connectToHost(m_mgmtHost, static_cast<quint16>(m_mgmtPort));
+}
+
+void OpenVPNIO::mgmtConnected() {
+    m_connectTimer.stop();
+    post(OpenVPNEvent(OpenVPNEvent::MgmtConnected));
+}
+
+void OpenVPNIO::mgmtDisconnected() {
+    post(OpenVPNEvent(OpenVPNEvent::MgmtDisconnected));
+}
+
+void OpenVPNIO::mgmtReadyRead() {
+    while (m_mgmtSocket.canReadLine()) {
+        QString line(QString::fromLocal8Bit(m_mgmtSocket.readLine()));
+
+        if (line.endsWith("\r\n")) {
+            line.chop(2);
+        } else if (line.endsWith('\n')) {
+            line.chop(1);
+        }
+
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        post(OpenVPNEvent(OpenVPNEvent::MgmtLine, line));
+    }
+}
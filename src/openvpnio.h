@@ -0,0 +1,134 @@
+#ifndef OPENVPNIO_H
+#define OPENVPNIO_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QProcess>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "securebuffer.h"
+#include "spscqueue.h"
+
+// From the I/O thread to OpenVPN, lines already decoded and split
+struct OpenVPNEvent {
+    enum Type {
+        ProcessLine,
+        ProcessError,       // code: 1 if the process isn't running
+        ProcessFinished,    // code: exit code
+        MgmtConnected,
+        MgmtDisconnected,
+        MgmtLine,
+    };
+
+    Type type;
+    QString text;
+    int code;
+    // When it was read, see now()
+    qint64 time;
+
+    OpenVPNEvent();
+    OpenVPNEvent(Type type, const QString &text = QString(), int code = 0);
+
+    // Monotonic, in us, the same clock on every thread
+    static qint64 now();
+};
+
+// From OpenVPN to the I/O thread
+struct OpenVPNCommand {
+    enum Type {
+        Start,              // program, args
+        Terminate,
+        Kill,
+        MgmtConnect,        // host, port; retried until it works
+        MgmtCancelConnect,  // stop retrying, keep a connected socket
+        MgmtAbort,
+        MgmtWrite,          // data, or secret
+    };
+
+    Type type;
+    QString program;
+    QStringList args;
+    QString host;
+    int port;
+    QByteArray data;
+    SecureBuffer secret;
+
+    OpenVPNCommand();
+    explicit OpenVPNCommand(Type type);
+};
+
+/*
+ * The openvpn process and its management socket, on their own thread.
+ *
+ * They are always drained, even while the GUI thread is busy (repaint,
+ * modal dialog, ...): openvpn never blocks on a full stdout pipe or
+ * management socket because of us. Events go to OpenVPN through a
+ * lock-free queue and eventsReady() is emitted when it stops being
+ * empty. Past its capacity they wait in a backlog on this thread.
+ * Commands go the other way through another queue.
+ *
+ * sendCommand() and takeEvent() are for the thread that owns the
+ * OpenVPN, everything else runs on the I/O thread.
+ */
+class OpenVPNIO : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        EventQueueSize = 4096,
+        CommandQueueSize = 256,
+        ConnectRetryInterval = 100,
+        BacklogRetryInterval = 10,
+    };
+
+    OpenVPNIO();
+
+    void sendCommand(const OpenVPNCommand &command);
+    bool takeEvent(OpenVPNEvent &event);
+
+signals:
+    void eventsReady();
+
+public slots:
+    // Kill openvpn and close everything, before the thread is stopped
+    void shutdown();
+
+private slots:
+    void processCommands();
+    void flushBacklog();
+
+    void procReadyRead();
+    void procError(QProcess::ProcessError error);
+    void procFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+    void mgmtTryConnect();
+    void mgmtConnected();
+    void mgmtDisconnected();
+    void mgmtReadyRead();
+
+private:
+    void runCommand(const OpenVPNCommand &command);
+    void post(const OpenVPNEvent &event);
+    void notifyEvents();
+
+    QProcess m_process;
+    QTcpSocket m_mgmtSocket;
+    QString m_mgmtHost;
+    int m_mgmtPort;
+    QTimer m_connectTimer;
+
+    SpscQueue<OpenVPNEvent, EventQueueSize> m_events;
+    QQueue<OpenVPNEvent> m_backlog;
+    QTimer m_backlogTimer;
+    QAtomicInt m_eventsNotified;
+
+    SpscQueue<OpenVPNCommand, CommandQueueSize> m_commands;
+    QAtomicInt m_commandsNotified;
+};
+
+#endif // OPENVPNIO_H
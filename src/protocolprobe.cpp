@@ -0,0 +1,157 @@
+#include "protocolprobe.h"
+
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QDebug>
+
+#include <cryptopp/osrng.h>
+
+#define OPCODE_CLIENT_RESET_V2 7
+#define OPCODE_SERVER_RESET_V2 8
+
+ProtocolProbe::ProtocolProbe(const QString &address, const QList<Target> &targets,
+                             QObject *parent)
+    : QObject(parent)
+    , m_address(address)
+    , m_targets(targets)
+    , m_packet(clientResetPacket())
+    , m_best(-1)
+    , m_done(false)
+{
+    connect(&m_udpTimer, SIGNAL(timeout()), this, SLOT(sendUdp()));
+    m_udpTimer.setInterval(UdpRetryInterval);
+
+    connect(&m_timeout, SIGNAL(timeout()), this, SLOT(timeout()));
+    m_timeout.setSingleShot(true);
+}
+
+void ProtocolProbe::start() {
+    QHostAddress address(m_address);
+    bool anyUdp = false;
+
+    for (int i=0; i<m_targets.size(); ++i) {
+        const Target &t = m_targets[i];
+        if (t.udp) {
+            QUdpSocket *s = new QUdpSocket(this);
+            s->setProperty("target", i);
+            connect(s, SIGNAL(readyRead()), this, SLOT(udpReadyRead()));
+            s->connectToHost(address, t.port);
+            m_sockets.append(s);
+            anyUdp = true;
+        } else {
+            QTcpSocket *s = new QTcpSocket(this);
+            s->setProperty("target", i);
+            connect(s, SIGNAL(connected()), this, SLOT(tcpConnected()));
+            s->connectToHost(address, t.port);
+            m_sockets.append(s);
+        }
+    }
+
+    if (anyUdp) {
+        sendUdp();
+        m_udpTimer.start();
+    }
+    m_timeout.start(Timeout);
+}
+
+QByteArray ProtocolProbe::clientResetPacket() {
+    QByteArray p(14, '\0');
+    p[0] = char(OPCODE_CLIENT_RESET_V2 << 3);
+    // Session id
+    CryptoPP::OS_GenerateRandomBlock(false, (byte*)p.data() + 1, 8);
+    // p[9]: ack array length, p[10..13]: packet id
+    return p;
+}
+
+bool ProtocolProbe::isServerReset(const QByteArray &packet) {
+    return !packet.isEmpty()
+        && (static_cast<quint8>(packet[0]) >> 3) == OPCODE_SERVER_RESET_V2;
+}
+
+void ProtocolProbe::sendUdp() {
+    foreach (QObject *o, m_sockets) {
+        QUdpSocket *s = qobject_cast<QUdpSocket *>(o);
+        if (s) {
+            s->write(m_packet);
+        }
+    }
+}
+
+void ProtocolProbe::udpReadyRead() {
+    QUdpSocket *s = qobject_cast<QUdpSocket *>(sender());
+    if (!s) {
+        return;
+    }
+    while (s->hasPendingDatagrams()) {
+        QByteArray packet(static_cast<int>(s->pendingDatagramSize()), '\0');
+        s->readDatagram(packet.data(), packet.size());
+        if (isServerReset(packet)) {
+            answered(s->property("target").toInt());
+            return;
+        }
+    }
+}
+
+void ProtocolProbe::tcpConnected() {
+    QTcpSocket *s = qobject_cast<QTcpSocket *>(sender());
+    if (s) {
+        answered(s->property("target").toInt());
+    }
+}
+
+void ProtocolProbe::answered(int index) {
+    if (m_done) {
+        return;
+    }
+    qDebug() << "ProtocolProbe:" << m_address << m_targets[index].protocol << "answered";
+
+    if (m_best == -1 || index < m_best) {
+        m_best = index;
+    }
+    if (m_best == 0) {
+        finish();
+        return;
+    }
+
+    // Something better may be just behind
+    if (m_timeout.remainingTime() > PreferenceGrace) {
+        m_timeout.start(PreferenceGrace);
+    }
+}
+
+void ProtocolProbe::timeout() {
+    finish();
+}
+
+void ProtocolProbe::finish() {
+    if (m_done) {
+        return;
+    }
+    m_done = true;
+    m_udpTimer.stop();
+    m_timeout.stop();
+
+    // No half-open connections left behind
+    foreach (QObject *o, m_sockets) {
+        QAbstractSocket *s = qobject_cast<QAbstractSocket *>(o);
+        s->abort();
+        s->deleteLater();
+    }
+    m_sockets.clear();
+
+    QStringList order;
+    QString winner;
+    if (m_best != -1) {
+        winner = m_targets[m_best].protocol;
+        order.append(winner);
+    }
+    foreach (const Target &t, m_targets) {
+        if (t.protocol != winner) {
+            order.append(t.protocol);
+        }
+    }
+
+    qDebug() << "ProtocolProbe:" << m_address << "order" << order;
+    emit finished(order, winner);
+}
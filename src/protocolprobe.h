@@ -0,0 +1,72 @@
+#ifndef PROTOCOLPROBE_H
+#define PROTOCOLPROBE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+class QUdpSocket;
+class QTcpSocket;
+
+/*
+ * Races the protocols of a gateway, all at once:
+ * - UDP: an OpenVPN client hard reset, any OpenVPN server without
+ *   tls-auth/tls-crypt answers it with a server hard reset
+ * - TCP: a plain connect
+ * finished() gives the protocols in the order to try them: the one that
+ * answered first, then the others in the order given. A protocol earlier
+ * in the list still wins if it answers within PreferenceGrace.
+ */
+class ProtocolProbe : public QObject
+{
+    Q_OBJECT
+public:
+    struct Target {
+        QString protocol;   // "udp", "udpl", "tcp"
+        quint16 port;
+        bool udp;
+    };
+
+    enum {
+        Timeout = 3000,
+        UdpRetryInterval = 500,
+        PreferenceGrace = 200,
+    };
+
+    ProtocolProbe(const QString &address, const QList<Target> &targets,
+                  QObject *parent = nullptr);
+
+    void start();
+
+    // P_CONTROL_HARD_RESET_CLIENT_V2, key 0, no ack, packet id 0
+    static QByteArray clientResetPacket();
+    static bool isServerReset(const QByteArray &packet);
+
+signals:
+    // winner is empty if nothing answered, order is then the given one
+    void finished(const QStringList &order, const QString &winner);
+
+private slots:
+    void udpReadyRead();
+    void tcpConnected();
+    void sendUdp();
+    void timeout();
+
+private:
+    void answered(int index);
+    void finish();
+
+    QString m_address;
+    QList<Target> m_targets;
+    QList<QObject *> m_sockets;
+    QByteArray m_packet;
+    QTimer m_udpTimer;
+    QTimer m_timeout;
+    int m_best;
+    bool m_done;
+};
+
+#endif // PROTOCOLPROBE_H
@@ -1,29 +1,147 @@
 #include "pwstore.h"
 
 #include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QSettings>
+#include <QSysInfo>
 #include <QList>
 #include <QNetworkInterface>
+#include <QDebug>
 
 #include <cryptopp/osrng.h>
 #include <cryptopp/gcm.h>
 #include <cryptopp/aes.h>
 #include <cryptopp/authenc.h>
+#include <cryptopp/sha.h>
+#include <cryptopp/pwdbased.h>
 
 #ifdef _WIN32
 #include <windows.h>
 #include <intrin.h>
+#endif
 
 #define IV_SIZE 16
-#define KEY_SIZE 16
+#define TAG_SIZE 16
+#define KEY_SIZE 32
+#define LEGACY_KEY_SIZE 16
+#define KDF_SALT "lvpngui-pwstore-v2"
+
+QByteArray fingerprintInputs();
+QByteArray legacyFingerprint(const QByteArray &inputs);
+
+/*
+ * Process wide cache of the derived keys, see PwStore.
+ * Only a hash of the fingerprint inputs is kept to notice changes.
+ */
+class KeyCache
+{
+public:
+    KeyCache()
+        : m_key(KEY_SIZE)
+        , m_hasLegacyKey(false)
+    {}
+
+    SecureBuffer getKey() {
+        QMutexLocker lock(&m_mutex);
+        refresh();
+        return m_key;
+    }
+
+    SecureBuffer getLegacyKey() {
+        QMutexLocker lock(&m_mutex);
+        refresh();
+        if (!m_hasLegacyKey) {
+            QByteArray inputs(fingerprintInputs());
+            QByteArray key(legacyFingerprint(inputs).left(LEGACY_KEY_SIZE));
+            m_legacyKey = SecureBuffer(key.constData(), key.size());
+            key.fill('\0');
+            inputs.fill('\0');
+            m_hasLegacyKey = true;
+        }
+        return m_legacyKey;
+    }
+
+private:
+    void refresh() {
+        if (m_checked.isValid() && m_checked.elapsed() < PwStore::KeyCheckInterval) {
+            return;
+        }
+        m_checked.start();
+
+        QByteArray inputs(fingerprintInputs());
+        QByteArray inputsHash(QCryptographicHash::hash(inputs, QCryptographicHash::Sha256));
+        if (inputsHash == m_inputsHash) {
+            inputs.fill('\0');
+            return;
+        }
 
-QByteArray fingerprint();
+        QElapsedTimer timer;
+        timer.start();
 
-PwStore::PwStore() {
-    m_key = fingerprint().left(KEY_SIZE);
+        CryptoPP::PKCS5_PBKDF2_HMAC<CryptoPP::SHA256> kdf;
+        kdf.DeriveKey((byte*)m_key.data(), m_key.size(), 0,
+                      (const byte*)inputs.constData(), inputs.size(),
+                      (const byte*)KDF_SALT, sizeof(KDF_SALT) - 1,
+                      PwStore::KdfIterations);
+        inputs.fill('\0');
+
+        if (!m_inputsHash.isEmpty()) {
+            qDebug() << "PwStore: machine fingerprint changed";
+        }
+        qDebug() << "PwStore: key derived in" << timer.elapsed() << "ms";
+
+        m_inputsHash = inputsHash;
+        m_hasLegacyKey = false;
+    }
+
+    QMutex m_mutex;
+    QElapsedTimer m_checked;
+    QByteArray m_inputsHash;
+    SecureBuffer m_key;
+    SecureBuffer m_legacyKey;
+    bool m_hasLegacyKey;
+};
+
+static KeyCache &keyCache() {
+    static KeyCache cache;
+    return cache;
 }
 
-QByteArray PwStore::encrypt(QString s) {
+// Straight into locked memory
+static bool gcmDecrypt(const SecureBuffer &key, const QByteArray &iv,
+                       const QByteArray &ciphertext, SecureBuffer &plaintext) {
+    if (ciphertext.size() < TAG_SIZE) {
+        return false;
+    }
+    plaintext.resize(ciphertext.size() - TAG_SIZE);
+
+    CryptoPP::GCM<CryptoPP::AES>::Decryption dec;
+    dec.SetKeyWithIV((const byte*)key.constData(), key.size(), (const byte*)iv.data(), iv.length());
+
+    try {
+        CryptoPP::AuthenticatedDecryptionFilter adf( dec,
+            new CryptoPP::ArraySink( (byte*)plaintext.data(), plaintext.size() )
+        );
+
+        adf.Put((const byte*)ciphertext.data(), ciphertext.size());
+        adf.MessageEnd();
+    }
+    catch (CryptoPP::HashVerificationFilter::HashVerificationFailed) {
+        plaintext.clear();
+        return false;
+    }
+    return true;
+}
+
+
+PwStore::PwStore()
+    : m_key(keyCache().getKey())
+{}
+
+QByteArray PwStore::encrypt(const SecureBuffer &s) {
     std::string ciphertext;
 
     // Random IV
@@ -32,53 +150,38 @@ QByteArray PwStore::encrypt(QString s) {
     CryptoPP::OS_GenerateRandomBlock(false, (byte*)iv.data(), IV_SIZE);
 
     CryptoPP::GCM<CryptoPP::AES>::Encryption enc;
-    enc.SetKeyWithIV((byte*)m_key.data(), m_key.length(), (byte*)iv.data(), iv.length());
+    enc.SetKeyWithIV((const byte*)m_key.constData(), m_key.size(), (byte*)iv.data(), iv.length());
 
     CryptoPP::AuthenticatedEncryptionFilter aef( enc,
         new CryptoPP::StringSink( ciphertext )
     );
 
-    QByteArray sBytes(s.toUtf8());
-
-    aef.Put((byte*)sBytes.data(), sBytes.size());
+    aef.Put((const byte*)s.constData(), s.size());
     aef.MessageEnd();
 
     return iv + QByteArray(ciphertext.data(), ciphertext.length());
 }
 
-QString PwStore::decrypt(QByteArray s) {
+SecureBuffer PwStore::decrypt(const QByteArray &s, bool *legacy) {
     QByteArray ciphertext, iv;
     iv = s.left(IV_SIZE);
     ciphertext = s.mid(IV_SIZE);
 
-    std::string plaintext;
+    SecureBuffer plaintext;
 
-    CryptoPP::GCM<CryptoPP::AES>::Decryption dec;
-    dec.SetKeyWithIV((byte*)m_key.data(), m_key.length(), (byte*)iv.data(), iv.length());
-
-    try {
-        CryptoPP::AuthenticatedDecryptionFilter adf( dec,
-            new CryptoPP::StringSink( plaintext )
-        );
-
-        adf.Put((byte*)ciphertext.data(), ciphertext.size());
-        adf.MessageEnd();
-    }
-    catch (CryptoPP::HashVerificationFilter::HashVerificationFailed) {
-        return QString();
+    if (legacy) {
+        *legacy = false;
     }
-
-    QByteArray plaintextBytes(QByteArray::fromStdString(plaintext));
-
-    return QString::fromUtf8(plaintextBytes);
-}
-
-void secureStringClear(QString &s) {
-    int l = s.length();
-    for (int i=0; i<l; i++) {
-        s[i] = '\0';
+    if (!gcmDecrypt(m_key, iv, ciphertext, plaintext)) {
+        // Saved by a version with the SHA1 key?
+        if (!gcmDecrypt(keyCache().getLegacyKey(), iv, ciphertext, plaintext)) {
+            return SecureBuffer();
+        }
+        if (legacy) {
+            *legacy = true;
+        }
     }
-    s.clear();
+    return plaintext;
 }
 
 QByteArray getMacs() {
@@ -91,6 +194,8 @@ QByteArray getMacs() {
     return QByteArray();
 }
 
+#ifdef _WIN32
+
 QByteArray getMachineName() {
    static wchar_t computerName[1024];
    DWORD size = 1024;
@@ -111,20 +216,49 @@ QByteArray getVolumeHash() {
    return QByteArray((char*)&serialNum, 4);
 }
 
-QByteArray fingerprint() {
-    const int rounds = 1000;
+#else
+
+QByteArray getMachineName() {
+    return QSysInfo::machineHostName().toLatin1();
+}
 
+// systemd, or dbus on older systems
+QByteArray getMachineGUID() {
+    QStringList paths;
+    paths << "/etc/machine-id" << "/var/lib/dbus/machine-id";
+    foreach (QString path, paths) {
+        QFile f(path);
+        if (f.open(QFile::ReadOnly)) {
+            return f.readAll().trimmed();
+        }
+    }
+    return QByteArray("0");
+}
+
+// No volume serial to speak of, the machine id covers it
+QByteArray getVolumeHash() {
+    return QByteArray();
+}
+
+#endif
+
+QByteArray fingerprintInputs() {
     QByteArray buffer;
     buffer += getVolumeHash();
     buffer += getMachineGUID();
     buffer += getMachineName();
     buffer += getMacs();
+    return buffer;
+}
 
+// Before PBKDF2: 1000 rounds of SHA1
+QByteArray legacyFingerprint(const QByteArray &inputs) {
+    const int rounds = 1000;
+
+    QByteArray buffer(inputs);
     for (int i=0; i<rounds; i++) {
         buffer = QCryptographicHash::hash(buffer, QCryptographicHash::Sha1);
     }
 
     return buffer;
 }
-
-#endif
@@ -4,23 +4,34 @@
 #include <QString>
 #include <QByteArray>
 
-void secureStringClear(QString &s);
+#include "securebuffer.h"
 
 /*
  * Slightly-better-than-plaintext authenticated password encryption.
- * It uses a machine fingerprint as a key and a random IV stored with
- * the encrypted data, and encrypts with AES-GCM.
- * If it cannot decrypt, an empty string is returned.
+ * It uses a key derived from a machine fingerprint and a random IV stored
+ * with the encrypted data, and encrypts with AES-GCM.
+ * If it cannot decrypt, an empty buffer is returned.
+ *
+ * The key is derived once per process (PBKDF2-HMAC-SHA256) and kept in
+ * a SecureBuffer. The fingerprint inputs are re-read every
+ * KeyCheckInterval and the key derived again only if they changed.
+ * Data encrypted with the old SHA1 key still decrypts, with *legacy set
+ * so the caller can save it again.
  */
 class PwStore
 {
 public:
     PwStore();
-    QByteArray encrypt(QString s);
-    QString decrypt(QByteArray s);
+    QByteArray encrypt(const SecureBuffer &s);
+    SecureBuffer decrypt(const QByteArray &s, bool *legacy = nullptr);
+
+    enum {
+        KeyCheckInterval = 5 * 60 * 1000,
+        KdfIterations = 100000,
+    };
 
 private:
-    QByteArray m_key;
+    SecureBuffer m_key;
 };
 
 #endif // PWSTORE_H
@@ -0,0 +1,120 @@
+#include "reconnector.h"
+
+#include <algorithm>
+#include <random>
+#include <QDebug>
+
+// Backoff: 1s, 2s, 4s, ... up to a minute, with 50% jitter so many
+// clients dropped by the same gateway don't come back at the same time.
+static const int minDelay = 1000;
+static const int maxDelay = 60000;
+
+Reconnector::Reconnector(OpenVPN &openvpn, NetworkWatcher &watcher, QObject *parent)
+    : QObject(parent)
+    , m_openvpn(openvpn)
+    , m_watcher(watcher)
+    , m_retryTimer(this)
+    , m_attempts(0)
+    , m_enabled(true)
+{
+    m_retryTimer.setSingleShot(true);
+
+    connect(&m_retryTimer, SIGNAL(timeout()), this, SLOT(retry()));
+    connect(&m_watcher, SIGNAL(changed()), this, SLOT(networkChanged()));
+    connect(&m_openvpn, SIGNAL(connectionLost()), this, SLOT(connectionLost()));
+    connect(&m_openvpn, SIGNAL(statusUpdated(OpenVPN::Status)), this, SLOT(vpnStatusUpdated(OpenVPN::Status)));
+}
+
+void Reconnector::setEnabled(bool enabled) {
+    m_enabled = enabled;
+    if (!enabled) {
+        cancel();
+    }
+}
+
+bool Reconnector::isEnabled() const {
+    return m_enabled;
+}
+
+bool Reconnector::isPending() const {
+    return m_retryTimer.isActive();
+}
+
+void Reconnector::cancel() {
+    m_retryTimer.stop();
+    m_attempts = 0;
+}
+
+int Reconnector::nextDelay() {
+    static std::mt19937 rng{std::random_device{}()};
+
+    int delay = maxDelay;
+    if (m_attempts < 16) {
+        delay = std::min(maxDelay, minDelay << m_attempts);
+    }
+    std::uniform_int_distribution<int> jitter(delay / 2, delay);
+
+    m_attempts++;
+    return jitter(rng);
+}
+
+void Reconnector::connectionLost() {
+    if (!m_enabled || m_openvpn.getConfigPath().isEmpty()) {
+        return;
+    }
+
+    if (!m_outage.isValid()) {
+        m_outage.start();
+    }
+    if (!m_watcher.isRunning()) {
+        m_watcher.start();
+    }
+
+    int delay = nextDelay();
+    m_openvpn.logStatus(QString("Connection lost, reconnecting in %1 ms").arg(delay));
+    m_retryTimer.start(delay);
+    emit reconnectScheduled(delay);
+}
+
+void Reconnector::retry() {
+    if (m_openvpn.getStatus() != OpenVPN::Disconnected) {
+        return;
+    }
+    m_openvpn.connect(m_openvpn.getConfigPath());
+}
+
+void Reconnector::vpnStatusUpdated(OpenVPN::Status s) {
+    if (s == OpenVPN::Connected) {
+        if (m_outage.isValid()) {
+            m_openvpn.logStatus(QString("Reconnected after %1 ms").arg(m_outage.elapsed()));
+            m_outage.invalidate();
+        }
+        m_attempts = 0;
+        // Our own tunnel interface just changed the network, that's
+        // the new reference.
+        m_watcher.reset();
+    }
+    else if (s == OpenVPN::Disconnecting) {
+        // Requested by the user (or us), not a failure
+        cancel();
+        m_outage.invalidate();
+    }
+}
+
+void Reconnector::networkChanged() {
+    if (!m_enabled) {
+        return;
+    }
+
+    if (m_retryTimer.isActive()) {
+        qDebug() << "Reconnector: network changed, retrying now";
+        m_retryTimer.stop();
+        retry();
+        return;
+    }
+
+    if (m_openvpn.getStatus() == OpenVPN::Connected) {
+        m_outage.start();
+        m_openvpn.restart();
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef RECONNECTOR_H
+#define RECONNECTOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "openvpn.h"
+#include "netwatch.h"
+
+/*
+ * Keeps the tunnel up.
+ * When openvpn exits on its own, starts it again with the same config
+ * (already resolved, no DNS) after a jittered exponential backoff.
+ * When the network changes, restarts the connection right away instead of
+ * waiting for openvpn's ping timeout, or skips the remaining backoff.
+ */
+class Reconnector : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Reconnector(OpenVPN &openvpn, NetworkWatcher &watcher, QObject *parent = nullptr);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    bool isPending() const;
+
+    // Stop any scheduled reconnection (ie: on user disconnect)
+    void cancel();
+
+signals:
+    void reconnectScheduled(int delay);
+
+private slots:
+    void connectionLost();
+    void vpnStatusUpdated(OpenVPN::Status s);
+    void networkChanged();
+    void retry();
+
+private:
+    int nextDelay();
+
+    OpenVPN &m_openvpn;
+    NetworkWatcher &m_watcher;
+    QTimer m_retryTimer;
+    QElapsedTimer m_outage;
+    int m_attempts;
+    bool m_enabled;
+};
+
+#endif // RECONNECTOR_H
@@ -0,0 +1,231 @@
+#include "securebuffer.h"
+
+#include <cstring>
+#include <new>
+
+#include <QAtomicInt>
+#include <QDebug>
+
+#include <cryptopp/misc.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Locks don't nest, so buffers never share a page
+#define PAGE_SIZE_MIN 4096
+
+void secureStringClear(QString &s) {
+    // Only our own copy: shared data is still in use by the other QStrings
+    // (detaching would wipe a copy and leave the original). Literals live
+    // in read-only memory, nothing to wipe there either.
+    QString::Data *d = s.data_ptr();
+    if (!s.isEmpty() && !d->ref.isStatic() && !d->ref.isShared()) {
+        CryptoPP::SecureWipeBuffer((byte*)s.data(), s.size() * sizeof(QChar));
+    }
+    s.clear();
+}
+
+// Once, locking fails for every buffer alike (limits, privileges)
+static void lockFailed() {
+    static QAtomicInt warned;
+    if (warned.testAndSetRelaxed(0, 1)) {
+        qWarning() << "SecureBuffer: cannot lock memory, secrets may be swapped out";
+    }
+}
+
+static char *allocLocked(int size) {
+#ifdef _WIN32
+    void *p = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    if (!VirtualLock(p, size)) {
+        lockFailed();
+    }
+#else
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    if (mlock(p, size) != 0) {
+        lockFailed();
+    }
+#endif
+    return (char*)p;
+}
+
+static void freeLocked(char *p, int size) {
+    CryptoPP::SecureWipeBuffer((byte*)p, size);
+#ifdef _WIN32
+    VirtualUnlock(p, size);
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munlock(p, size);
+    munmap(p, size);
+#endif
+}
+
+
+SecureBuffer::SecureBuffer()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_capacity(0)
+{}
+
+SecureBuffer::SecureBuffer(int size)
+    : SecureBuffer()
+{
+    resize(size);
+}
+
+SecureBuffer::SecureBuffer(const char *data, int size)
+    : SecureBuffer()
+{
+    append(data, size);
+}
+
+SecureBuffer::SecureBuffer(const SecureBuffer &other)
+    : SecureBuffer()
+{
+    append(other);
+}
+
+SecureBuffer &SecureBuffer::operator=(const SecureBuffer &other) {
+    if (this != &other) {
+        clear();
+        append(other);
+    }
+    return *this;
+}
+
+SecureBuffer::~SecureBuffer() {
+    release();
+}
+
+SecureBuffer SecureBuffer::takeString(QString &s) {
+    SecureBuffer b;
+    b.reserve(s.size() * 3);
+
+    // UTF-8 by hand, toUtf8() would leave a copy behind
+    const QChar *c = s.constData();
+    for (int i=0; i<s.size(); ++i) {
+        uint u = c[i].unicode();
+        if (c[i].isHighSurrogate() && i + 1 < s.size() && c[i + 1].isLowSurrogate()) {
+            u = QChar::surrogateToUcs4(c[i], c[i + 1]);
+            ++i;
+        }
+        if (u < 0x80) {
+            b.append(char(u));
+        } else if (u < 0x800) {
+            b.append(char(0xc0 | (u >> 6)));
+            b.append(char(0x80 | (u & 0x3f)));
+        } else if (u < 0x10000) {
+            b.append(char(0xe0 | (u >> 12)));
+            b.append(char(0x80 | ((u >> 6) & 0x3f)));
+            b.append(char(0x80 | (u & 0x3f)));
+        } else {
+            b.append(char(0xf0 | (u >> 18)));
+            b.append(char(0x80 | ((u >> 12) & 0x3f)));
+            b.append(char(0x80 | ((u >> 6) & 0x3f)));
+            b.append(char(0x80 | (u & 0x3f)));
+        }
+    }
+
+    secureStringClear(s);
+    return b;
+}
+
+int SecureBuffer::size() const {
+    return m_size;
+}
+
+bool SecureBuffer::isEmpty() const {
+    return m_size == 0;
+}
+
+const char *SecureBuffer::constData() const {
+    return m_data;
+}
+
+char *SecureBuffer::data() {
+    return m_data;
+}
+
+void SecureBuffer::resize(int size) {
+    reserve(size);
+    if (size > m_size) {
+        memset(m_data + m_size, 0, size - m_size);
+    } else if (size < m_size) {
+        CryptoPP::SecureWipeBuffer((byte*)m_data + size, m_size - size);
+    }
+    m_size = size;
+}
+
+void SecureBuffer::append(const char *data, int size) {
+    if (size <= 0) {
+        return;
+    }
+    reserve(m_size + size);
+    memcpy(m_data + m_size, data, size);
+    m_size += size;
+}
+
+void SecureBuffer::append(char c) {
+    append(&c, 1);
+}
+
+void SecureBuffer::append(const SecureBuffer &other) {
+    append(other.m_data, other.m_size);
+}
+
+int SecureBuffer::indexOf(char c, int from) const {
+    for (int i=from; i<m_size; ++i) {
+        if (m_data[i] == c) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+SecureBuffer SecureBuffer::mid(int pos, int len) const {
+    if (pos >= m_size) {
+        return SecureBuffer();
+    }
+    if (len < 0 || pos + len > m_size) {
+        len = m_size - pos;
+    }
+    return SecureBuffer(m_data + pos, len);
+}
+
+void SecureBuffer::clear() {
+    if (m_data) {
+        CryptoPP::SecureWipeBuffer((byte*)m_data, m_size);
+    }
+    m_size = 0;
+}
+
+void SecureBuffer::reserve(int capacity) {
+    if (capacity <= m_capacity) {
+        return;
+    }
+
+    int pages = (capacity + PAGE_SIZE_MIN - 1) / PAGE_SIZE_MIN;
+    char *data = allocLocked(pages * PAGE_SIZE_MIN);
+    if (m_data) {
+        memcpy(data, m_data, m_size);
+        freeLocked(m_data, m_capacity);
+    }
+    m_data = data;
+    m_capacity = pages * PAGE_SIZE_MIN;
+}
+
+void SecureBuffer::release() {
+    if (m_data) {
+        freeLocked(m_data, m_capacity);
+    }
+    m_data = nullptr;
+    m_size = m_capacity = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef SECUREBUFFER_H
+#define SECUREBUFFER_H
+
+#include <QString>
+
+// Overwrite the characters of s, then clear it. Characters still shared
+// with another QString are left alone, that copy has to be cleared too.
+void secureStringClear(QString &s);
+
+/*
+ * Byte buffer for secrets (credentials, keys).
+ * The memory comes in whole pages, locked so it's never swapped out, and
+ * it's wiped before being unlocked and freed, or before growing.
+ * Copies are deep, into locked memory too.
+ * Best effort: the system may still refuse to lock, and Qt widgets and
+ * sockets keep their own copies of what goes through them.
+ */
+class SecureBuffer
+{
+public:
+    SecureBuffer();
+    explicit SecureBuffer(int size);
+    SecureBuffer(const char *data, int size);
+    SecureBuffer(const SecureBuffer &other);
+    SecureBuffer &operator=(const SecureBuffer &other);
+    ~SecureBuffer();
+
+    // UTF-8 encoded, s is cleared with secureStringClear()
+    static SecureBuffer takeString(QString &s);
+
+    int size() const;
+    bool isEmpty() const;
+    const char *constData() const;
+    char *data();
+
+    void resize(int size);
+    void append(const char *data, int size);
+    void append(char c);
+    void append(const SecureBuffer &other);
+
+    int indexOf(char c, int from = 0) const;
+    SecureBuffer mid(int pos, int len = -1) const;
+
+    // Wipe, the locked memory is kept for reuse
+    void clear();
+
+private:
+    void reserve(int capacity);
+    void release();
+
+    char *m_data;
+    int m_size;
+    int m_capacity;
+};
+
+#endif // SECUREBUFFER_H
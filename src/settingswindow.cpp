@@ -60,7 +60,8 @@ SettingsWindow::SettingsWindow(QWidget *parent, const VPNGUI &vpngui, QSettings
     connect(ui->cancelButton, SIGNAL(released()), this, SLOT(close()));
     connect(ui->saveButton, SIGNAL(released()), this, SLOT(saveAndClose()));
     connect(ui->uninstallButton, SIGNAL(released()), &m_vpngui, SLOT(confirmUninstall()));
-    connect(ui->forgetPwButton, SIGNAL(released()), this, SLOT(forgetPw()));
+    connect(ui->forgetPwButton, SIGNAL(released()), &m_vpngui, SLOT(forgetCredentials()));
+    connect(ui->diagnosticsButton, SIGNAL(released()), &m_vpngui, SLOT(saveDiagnostics()));
 
     loadSettings();
 }
@@ -78,7 +79,10 @@ void SettingsWindow::loadSettings() {
     QString currentProtocol(getCurrentProtocol(m_appSettings));
 
     // Protocol radio
-    if (currentProtocol == "udp") {
+    ui->protoAuto->setVisible(getProtocolTargets().size() > 1);
+    if (currentProtocol == "auto") {
+        ui->protoAuto->setChecked(true);
+    } else if (currentProtocol == "udp") {
         ui->protoUDP->setChecked(true);
     } else if (currentProtocol == "udpl") {
         ui->protoUDPL->setChecked(true);
@@ -94,6 +98,8 @@ void SettingsWindow::loadSettings() {
     }
 
     ui->startOnBootCheckbox->setChecked(m_appSettings.value("start_on_boot", false).toBool());
+    ui->reconnectCheckbox->setChecked(m_appSettings.value("auto_reconnect", true).toBool());
+    ui->multiTunnelCheckbox->setChecked(m_appSettings.value("multi_tunnel", false).toBool());
 
     // Autoconnect
     QString autoconnectSelected(m_appSettings.value("autoconnect").toString());
@@ -113,6 +119,7 @@ void SettingsWindow::loadSettings() {
     // Advanced settings
     ui->httpProxyEdit->setText(m_appSettings.value("http_proxy").toString());
     ui->dnsAPIEdit->setText(m_appSettings.value("dns_api").toString());
+    ui->dnsDohEdit->setText(m_appSettings.value("dns_doh").toString());
     ui->dnsSystemEdit->setText(m_appSettings.value("dns_system").toString());
     ui->addConfigEdit->setText(m_appSettings.value("additional_config").toString());
 }
@@ -125,7 +132,9 @@ void SettingsWindow::saveSettings() {
 
     // Protocol radio
     QString currentProtocol;
-    if (ui->protoUDP->isChecked()) {
+    if (ui->protoAuto->isChecked()) {
+        currentProtocol = "auto";
+    } else if (ui->protoUDP->isChecked()) {
         currentProtocol = "udp";
     } else if (ui->protoUDPL->isChecked()) {
         currentProtocol = "udpl";
@@ -140,6 +149,8 @@ void SettingsWindow::saveSettings() {
     }
 
     m_appSettings.setValue("start_on_boot", ui->startOnBootCheckbox->isChecked());
+    m_appSettings.setValue("auto_reconnect", ui->reconnectCheckbox->isChecked());
+    m_appSettings.setValue("multi_tunnel", ui->multiTunnelCheckbox->isChecked());
 
     // Autoconnect
     m_appSettings.setValue("autoconnect", ui->autoconnectBox->currentData());
@@ -147,6 +158,7 @@ void SettingsWindow::saveSettings() {
     // Advanced settings
     m_appSettings.setValue("http_proxy", ui->httpProxyEdit->text());
     m_appSettings.setValue("dns_api", ui->dnsAPIEdit->text());
+    m_appSettings.setValue("dns_doh", ui->dnsDohEdit->text().trimmed());
     m_appSettings.setValue("dns_system", ui->dnsSystemEdit->text());
     m_appSettings.setValue("additional_config", ui->addConfigEdit->toPlainText());
 
@@ -154,10 +166,6 @@ void SettingsWindow::saveSettings() {
     emit settingsChanged(diff);
 }
 
-void SettingsWindow::forgetPw() {
-    m_appSettings.remove("auth");
-}
-
 void SettingsWindow::on_reinstallTAPButton_clicked() {
     m_vpngui.getInstaller().installTAP();
 }
@@ -27,7 +27,6 @@ signals:
 
 public slots:
     void saveAndClose();
-    void forgetPw();
 
 private slots:
     void on_reinstallTAPButton_clicked();
@@ -0,0 +1,40 @@
+#include "sockettuning.h"
+
+#include <QStringList>
+
+SocketTuning SocketTuning::choose(bool udp, int rtt, qint64 bandwidth) {
+    if (rtt <= 0) {
+        rtt = DefaultRtt;
+    }
+    // Room to grow past what was seen
+    bandwidth = qMax<qint64>(bandwidth * 2, DefaultBandwidth);
+
+    qint64 bdp = bandwidth * rtt / 1000;
+    qint64 buffer = (bdp + BufferStep - 1) / BufferStep * BufferStep;
+
+    SocketTuning t;
+    t.sndbuf = t.rcvbuf = static_cast<int>(qBound<qint64>(MinBuffer, buffer, MaxBuffer));
+#ifdef _WIN32
+    t.fastIo = false;
+    t.txqueuelen = 0;
+#else
+    // Only for UDP, and without the poll() before each write
+    t.fastIo = udp;
+    t.txqueuelen = static_cast<int>(qBound<qint64>(MinTxQueueLen, bdp / PacketSize, MaxTxQueueLen));
+#endif
+    Q_UNUSED(udp);
+    return t;
+}
+
+QString SocketTuning::toString() const {
+    QStringList parts;
+    parts << QString("sndbuf %1").arg(sndbuf);
+    parts << QString("rcvbuf %1").arg(rcvbuf);
+    if (fastIo) {
+        parts << "fast-io";
+    }
+    if (txqueuelen > 0) {
+        parts << QString("txqueuelen %1").arg(txqueuelen);
+    }
+    return parts.join(", ");
+}
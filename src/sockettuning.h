@@ -0,0 +1,35 @@
+#ifndef SOCKETTUNING_H
+#define SOCKETTUNING_H
+
+#include <QString>
+
+/*
+ * OpenVPN socket options for a link, from its round trip time and
+ * bandwidth: the buffers hold a bandwidth-delay product (with headroom,
+ * the bandwidth is the highest seen so far), at least MinBuffer (openvpn's
+ * own default is 64K, too small past ~10 Mbit/s on 50 ms).
+ * fast-io and txqueuelen don't exist for openvpn on Windows.
+ */
+struct SocketTuning {
+    enum {
+        DefaultRtt = 50,                // ms
+        DefaultBandwidth = 12500000,    // bytes/s, 100 Mbit/s
+        MinBuffer = 64 * 1024,
+        MaxBuffer = 4 * 1024 * 1024,
+        BufferStep = 64 * 1024,
+        PacketSize = 1400,
+        MinTxQueueLen = 100,
+        MaxTxQueueLen = 5000,
+    };
+
+    int sndbuf;
+    int rcvbuf;
+    bool fastIo;
+    int txqueuelen;     // 0 to keep the default
+
+    // rtt in ms and bandwidth in bytes/s, 0 if unknown
+    static SocketTuning choose(bool udp, int rtt, qint64 bandwidth);
+    QString toString() const;
+};
+
+#endif // SOCKETTUNING_H
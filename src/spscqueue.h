@@ -0,0 +1,58 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QAtomicInt>
+
+/*
+ * Bounded lock-free queue for exactly one producer thread and one consumer
+ * thread. push() fails when full, pop() when empty; neither ever blocks.
+ * Capacity must be a power of two, one slot is always kept free.
+ */
+template <typename T, int Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue()
+        : m_head(0)
+        , m_tail(0)
+    {}
+
+    // Producer thread only
+    bool push(const T &item) {
+        int tail = m_tail.load();
+        int next = (tail + 1) & Mask;
+        if (next == m_head.loadAcquire()) {
+            return false;
+        }
+        m_items[tail] = item;
+        m_tail.storeRelease(next);
+        return true;
+    }
+
+    // Consumer thread only
+    bool pop(T &item) {
+        int head = m_head.load();
+        if (head == m_tail.loadAcquire()) {
+            return false;
+        }
+        item = m_items[head];
+        // Don't keep the data alive (or, for secrets, around) in the slot
+        m_items[head] = T();
+        m_head.storeRelease((head + 1) & Mask);
+        return true;
+    }
+
+private:
+    enum {
+        Mask = Capacity - 1,
+    };
+
+    T m_items[Capacity];
+    // Written by the consumer / the producer, on separate cache lines
+    alignas(64) QAtomicInt m_head;
+    alignas(64) QAtomicInt m_tail;
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,134 @@
+#include "statuspoller.h"
+
+#include <QPointer>
+#include <QDebug>
+
+StatusPoller::StatusPoller(OpenVPN &openvpn, QObject *parent)
+    : QObject(parent)
+    , m_openvpn(openvpn)
+    , m_fast(false)
+    , m_pollPending(false)
+{
+    m_timer.setInterval(SlowInterval);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(poll()));
+
+    connect(&m_openvpn, SIGNAL(statusUpdated(OpenVPN::Status)), this, SLOT(vpnStatusUpdated(OpenVPN::Status)));
+    connect(&m_openvpn, SIGNAL(logUpdated(LogEntry)), this, SLOT(logUpdated(LogEntry)));
+}
+
+const StatusSnapshot &StatusPoller::getSnapshot() const {
+    return m_snapshot;
+}
+
+void StatusPoller::setFast(bool fast) {
+    if (fast == m_fast) {
+        return;
+    }
+    m_fast = fast;
+    m_timer.setInterval(fast ? FastInterval : SlowInterval);
+
+    // Don't make a window wait for the slow timer
+    if (fast && m_timer.isActive()) {
+        poll();
+    }
+}
+
+void StatusPoller::vpnStatusUpdated(OpenVPN::Status s) {
+    if (s == OpenVPN::Connected) {
+        m_sinceLastStatus.invalidate();
+        m_timer.start();
+        poll();
+    } else {
+        m_timer.stop();
+        m_pollPending = false;
+        if (s == OpenVPN::Connecting || s == OpenVPN::Disconnected) {
+            m_snapshot.clear();
+            emit snapshotUpdated();
+        }
+    }
+}
+
+void StatusPoller::logUpdated(const LogEntry &entry) {
+    if (entry.source != LogEntry::Process) {
+        return;
+    }
+
+    // "Outgoing Data Channel: Cipher 'AES-256-GCM' initialized with 256 bit key"
+    const QString &line = entry.text;
+    int i = line.indexOf("Data Channel: Cipher '");
+    if (i == -1) {
+        return;
+    }
+    i += 22;
+    int end = line.indexOf('\'', i);
+    if (end != -1) {
+        m_snapshot.cipher = line.mid(i, end - i);
+    }
+}
+
+void StatusPoller::poll() {
+    if (m_pollPending || !m_openvpn.isManagementReady()) {
+        return;
+    }
+    m_pollPending = true;
+
+    // openvpn answers in order, "status" completes the poll
+    QPointer<StatusPoller> self(this);
+    m_openvpn.queryManagement("state", [self](bool ok, const QStringList &lines) {
+        if (self) {
+            self->stateReceived(ok, lines);
+        }
+    });
+    m_openvpn.queryManagement("status 3", [self](bool ok, const QStringList &lines) {
+        if (self) {
+            self->statusReceived(ok, lines);
+        }
+    });
+}
+
+void StatusPoller::stateReceived(bool ok, const QStringList &lines) {
+    if (ok) {
+        m_snapshot.parseState(lines);
+    }
+}
+
+void StatusPoller::statusReceived(bool ok, const QStringList &lines) {
+    m_pollPending = false;
+    if (!ok || m_openvpn.getStatus() != OpenVPN::Connected) {
+        return;
+    }
+
+    qint64 prevRead = m_snapshot.linkRead;
+    qint64 prevWrite = m_snapshot.linkWrite;
+
+    if (!m_snapshot.parseStatus(lines)) {
+        return;
+    }
+
+    if (m_sinceLastStatus.isValid() && m_sinceLastStatus.elapsed() > 0) {
+        qint64 ms = m_sinceLastStatus.elapsed();
+        m_snapshot.readRate = (m_snapshot.linkRead - prevRead) * 1000 / ms;
+        m_snapshot.writeRate = (m_snapshot.linkWrite - prevWrite) * 1000 / ms;
+    }
+    m_sinceLastStatus.start();
+    m_snapshot.valid = true;
+
+    emit snapshotUpdated();
+}
+
+QString StatusPoller::getSummary() const {
+    if (!m_snapshot.valid) {
+        return QString();
+    }
+
+    QStringList parts;
+    if (!m_snapshot.localIP.isEmpty()) {
+        parts << m_snapshot.localIP;
+    }
+    if (!m_snapshot.cipher.isEmpty()) {
+        parts << m_snapshot.cipher;
+    }
+    parts << tr("%1 down, %2 up").arg(formatBytes(m_snapshot.linkRead),
+                                      formatBytes(m_snapshot.linkWrite));
+    return parts.join(" - ");
+}
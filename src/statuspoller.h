@@ -0,0 +1,55 @@
+#ifndef STATUSPOLLER_H
+#define STATUSPOLLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+
+#include "openvpn.h"
+#include "statussnapshot.h"
+
+/*
+ * Polls "state" and "status 3" while the tunnel is connected.
+ * Slow by default (tray tooltip, control socket), fast while a window
+ * shows the details.
+ */
+class StatusPoller : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StatusPoller(OpenVPN &openvpn, QObject *parent = nullptr);
+
+    const StatusSnapshot &getSnapshot() const;
+    QString getSummary() const;
+
+    void setFast(bool fast);
+
+    enum {
+        FastInterval = 1000,
+        SlowInterval = 15000,
+    };
+
+signals:
+    void snapshotUpdated();
+
+private slots:
+    void poll();
+    void vpnStatusUpdated(OpenVPN::Status s);
+    void logUpdated(const LogEntry &entry);
+
+private:
+    void stateReceived(bool ok, const QStringList &lines);
+    void statusReceived(bool ok, const QStringList &lines);
+
+    OpenVPN &m_openvpn;
+    QTimer m_timer;
+    QElapsedTimer m_sinceLastStatus;
+    StatusSnapshot m_snapshot;
+    bool m_fast;
+    // Don't stack queries on a busy openvpn
+    bool m_pollPending;
+};
+
+#endif // STATUSPOLLER_H
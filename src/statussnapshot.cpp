@@ -0,0 +1,98 @@
+#include "statussnapshot.h"
+
+#include <QVector>
+
+StatusSnapshot::StatusSnapshot() {
+    clear();
+}
+
+void StatusSnapshot::clear() {
+    localIP.clear();
+    localIPv6.clear();
+    remoteIP.clear();
+    remotePort = 0;
+    cipher.clear();
+    tunRead = tunWrite = 0;
+    linkRead = linkWrite = 0;
+    preCompress = postCompress = 0;
+    preDecompress = postDecompress = 0;
+    readRate = writeRate = 0;
+    valid = false;
+}
+
+// "1555555555,CONNECTED,SUCCESS,10.8.0.6,1.2.3.4,1194,,,fd00::6"
+bool StatusSnapshot::parseState(const QStringList &lines) {
+    if (lines.isEmpty()) {
+        return false;
+    }
+
+    // The last line is the current state
+    QVector<QStringRef> fields(lines.last().splitRef(','));
+    if (fields.size() < 5) {
+        return false;
+    }
+
+    localIP = fields[3].toString();
+    remoteIP = fields[4].toString();
+    remotePort = fields.size() > 5 ? fields[5].toInt() : 0;
+    if (fields.size() > 8) {
+        localIPv6 = fields[8].toString();
+    }
+    return true;
+}
+
+// "OpenVPN STATISTICS", "Updated,...", then "<name>,<counter>" lines
+bool StatusSnapshot::parseStatus(const QStringList &lines) {
+    bool found = false;
+
+    foreach (const QString &line, lines) {
+        int sep = line.indexOf(',');
+        if (sep == -1) {
+            // status 3 uses tabs where it can
+            sep = line.indexOf('\t');
+        }
+        if (sep == -1) {
+            continue;
+        }
+
+        QStringRef key(line.leftRef(sep));
+        bool ok = false;
+        qint64 value = line.midRef(sep + 1).toLongLong(&ok);
+        if (!ok) {
+            continue;
+        }
+
+        if (key == QLatin1String("TUN/TAP read bytes")) {
+            tunRead = value;
+        } else if (key == QLatin1String("TUN/TAP write bytes")) {
+            tunWrite = value;
+        } else if (key == QLatin1String("TCP/UDP read bytes")) {
+            linkRead = value;
+        } else if (key == QLatin1String("TCP/UDP write bytes")) {
+            linkWrite = value;
+        } else if (key == QLatin1String("pre-compress bytes")) {
+            preCompress = value;
+        } else if (key == QLatin1String("post-compress bytes")) {
+            postCompress = value;
+        } else if (key == QLatin1String("pre-decompress bytes")) {
+            preDecompress = value;
+        } else if (key == QLatin1String("post-decompress bytes")) {
+            postDecompress = value;
+        } else {
+            continue;
+        }
+        found = true;
+    }
+    return found;
+}
+
+QString formatBytes(qint64 bytes) {
+    if (bytes < 1024) {
+        return QString("%1 B").arg(bytes);
+    } else if (bytes < 1024 * 1024) {
+        return QString("%1 KB").arg(bytes / 1024.0, 0, 'f', 1);
+    } else if (bytes < 1024LL * 1024 * 1024) {
+        return QString("%1 MB").arg(bytes / (1024.0 * 1024), 0, 'f', 1);
+    }
+    return QString("%1 GB").arg(bytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
+}
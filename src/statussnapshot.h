@@ -0,0 +1,44 @@
+#ifndef STATUSSNAPSHOT_H
+#define STATUSSNAPSHOT_H
+
+#include <QString>
+#include <QStringList>
+
+/*
+ * What the management interface tells about a connected tunnel.
+ * Addresses come from "state", counters from "status", the cipher from
+ * the openvpn log (not available through the management interface).
+ */
+struct StatusSnapshot {
+    QString localIP;
+    QString localIPv6;
+    QString remoteIP;
+    int remotePort;
+    QString cipher;
+
+    qint64 tunRead;
+    qint64 tunWrite;
+    qint64 linkRead;
+    qint64 linkWrite;
+    qint64 preCompress;
+    qint64 postCompress;
+    qint64 preDecompress;
+    qint64 postDecompress;
+
+    // Link bytes per second since the previous poll
+    qint64 readRate;
+    qint64 writeRate;
+
+    bool valid;
+
+    StatusSnapshot();
+    void clear();
+
+    // Parse a response into this snapshot, only touching what's in it
+    bool parseState(const QStringList &lines);
+    bool parseStatus(const QStringList &lines);
+};
+
+QString formatBytes(qint64 bytes);
+
+#endif // STATUSSNAPSHOT_H
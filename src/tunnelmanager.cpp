@@ -0,0 +1,244 @@
+#include "tunnelmanager.h"
+
+#include <QDebug>
+
+TunnelManager::TunnelManager(const QString &openvpnPath, QObject *parent)
+    : QObject(parent)
+    , m_openvpnPath(openvpnPath)
+    , m_watcher(this)
+{
+    addTunnel();
+}
+
+TunnelManager::~TunnelManager() {
+    foreach (Tunnel *t, m_tunnels) {
+        delete t->reconnector;
+        delete t->poller;
+        delete t->openvpn;
+        delete t;
+    }
+}
+
+TunnelManager::Tunnel *TunnelManager::addTunnel() {
+    Tunnel *t = new Tunnel;
+    t->openvpn = new OpenVPN(this, m_openvpnPath);
+    t->reconnector = new Reconnector(*t->openvpn, m_watcher, this);
+    t->poller = new StatusPoller(*t->openvpn, this);
+    t->removeWhenDisconnected = false;
+
+    connect(t->openvpn, SIGNAL(statusUpdated(OpenVPN::Status)), this, SLOT(tunnelStatusUpdated(OpenVPN::Status)));
+    connect(t->openvpn, SIGNAL(disconnected()), this, SLOT(tunnelDisconnected()));
+    connect(t->openvpn, SIGNAL(authRequested(bool)), this, SLOT(tunnelAuthRequested(bool)));
+    connect(t->reconnector, SIGNAL(reconnectScheduled(int)), this, SLOT(tunnelReconnectScheduled(int)));
+    connect(t->poller, SIGNAL(snapshotUpdated()), this, SLOT(tunnelSnapshotUpdated()));
+
+    m_tunnels.append(t);
+    emit tunnelAdded(t->openvpn);
+    return t;
+}
+
+TunnelManager::Tunnel *TunnelManager::findTunnel(const OpenVPN *openvpn) const {
+    foreach (Tunnel *t, m_tunnels) {
+        if (t->openvpn == openvpn) {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+OpenVPN &TunnelManager::primary() {
+    return *m_tunnels.first()->openvpn;
+}
+
+const OpenVPN &TunnelManager::primary() const {
+    return *m_tunnels.first()->openvpn;
+}
+
+OpenVPN *TunnelManager::find(const QString &name) const {
+    foreach (Tunnel *t, m_tunnels) {
+        if (t->openvpn->getName() == name) {
+            return t->openvpn;
+        }
+    }
+    return nullptr;
+}
+
+QList<OpenVPN *> TunnelManager::tunnels() const {
+    QList<OpenVPN *> list;
+    foreach (Tunnel *t, m_tunnels) {
+        list.append(t->openvpn);
+    }
+    return list;
+}
+
+Reconnector *TunnelManager::getReconnector(const OpenVPN *openvpn) const {
+    Tunnel *t = findTunnel(openvpn);
+    return t ? t->reconnector : nullptr;
+}
+
+StatusPoller *TunnelManager::getStatusPoller(const OpenVPN *openvpn) const {
+    Tunnel *t = findTunnel(openvpn);
+    return t ? t->poller : nullptr;
+}
+
+OpenVPN::Status TunnelManager::getStatus() const {
+    QList<OpenVPN::Status> order;
+    order << OpenVPN::Connected << OpenVPN::Connecting << OpenVPN::Disconnecting;
+
+    foreach (OpenVPN::Status s, order) {
+        foreach (Tunnel *t, m_tunnels) {
+            if (t->openvpn->getStatus() == s) {
+                return s;
+            }
+        }
+    }
+    return OpenVPN::Disconnected;
+}
+
+bool TunnelManager::isReconnectPending() const {
+    foreach (Tunnel *t, m_tunnels) {
+        if (t->reconnector->isPending()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+OpenVPN &TunnelManager::connectTunnel(const QString &name, const QString &configPath,
+                                      bool addTunnel, bool autoReconnect) {
+    Tunnel *t = nullptr;
+
+    if (OpenVPN *existing = find(name)) {
+        t = findTunnel(existing);
+    } else if (!addTunnel || primary().getStatus() == OpenVPN::Disconnected) {
+        t = m_tunnels.first();
+    } else {
+        t = this->addTunnel();
+    }
+
+    // Only removed once the user disconnects it, not on connection loss
+    t->removeWhenDisconnected = false;
+    t->reconnector->cancel();
+    t->reconnector->setEnabled(autoReconnect);
+    t->openvpn->setName(name);
+
+    if (t->openvpn->getStatus() == OpenVPN::Disconnected) {
+        t->openvpn->connect(configPath);
+    } else {
+        t->openvpn->switchConfig(configPath);
+    }
+    return *t->openvpn;
+}
+
+void TunnelManager::disconnectTunnel(OpenVPN *openvpn) {
+    Tunnel *t = findTunnel(openvpn);
+    if (!t) {
+        return;
+    }
+
+    t->reconnector->cancel();
+    if (t != m_tunnels.first()) {
+        t->removeWhenDisconnected = true;
+    }
+    t->openvpn->disconnect();
+
+    // Already stopped, no disconnected() coming
+    if (t->removeWhenDisconnected && t->openvpn->getStatus() == OpenVPN::Disconnected) {
+        m_tunnels.removeOne(t);
+        emit tunnelRemoved(t->openvpn);
+        t->reconnector->deleteLater();
+        t->poller->deleteLater();
+        t->openvpn->deleteLater();
+        delete t;
+    }
+}
+
+void TunnelManager::disconnectAll() {
+    foreach (Tunnel *t, m_tunnels) {
+        disconnectTunnel(t->openvpn);
+    }
+}
+
+void TunnelManager::tunnelStatusUpdated(OpenVPN::Status s) {
+    OpenVPN *openvpn = qobject_cast<OpenVPN *>(sender());
+    if (!openvpn) {
+        return;
+    }
+
+    // Shared by all the Reconnectors, only needed while something is up
+    if (s == OpenVPN::Connecting && !m_watcher.isRunning()) {
+        m_watcher.start();
+    }
+
+    emit statusUpdated(openvpn, s);
+}
+
+void TunnelManager::tunnelReconnectScheduled(int delay) {
+    Reconnector *reconnector = qobject_cast<Reconnector *>(sender());
+    foreach (Tunnel *t, m_tunnels) {
+        if (t->reconnector == reconnector) {
+            emit reconnectScheduled(t->openvpn, delay);
+            return;
+        }
+    }
+}
+
+QJsonObject TunnelManager::getTunnelStatus(const OpenVPN &openvpn) const {
+    QJsonObject o;
+    o["host"] = openvpn.getName();
+    o["status"] = getStatusName(openvpn.getStatus());
+
+    StatusPoller *poller = getStatusPoller(&openvpn);
+    if (poller && poller->getSnapshot().valid) {
+        const StatusSnapshot &s = poller->getSnapshot();
+        o["local_ip"] = s.localIP;
+        o["local_ipv6"] = s.localIPv6;
+        o["remote_ip"] = s.remoteIP;
+        o["remote_port"] = s.remotePort;
+        o["cipher"] = s.cipher;
+        // Doubles in JSON, fine up to 2^53 bytes
+        o["bytes_in"] = static_cast<double>(s.linkRead);
+        o["bytes_out"] = static_cast<double>(s.linkWrite);
+    }
+    return o;
+}
+
+void TunnelManager::tunnelSnapshotUpdated() {
+    StatusPoller *poller = qobject_cast<StatusPoller *>(sender());
+    foreach (Tunnel *t, m_tunnels) {
+        if (t->poller == poller) {
+            emit snapshotUpdated(t->openvpn);
+            return;
+        }
+    }
+}
+
+void TunnelManager::tunnelDisconnected() {
+    OpenVPN *openvpn = qobject_cast<OpenVPN *>(sender());
+    Tunnel *t = findTunnel(openvpn);
+
+    if (t && t->removeWhenDisconnected && openvpn->getStatus() == OpenVPN::Disconnected) {
+        qDebug() << "TunnelManager: removing" << openvpn->getName();
+        m_tunnels.removeOne(t);
+        emit tunnelRemoved(openvpn);
+        t->reconnector->deleteLater();
+        t->poller->deleteLater();
+        openvpn->deleteLater();
+        delete t;
+    }
+
+    if (getStatus() == OpenVPN::Disconnected) {
+        // A Reconnector will start it again if needed
+        if (!isReconnectPending()) {
+            m_watcher.stop();
+        }
+        emit allDisconnected();
+    }
+}
+
+void TunnelManager::tunnelAuthRequested(bool failed) {
+    OpenVPN *openvpn = qobject_cast<OpenVPN *>(sender());
+    if (openvpn) {
+        emit authRequested(openvpn, failed);
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef TUNNELMANAGER_H
+#define TUNNELMANAGER_H
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QJsonObject>
+
+#include "openvpn.h"
+#include "reconnector.h"
+#include "netwatch.h"
+#include "statuspoller.h"
+
+/*
+ * Owns the OpenVPN clients, each with its own process, management port,
+ * config, log, status, Reconnector and StatusPoller.
+ *
+ * The primary tunnel always exists, it's the one used when only one
+ * tunnel is allowed (connecting elsewhere switches it to the new gateway).
+ * When adding tunnels is allowed, every other gateway gets its own client,
+ * removed once disconnected by the user.
+ *
+ * statusUpdated() is aggregated for the tray & control socket, log lines
+ * are only available from each OpenVPN so a window or a control client
+ * only receives the lines of the tunnel it follows.
+ *
+ * Note: on Windows every concurrent tunnel needs its own TAP adapter.
+ */
+class TunnelManager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TunnelManager(const QString &openvpnPath, QObject *parent = nullptr);
+    ~TunnelManager();
+
+    OpenVPN &primary();
+    const OpenVPN &primary() const;
+    OpenVPN *find(const QString &name) const;
+    QList<OpenVPN *> tunnels() const;
+    Reconnector *getReconnector(const OpenVPN *openvpn) const;
+    StatusPoller *getStatusPoller(const OpenVPN *openvpn) const;
+
+    // Connected if any is connected, else Connecting if any is, ...
+    OpenVPN::Status getStatus() const;
+    bool isReconnectPending() const;
+
+    // Status & StatusSnapshot, for the control socket and diagnostics
+    QJsonObject getTunnelStatus(const OpenVPN &openvpn) const;
+
+    OpenVPN &connectTunnel(const QString &name, const QString &configPath,
+                           bool addTunnel, bool autoReconnect);
+    void disconnectTunnel(OpenVPN *openvpn);
+    void disconnectAll();
+
+signals:
+    void tunnelAdded(OpenVPN *openvpn);
+    void tunnelRemoved(OpenVPN *openvpn);
+    void statusUpdated(OpenVPN *openvpn, OpenVPN::Status s);
+    void reconnectScheduled(OpenVPN *openvpn, int delay);
+    // openvpn waits for sendCredentials()
+    void authRequested(OpenVPN *openvpn, bool failed);
+    void snapshotUpdated(OpenVPN *openvpn);
+    void allDisconnected();
+
+private slots:
+    void tunnelStatusUpdated(OpenVPN::Status s);
+    void tunnelReconnectScheduled(int delay);
+    void tunnelSnapshotUpdated();
+    void tunnelDisconnected();
+    void tunnelAuthRequested(bool failed);
+
+private:
+    struct Tunnel {
+        OpenVPN *openvpn;
+        Reconnector *reconnector;
+        StatusPoller *poller;
+        bool removeWhenDisconnected;
+    };
+
+    Tunnel *findTunnel(const OpenVPN *openvpn) const;
+    Tunnel *addTunnel();
+
+    QString m_openvpnPath;
+    NetworkWatcher m_watcher;
+    // m_tunnels[0] is the primary tunnel
+    QList<Tunnel *> m_tunnels;
+};
+
+#endif // TUNNELMANAGER_H
@@ -0,0 +1,985 @@
+#include "vpncore.h"
+#include "diagnostics.h"
+#include "netwatch.h"
+#include "statuspoller.h"
+#include "mtuprobe.h"
+#include "cipherbench.h"
+#include "config.h"
+
+#include <stdexcept>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QUuid>
+#include <QDnsLookup>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QTextStream>
+#include <QTimer>
+#include <QDateTime>
+#include <QSysInfo>
+
+// A and AAAA (with ipv6) at the same time, through one nameserver
+void _safeResolve(QString hostname, QString nameserver, bool ipv6,
+                  QStringList &v4, QStringList &v6, int &ttl) {
+    QDnsLookup a(QDnsLookup::A, hostname);
+    QDnsLookup aaaa(QDnsLookup::AAAA, hostname);
+    QList<QDnsLookup *> lookups;
+    lookups << &a;
+    if (ipv6) {
+        lookups << &aaaa;
+    }
+
+    QEventLoop loop;
+    int pending = lookups.size();
+    foreach (QDnsLookup *dns, lookups) {
+        if (!nameserver.isEmpty()) {
+            dns->setNameserver(QHostAddress(nameserver));
+        }
+        QObject::connect(dns, &QDnsLookup::finished, &loop, [&pending, &loop]() {
+            if (--pending == 0) {
+                loop.quit();
+            }
+        }, Qt::QueuedConnection);
+        dns->lookup();
+    }
+    loop.exec();
+
+    foreach (QDnsLookup *dns, lookups) {
+        if (dns->error() != QDnsLookup::NoError) {
+            // No AAAA is common, only worth a debug line
+            qDebug() << "DNS lookup failed: " << hostname << dns->type();
+            qDebug() << dns->errorString();
+            continue;
+        }
+
+        foreach (QDnsHostAddressRecord record, dns->hostAddressRecords()) {
+            qDebug() << "resolved:" << record.value().toString();
+            ttl = qMin(ttl, static_cast<int>(record.timeToLive()));
+            if (record.value().protocol() == QAbstractSocket::IPv6Protocol) {
+                v6.append(record.value().toString());
+            } else {
+                v4.append(record.value().toString());
+            }
+        }
+    }
+}
+
+QStringList VPNCore::safeResolve(const QString &hostname) {
+    bool ipv6 = resolveIPv6();
+
+    // 0. DNS-over-HTTPS, usually prefetched with the gateways
+    updateDohServer();
+    QStringList cachedV4, cachedV6;
+    bool hit = m_doh.isCached(hostname, ipv6);
+    if (m_doh.resolve(hostname, ipv6, cachedV4, cachedV6) && (!cachedV4.isEmpty() || !cachedV6.isEmpty())) {
+        m_connectMetrics.cacheHits += hit ? 1 : 0;
+        m_connectMetrics.cacheMisses += hit ? 0 : 1;
+        return AddressFamilies::interleave(cachedV4, cachedV6, m_families.preferIPv6());
+    }
+
+    // Prefetched, or resolved recently
+    if (m_dnsCache.lookup(hostname, ipv6, cachedV4, cachedV6)) {
+        m_connectMetrics.cacheHits++;
+        return AddressFamilies::interleave(cachedV4, cachedV6, m_families.preferIPv6());
+    }
+    m_connectMetrics.cacheMisses++;
+
+    QStringList nameservers;
+
+    // 1. Custom nameserver
+    QString appNs(apiNameserver());
+    if (!appNs.isEmpty()) {
+        nameservers.append(appNs);
+    }
+
+    // 2. System default
+    nameservers.append("");
+
+    // 3. Brand nameserver
+    QString providerNs(VpnFeatures::nameserver);
+    if (!providerNs.isEmpty()) {
+        nameservers.append(providerNs);
+    }
+
+    // 4. Fallback
+    nameservers.append("8.8.8.8");
+    nameservers.append("8.8.4.4");
+
+    foreach(QString ns, nameservers) {
+        QStringList v4, v6;
+        int ttl = DnsCache::MaxTtl;
+        _safeResolve(hostname, ns, ipv6, v4, v6, ttl);
+        if (!v4.isEmpty() || !v6.isEmpty()) {
+            m_dnsCache.store(hostname, ipv6, v4, v6, ttl);
+            return AddressFamilies::interleave(v4, v6, m_families.preferIPv6());
+        }
+    }
+    throw std::runtime_error("DNS lookup failed");
+}
+
+bool VPNCore::resolveIPv6() const {
+    return VpnFeatures::ipv6 && m_appSettings.value("ipv6_tunnel", true).toBool();
+}
+
+QString VPNCore::apiNameserver() const {
+    return m_appSettings.value("dns_api").toString();
+}
+
+void VPNCore::prefetchGateways() {
+    QStringList hostnames;
+    foreach (const VPNGateway &gw, m_gateways) {
+        hostnames.append(gw.hostname);
+    }
+
+    updateDohServer();
+    if (!m_doh.server().isEmpty()) {
+        m_doh.prefetch(hostnames, resolveIPv6());
+    } else {
+        m_dnsCache.prefetch(hostnames, apiNameserver(), resolveIPv6());
+    }
+}
+
+VPNCore::ConnectMetrics::ConnectMetrics()
+    : cacheHits(0)
+    , cacheMisses(0)
+    , spawns(0)
+    , lastSpawnMs(0)
+    , totalSpawnMs(0)
+{}
+
+QString VPNCore::ConnectMetrics::toString() const {
+    int lookups = cacheHits + cacheMisses;
+    return QString("DNS cache: %1/%2 hits (%3%), click to spawn: last %4 ms, average %5 ms")
+            .arg(cacheHits).arg(lookups)
+            .arg(lookups ? cacheHits * 100 / lookups : 0)
+            .arg(lastSpawnMs)
+            .arg(spawns ? totalSpawnMs / spawns : 0);
+}
+
+const VPNCore::ConnectMetrics &VPNCore::getConnectMetrics() const {
+    return m_connectMetrics;
+}
+
+void VPNCore::updateDohServer() {
+    m_doh.setServer(QUrl(m_appSettings.value("dns_doh").toString()));
+}
+
+// OPENVPN_VERSION ("v2.4") is at least major.minor
+static bool openvpnAtLeast(int major, int minor) {
+    QStringList parts(QString(OPENVPN_VERSION).mid(1).split('.'));
+    int ourMajor = parts.value(0).toInt();
+    int ourMinor = parts.value(1).toInt();
+    return ourMajor > major || (ourMajor == major && ourMinor >= minor);
+}
+
+// Connected: which family did openvpn end up using
+void VPNCore::learnAddressFamily(OpenVPN *openvpn) {
+    if (!m_firstFamilies.contains(openvpn->getName())) {
+        return;
+    }
+    StatusPoller *poller = m_tunnels.getStatusPoller(openvpn);
+    if (!poller || !poller->getSnapshot().valid || poller->getSnapshot().remoteIP.isEmpty()) {
+        return;
+    }
+
+    QAbstractSocket::NetworkLayerProtocol first = m_firstFamilies.take(openvpn->getName());
+    QAbstractSocket::NetworkLayerProtocol used = QHostAddress(poller->getSnapshot().remoteIP).protocol();
+    m_families.record(first, used == first);
+    if (used != first) {
+        m_families.record(used, true);
+    }
+}
+
+VPNCore::VPNCore(Installer &installer, QObject *parent, Mode mode)
+    : QObject(parent)
+    , m_gatewaysReply(nullptr)
+    , m_appSettings(VPNGUI_ORGNAME, getName())
+    , m_qnam(this)
+    , m_doh(m_qnam)
+    , m_compression(m_appSettings)
+    , m_families(m_appSettings)
+    , m_installer(installer)
+    , m_tunnels(m_installer.getDir().filePath("openvpn.exe"), this)
+    , m_logStore(this)
+    , m_controlServer(*this)
+    , m_diagnosticsRunning(false)
+    , m_mtuProbeRunning(false)
+{
+    if (mode == ConfigOnly) {
+        m_tempConfigDir.reset(new QTemporaryDir);
+        m_configDir = QDir(m_tempConfigDir->path());
+        return;
+    }
+
+    // Cleanup OpenVPN config dir
+    m_configDir = QDir(m_installer.getDir().filePath("openvpn_config"));
+    if (m_configDir.exists()) {
+        foreach(QString f, m_configDir.entryList(QDir::Files)) {
+            m_configDir.remove(f);
+        }
+    } else {
+        m_configDir.mkdir(".");
+    }
+
+    // Keep the logs of every tunnel on disk
+    m_logStore.open(m_installer.getDir().filePath("logs"));
+    connect(&m_tunnels, SIGNAL(tunnelAdded(OpenVPN*)), this, SLOT(storeTunnelLog(OpenVPN*)));
+    connect(&m_tunnels, SIGNAL(authRequested(OpenVPN*,bool)), this, SLOT(tunnelAuthRequested(OpenVPN*,bool)));
+    connect(&m_tunnels, SIGNAL(snapshotUpdated(OpenVPN*)), this, SLOT(rememberProtocol(OpenVPN*)));
+    connect(&m_tunnels, SIGNAL(snapshotUpdated(OpenVPN*)), this, SLOT(learnAddressFamily(OpenVPN*)));
+    connect(&m_tunnels, SIGNAL(snapshotUpdated(OpenVPN*)), this, SLOT(updateCompression(OpenVPN*)));
+    connect(&m_tunnels, SIGNAL(snapshotUpdated(OpenVPN*)), this, SLOT(updateLinkPeak(OpenVPN*)));
+    foreach (OpenVPN *openvpn, m_tunnels.tunnels()) {
+        storeTunnelLog(openvpn);
+    }
+
+    // Once per CPU, the result goes in the configs
+    if (m_appSettings.value("cipher_benchmark/key").toString() != CipherBenchmark::cacheKey()) {
+        CipherBenchmark *bench = new CipherBenchmark;
+        connect(bench, SIGNAL(finished(QStringList)), this, SLOT(cipherBenchmarkFinished(QStringList)));
+        bench->start();
+    }
+
+    m_mtuTimer.setInterval(MtuProbeInterval);
+    connect(&m_mtuTimer, SIGNAL(timeout()), this, SLOT(reprobePathMtu()));
+    m_mtuTimer.start();
+
+    m_controlServer.listen(ControlServer::socketName(m_installer));
+}
+
+VPNCore::~VPNCore() {
+    m_controlServer.close();
+    m_logStore.close();
+}
+
+QString VPNCore::getName() const {
+    return QString(VpnFeatures::name);
+}
+
+QString VPNCore::getDisplayName() const {
+    return QString(VpnFeatures::display_name);
+}
+
+QString VPNCore::getFullVersion() const {
+    return QString(VPNGUI_VERSION);
+}
+
+QString VPNCore::getURL() const {
+    return QString(VpnFeatures::url);
+}
+
+QString VPNCore::getUserAgent() const {
+    // User-Agent: Branded-name/version-bv Project-name/version
+    QString ua;
+    ua += getName() + "/" + getFullVersion();
+    ua += " (" + getURL() + ")";
+    ua += " " VPNGUI_ORGNAME "-" VPNGUI_NAME "/" VPNGUI_VERSION;
+    ua += " (" VPNGUI_URL ")";
+    return ua;
+}
+
+void VPNCore::queryGateways() {
+    QString url(VpnFeatures::locations_url);
+
+    if (url.isEmpty()) {
+        /*
+         * TODO: Feature idea:
+         * load gateways from provider.ini for providers with no API
+         * [gateways] gw<N> = <a serialized map/VPNGateway>
+         */
+        return;
+    } else {
+        QNetworkRequest request;
+        request.setRawHeader("User-Agent", getUserAgent().toUtf8());
+        request.setUrl(url);
+
+        m_gatewaysReply = m_qnam.get(request);
+        connect(m_gatewaysReply, &QNetworkReply::finished, this, &VPNCore::gatewaysQueryFinished);
+    }
+}
+
+void VPNCore::requestAuth(OpenVPN &openvpn, bool failed) {
+    VPNCreds c;
+    if (getKnownCredentials(c, failed)) {
+        openvpn.sendCredentials(c);
+        return;
+    }
+
+    // Nobody to ask
+    qDebug() << "No usable saved credentials, disconnecting";
+    m_tunnels.disconnectTunnel(&openvpn);
+}
+
+void VPNCore::tunnelAuthRequested(OpenVPN *openvpn, bool failed) {
+    requestAuth(*openvpn, failed);
+}
+
+bool VPNCore::getKnownCredentials(VPNCreds &c, bool failed) {
+    if (failed) {
+        m_sessionCreds.clear();
+        return false;
+    }
+
+    if (!m_sessionCreds.username.isEmpty()) {
+        c = m_sessionCreds;
+        return true;
+    }
+
+    if (readSavedCredentials(c)) {
+        m_sessionCreds = c;
+        return true;
+    }
+    return false;
+}
+
+void VPNCore::rememberCredentials(const VPNCreds &c) {
+    m_sessionCreds = c;
+}
+
+void VPNCore::forgetCredentials() {
+    m_appSettings.remove("auth");
+    m_sessionCreds.clear();
+}
+
+bool VPNCore::readSavedCredentials(VPNCreds &c) {
+    if (!m_appSettings.contains("auth")) {
+        return false;
+    }
+
+    QByteArray encrypted = m_appSettings.value("auth").toByteArray();
+    if (encrypted.length() < 2) {
+        return false;
+    }
+
+    PwStore pwstore;
+    bool legacy = false;
+    SecureBuffer decrypted(pwstore.decrypt(encrypted, &legacy));
+
+    int sep = decrypted.indexOf(':');
+    if (sep == -1) {
+        return false;
+    }
+
+    c.username = decrypted.mid(0, sep);
+    c.password = decrypted.mid(sep + 1);
+
+    // Encrypted with the old key, move it to the new one
+    if (legacy) {
+        saveCredentials(c);
+    }
+
+    return true;
+}
+
+void VPNCore::saveCredentials(const VPNCreds &c) {
+    PwStore pwstore;
+    SecureBuffer text(c.username);
+    text.append(':');
+    text.append(c.password);
+    QByteArray encrypted(pwstore.encrypt(text));
+    m_appSettings.setValue("auth", encrypted);
+}
+
+
+// The winning protocol, per network and gateway
+// Per network settings: path_mtu, link_rtt, link_peak
+static QString networkKey(const QString &name, const QByteArray &network) {
+    return name + "/" + QString(network.toHex().left(16));
+}
+
+static QString pathMtuKey(const QByteArray &network) {
+    return networkKey("path_mtu", network);
+}
+
+static QString autoProtocolKey(const QByteArray &network, const QString &hostname) {
+    return "auto_protocol/" + QString(network.toHex().left(16)) + "/" + hostname;
+}
+
+void VPNCore::vpnConnect(QString hostname) {
+    qDebug() << "Connecting to " << hostname;
+    m_connectClicks[hostname].start();
+
+    QString protocol(getCurrentProtocol(m_appSettings));
+    if (protocol != "auto") {
+        startTunnel(hostname, QStringList(protocol));
+        return;
+    }
+
+    if (m_protocolProbes.contains(hostname)) {
+        // Already racing, it will connect
+        return;
+    }
+
+    QStringList order;
+    foreach (const ProtocolProbe::Target &t, getProtocolTargets()) {
+        order.append(t.protocol);
+    }
+
+    // Through a proxy, only TCP works
+    if (!m_appSettings.value("http_proxy").toString().isEmpty()) {
+        startTunnel(hostname, QStringList("tcp"));
+        return;
+    }
+
+    QByteArray network(NetworkWatcher::networkId());
+    m_connectNetworks[hostname] = network;
+
+    // Known network: what worked last time first, the others as fallback
+    QString remembered(m_appSettings.value(autoProtocolKey(network, hostname)).toString());
+    if (order.contains(remembered)) {
+        order.removeOne(remembered);
+        order.prepend(remembered);
+        startTunnel(hostname, order);
+        return;
+    }
+
+    // With tls-auth/tls-crypt the server doesn't answer our probe
+    QString addConfig(m_appSettings.value("additional_config").toString());
+    if (addConfig.contains("tls-auth") || addConfig.contains("tls-crypt")) {
+        startTunnel(hostname, order);
+        return;
+    }
+
+    QStringList addresses(safeResolve(hostname));
+    ProtocolProbe *probe = new ProtocolProbe(addresses.first(), getProtocolTargets(), this);
+    probe->setProperty("hostname", hostname);
+    probe->setProperty("addresses", addresses);
+    connect(probe, SIGNAL(finished(QStringList,QString)), this, SLOT(protocolProbeFinished(QStringList,QString)));
+    m_protocolProbes.insert(hostname, probe);
+    probe->start();
+}
+
+void VPNCore::startTunnel(const QString &hostname, const QStringList &protocols,
+                          QStringList addresses) {
+    if (addresses.isEmpty()) {
+        addresses = safeResolve(hostname);
+    }
+
+    // Both families: find out if the first one works
+    m_firstFamilies.remove(hostname);
+    QAbstractSocket::NetworkLayerProtocol first = QHostAddress(addresses.first()).protocol();
+    foreach (QString addr, addresses) {
+        if (QHostAddress(addr).protocol() != first) {
+            m_firstFamilies[hostname] = first;
+            break;
+        }
+    }
+
+    // New network: measure it for the next connects
+    if (!m_appSettings.contains(pathMtuKey(NetworkWatcher::networkId()))) {
+        startMtuProbe(addresses);
+    }
+
+    bool addTunnel = m_appSettings.value("multi_tunnel", false).toBool();
+    bool autoReconnect = m_appSettings.value("auto_reconnect", true).toBool();
+    QString config(makeOpenVPNConfig(hostname, protocols, addresses));
+    OpenVPN &openvpn = m_tunnels.connectTunnel(hostname, config, addTunnel, autoReconnect);
+    if (m_socketTunings.contains(hostname)) {
+        openvpn.logStatus(m_socketTunings.take(hostname));
+    }
+
+    if (m_connectClicks.contains(hostname)) {
+        qint64 ms = m_connectClicks.take(hostname).elapsed();
+        m_connectMetrics.spawns++;
+        m_connectMetrics.lastSpawnMs = ms;
+        m_connectMetrics.totalSpawnMs += ms;
+        qDebug() << "Connect:" << hostname << "started after" << ms << "ms -" << m_connectMetrics.toString();
+    }
+    emit tunnelStarted(&openvpn);
+}
+
+void VPNCore::protocolProbeFinished(const QStringList &order, const QString &winner) {
+    ProtocolProbe *probe = qobject_cast<ProtocolProbe *>(sender());
+    if (!probe) {
+        return;
+    }
+    QString hostname(probe->property("hostname").toString());
+    QStringList addresses(probe->property("addresses").toStringList());
+    m_protocolProbes.remove(hostname);
+    probe->deleteLater();
+
+    qDebug() << "Protocol for" << hostname << ":" << (winner.isEmpty() ? "no answer" : winner);
+
+    try {
+        startTunnel(hostname, order, addresses);
+    }
+    catch (std::exception &e) {
+        qDebug() << "Cannot connect to" << hostname << ":" << e.what();
+    }
+}
+
+void VPNCore::cancelProtocolProbe(const QString &hostname) {
+    ProtocolProbe *probe = m_protocolProbes.take(hostname);
+    if (probe) {
+        probe->disconnect(this);
+        probe->deleteLater();
+    }
+}
+
+// Connected: remember which of the remotes openvpn ended up using
+void VPNCore::rememberProtocol(OpenVPN *openvpn) {
+    if (!m_connectNetworks.contains(openvpn->getName())) {
+        return;
+    }
+    StatusPoller *poller = m_tunnels.getStatusPoller(openvpn);
+    if (!poller || !poller->getSnapshot().valid) {
+        return;
+    }
+
+    int port = poller->getSnapshot().remotePort;
+    foreach (const ProtocolProbe::Target &t, getProtocolTargets()) {
+        if (t.port == port) {
+            QByteArray network(m_connectNetworks.take(openvpn->getName()));
+            m_appSettings.setValue(autoProtocolKey(network, openvpn->getName()), t.protocol);
+            return;
+        }
+    }
+}
+
+void VPNCore::updateCompression(OpenVPN *openvpn) {
+    StatusPoller *poller = m_tunnels.getStatusPoller(openvpn);
+    if (poller && m_compression.update(openvpn->getName(), poller->getSnapshot())) {
+        openvpn->logStatus(QString("Compression saves only %1%, the gateway could turn it off")
+                           .arg(m_compression.saving(openvpn->getName()), 0, 'f', 1));
+    }
+}
+
+// Highest throughput seen on this network, for the socket buffers
+void VPNCore::updateLinkPeak(OpenVPN *openvpn) {
+    StatusPoller *poller = m_tunnels.getStatusPoller(openvpn);
+    if (!poller || !poller->getSnapshot().valid) {
+        return;
+    }
+
+    const StatusSnapshot &s(poller->getSnapshot());
+    qint64 rate = qMax(s.readRate, s.writeRate);
+    QString key(networkKey("link_peak", NetworkWatcher::networkId()));
+    if (rate > m_appSettings.value(key, 0).toLongLong()) {
+        m_appSettings.setValue(key, rate);
+    }
+}
+
+void VPNCore::cipherBenchmarkFinished(const QStringList &order) {
+    m_appSettings.setValue("cipher_benchmark/key", CipherBenchmark::cacheKey());
+    m_appSettings.setValue("cipher_benchmark/order", order);
+}
+
+void VPNCore::startMtuProbe(const QStringList &addresses) {
+    if (m_mtuProbeRunning) {
+        return;
+    }
+
+    // ICMP probe, IPv4 only
+    foreach (QString addr, addresses) {
+        if (QHostAddress(addr).protocol() != QAbstractSocket::IPv4Protocol) {
+            continue;
+        }
+        m_mtuProbeRunning = true;
+        m_mtuProbeNetwork = NetworkWatcher::networkId();
+        MtuProbe *probe = new MtuProbe(addr);
+        connect(probe, SIGNAL(finished(QString,int,int)), this, SLOT(pathMtuProbed(QString,int,int)));
+        probe->start();
+        return;
+    }
+}
+
+void VPNCore::reprobePathMtu() {
+    QStringList addresses;
+    foreach (OpenVPN *openvpn, m_tunnels.tunnels()) {
+        StatusPoller *poller = m_tunnels.getStatusPoller(openvpn);
+        if (openvpn->getStatus() == OpenVPN::Connected && poller
+                && !poller->getSnapshot().remoteIP.isEmpty()) {
+            addresses.append(poller->getSnapshot().remoteIP);
+        }
+    }
+    startMtuProbe(addresses);
+}
+
+void VPNCore::pathMtuProbed(const QString &address, int mtu, int rtt) {
+    m_mtuProbeRunning = false;
+    if (mtu <= 0) {
+        return;
+    }
+    m_appSettings.setValue(networkKey("link_rtt", m_mtuProbeNetwork), rtt);
+
+    // Applied on the next connect, mssfix can't be changed on a running tunnel
+    QString key(pathMtuKey(m_mtuProbeNetwork));
+    if (m_appSettings.value(key, 0).toInt() != mtu) {
+        qDebug() << "Path MTU to" << address << ":" << mtu;
+        m_appSettings.setValue(key, mtu);
+    }
+}
+
+void VPNCore::vpnDisconnect() {
+    foreach (QString hostname, m_protocolProbes.keys()) {
+        cancelProtocolProbe(hostname);
+    }
+    m_tunnels.disconnectAll();
+}
+
+void VPNCore::vpnDisconnect(const QString &hostname) {
+    cancelProtocolProbe(hostname);
+    OpenVPN *openvpn = m_tunnels.find(hostname);
+    if (openvpn) {
+        m_tunnels.disconnectTunnel(openvpn);
+    }
+}
+
+void VPNCore::shutdown() {
+    if (m_tunnels.getStatus() == OpenVPN::Disconnected) {
+        QCoreApplication::quit();
+        return;
+    }
+
+    // OpenVPN kills the process if it doesn't exit by itself, the timer
+    // is only there in case something really goes wrong.
+    connect(&m_tunnels, SIGNAL(allDisconnected()), QCoreApplication::instance(), SLOT(quit()));
+    QTimer::singleShot(10000, QCoreApplication::instance(), SLOT(quit()));
+    m_tunnels.disconnectAll();
+}
+
+bool VPNCore::createDiagnostics(const QString &path) {
+    if (m_diagnosticsRunning) {
+        return false;
+    }
+
+    DiagnosticsBundle::Inputs in;
+    in.name = getName() + "-diagnostics-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
+    in.installDir = m_installer.getDir().absolutePath();
+
+    QStringList info;
+    info << getDisplayName() + " - " + getName() + " " + getFullVersion();
+    info << getUserAgent();
+    info << "OpenVPN: " OPENVPN_VERSION;
+    info << "Qt: " + QString(qVersion());
+    info << "OS: " + QSysInfo::prettyProductName() + " " + QSysInfo::currentCpuArchitecture();
+    info << "Install dir: " + in.installDir;
+    info << "Date: " + QDateTime::currentDateTime().toString(Qt::ISODate);
+    info << m_connectMetrics.toString();
+    in.info = (info.join("\n") + "\n").toUtf8();
+
+    in.settings = DiagnosticsBundle::sanitizeSettings(m_appSettings);
+
+    QJsonArray tunnels;
+    foreach (OpenVPN *openvpn, m_tunnels.tunnels()) {
+        tunnels.append(m_tunnels.getTunnelStatus(*openvpn));
+    }
+    in.tunnels = QJsonDocument(tunnels).toJson();
+
+    in.index = m_installer.getIndex();
+    foreach (QString f, m_configDir.entryList(QDir::Files)) {
+        in.configFiles.append(m_configDir.filePath(f));
+    }
+    in.logSegments = m_logStore.getSegmentFiles();
+
+    DiagnosticsBundle *bundle = new DiagnosticsBundle(in, path);
+    connect(bundle, SIGNAL(finished(QString,bool,QString)), this, SLOT(diagnosticsDone(QString,bool,QString)));
+    m_diagnosticsRunning = true;
+    bundle->start();
+    return true;
+}
+
+QString VPNCore::newDiagnosticsPath() {
+    QDir dir(m_installer.getDir().filePath("diagnostics"));
+    if (!dir.exists()) {
+        dir.mkpath(".");
+    }
+    QString name(QString("%1-diagnostics-%2.tar.gz").arg(getName(), QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+    return dir.filePath(name);
+}
+
+void VPNCore::diagnosticsDone(const QString &path, bool ok, const QString &error) {
+    m_diagnosticsRunning = false;
+    qDebug() << "Diagnostics:" << path << ok << error;
+    emit diagnosticsFinished(path, ok, error);
+}
+
+QString VPNCore::makeOpenVPNConfig(const QString &hostname, const QStringList &protocols,
+                                   QStringList addresses, bool learned) {
+    if (addresses.isEmpty()) {
+        addresses = safeResolve(hostname);
+    }
+
+    QString name(QUuid::createUuid().toString() + ".ovpn");
+    QString path(m_configDir.filePath(name));
+
+    QFile f(path);
+    if (!f.open(QFile::WriteOnly | QFile::Text)) {
+        qDebug() << "Cannot write config file " << path;
+        throw std::runtime_error("Cannot write config file " + path.toStdString());
+    }
+
+    QTextStream s(&f);
+
+    // Common
+    s << "verb 3\n";
+    s << "client\n";
+    s << "tls-client\n";
+    s << "remote-cert-tls server\n";
+    s << "dev tun\n";
+    s << "nobind\n";
+    s << "persist-key\n";
+    s << "persist-tun\n";
+    s << "auth-user-pass\n";
+    s << "register-dns\n";
+
+    if (VpnFeatures::default_gw) {
+        s << "redirect-gateway def1\n";
+    }
+    if (VpnFeatures::compression) {
+        // Always: "comp-lzo no" would drop what the server compresses
+        s << "compress lzo\n";
+        if (learned) {
+            m_compression.track(hostname);
+        }
+    }
+
+    if (VpnFeatures::ipv6
+        && m_appSettings.value("ipv6_tunnel", true).toBool()) {
+        s << "tun-ipv6\n";
+        if (VpnFeatures::default_gw) {
+            s << "route-ipv6 2000::/3\n";
+        }
+    }
+
+    // Ca
+    s << "<ca>\n" << VpnFeatures::openvpn_ca << "\n</ca>\n";
+
+    // Remote
+    // In order: each protocol on every server, the servers already shuffled
+    // and interleaved by family by safeResolve(). Don't wait too long on
+    // one when there are others to try.
+    if (protocols.size() * addresses.size() > 1) {
+        s << "server-poll-timeout 10\n";
+    }
+
+    QList<ProtocolProbe::Target> targets(getProtocolTargets());
+    foreach (QString protocol, protocols) {
+        foreach (const ProtocolProbe::Target &t, targets) {
+            if (t.protocol != protocol) {
+                continue;
+            }
+            foreach (QString addr, addresses) {
+                s << "remote " << addr << " " << t.port << " " << (t.udp ? "udp" : "tcp") << "\n";
+            }
+        }
+    }
+
+    // Options
+    QString httpProxy(m_appSettings.value("http_proxy").toString());
+    QString dns(m_appSettings.value("dns_system").toString());
+
+    if (!httpProxy.isEmpty()) {
+        s << "http-proxy " << httpProxy << "\n";
+    }
+    if (!dns.isEmpty()) {
+        s << "dhcp-option DNS " << dns << "\n";
+    }
+
+    // Data channel ciphers the server may pick, the benchmarked ones our
+    // openvpn can negotiate. 2.4 only negotiates AES-GCM (ncp-ciphers), 2.5
+    // added ChaCha20-Poly1305 and renamed the option data-ciphers.
+    // The server picks by the order of its own list, ours doesn't matter.
+    bool dataCiphers = openvpnAtLeast(2, 5);
+    QStringList ciphers;
+    foreach (QString cipher, m_appSettings.value("cipher_benchmark/order").toStringList()) {
+        if (dataCiphers || cipher.startsWith("AES-")) {
+            ciphers.append(cipher);
+        }
+    }
+    if (!ciphers.isEmpty()) {
+        s << (dataCiphers ? "data-ciphers " : "ncp-ciphers ") << ciphers.join(':') << "\n";
+    }
+
+    // Inputs measured on this network
+    if (learned) {
+        // Smaller packets on links with a small path MTU (PPPoE, LTE, ...),
+        // instead of fragmented ones. tun-mtu and fragment have to match the
+        // server, mssfix doesn't.
+        QByteArray network(NetworkWatcher::networkId());
+        int pathMtu = m_appSettings.value(pathMtuKey(network), 0).toInt();
+        bool udp = false;
+        foreach (const ProtocolProbe::Target &t, targets) {
+            udp = udp || (t.udp && protocols.contains(t.protocol));
+        }
+        int overhead = 20 + 8;
+        foreach (QString addr, addresses) {
+            if (QHostAddress(addr).protocol() == QAbstractSocket::IPv6Protocol) {
+                overhead = 40 + 8;
+            }
+        }
+        if (udp && pathMtu > 0 && pathMtu - overhead < DefaultMssfix) {
+            s << "mssfix " << (pathMtu - overhead) << "\n";
+        }
+
+        // Socket buffers for the bandwidth-delay product of this network
+        int rtt = m_appSettings.value(networkKey("link_rtt", network), 0).toInt();
+        qint64 peak = m_appSettings.value(networkKey("link_peak", network), 0).toLongLong();
+        SocketTuning tuning(getSocketTuning(udp));
+        m_socketTunings[hostname] = QString("Socket tuning: %1 - RTT %2 ms, peak %3/s")
+                                    .arg(tuning.toString()).arg(rtt).arg(formatBytes(peak));
+        qDebug() << hostname << m_socketTunings[hostname];
+        s << "# Socket tuning: RTT " << rtt << " ms, peak " << peak << " B/s\n";
+        s << "sndbuf " << tuning.sndbuf << "\n";
+        s << "rcvbuf " << tuning.rcvbuf << "\n";
+        if (tuning.fastIo) {
+            s << "fast-io\n";
+        }
+        if (tuning.txqueuelen > 0) {
+            s << "txqueuelen " << tuning.txqueuelen << "\n";
+        }
+    }
+
+    // Additional config
+    QString addConfig(m_appSettings.value("additional_config").toString());
+    if (!addConfig.isEmpty()) {
+        s << "# Additional config\n";
+        s << m_appSettings.value("additional_config").toString() << "\n";
+    }
+
+    s.flush();
+    f.close();
+    return path;
+}
+
+SocketTuning VPNCore::getSocketTuning(bool udp) const {
+    QByteArray network(NetworkWatcher::networkId());
+    int rtt = m_appSettings.value(networkKey("link_rtt", network), 0).toInt();
+    qint64 peak = m_appSettings.value(networkKey("link_peak", network), 0).toLongLong();
+    return SocketTuning::choose(udp, rtt, peak);
+}
+
+bool gatewaysSort(const VPNGateway &gw1, const VPNGateway &gw2) {
+    return gw1.display_name < gw2.display_name;
+}
+
+void VPNCore::gatewaysQueryFinished() {
+    if (!m_gatewaysReply) {
+        return;
+    }
+
+    if (m_gatewaysReply->error()) {
+        emit gatewaysError(m_gatewaysReply->errorString());
+        onGatewaysReady();
+        return;
+    }
+
+    QString jsonStr = m_gatewaysReply->readAll();
+    QJsonDocument json(QJsonDocument::fromJson(jsonStr.toUtf8()));
+    QJsonObject root(json.object());
+    QJsonArray locations(root["locations"].toArray());
+
+    m_gateways.clear();
+    for (int i=0; i<locations.size(); ++i) {
+        QJsonObject loc(locations[i].toObject());
+        VPNGateway gw;
+        gw.display_name = loc["country_name"].toString();
+        gw.hostname = loc["hostname"].toString();
+        m_gateways.append(gw);
+    }
+
+    // Add any additional gateway
+    QString addConfig(m_appSettings.value("additional_config").toString());
+    for (QString &line : addConfig.split('\n')) {
+        if (!line.startsWith("#$")) {
+            continue;
+        }
+        QStringList parts(line.split(' '));
+        if (parts.length() == 3 && parts[1].trimmed() == "server") {
+            VPNGateway gw;
+            gw.hostname = parts[2].trimmed();
+            gw.display_name = "$ " + gw.hostname;
+            m_gateways.append(gw);
+        }
+    }
+
+    qSort(m_gateways.begin(), m_gateways.end(), &gatewaysSort);
+    prefetchGateways();
+    emit gatewaysUpdated();
+    onGatewaysReady();
+}
+
+// Called after queryGateways() has finished/failed
+void VPNCore::onGatewaysReady() {
+    QString autoconnect(m_appSettings.value("autoconnect").toString());
+    if (!autoconnect.isEmpty()) {
+        vpnConnect(autoconnect);
+    }
+}
+
+const QSettings &VPNCore::getAppSettings() const {
+    return m_appSettings;
+}
+
+const Installer &VPNCore::getInstaller() const {
+    return m_installer;
+}
+
+const QList<VPNGateway> &VPNCore::getGatewayList() const {
+    return m_gateways;
+}
+
+const OpenVPN &VPNCore::getOpenVPN() const {
+    return m_tunnels.primary();
+}
+
+const TunnelManager &VPNCore::getTunnels() const {
+    return m_tunnels;
+}
+
+const LogStore &VPNCore::getLogStore() const {
+    return m_logStore;
+}
+
+void VPNCore::storeTunnelLog(OpenVPN *openvpn) {
+    connect(openvpn, SIGNAL(logUpdated(LogEntry)), this, SLOT(storeLogLine(LogEntry)));
+}
+
+void VPNCore::storeLogLine(const LogEntry &entry) {
+    m_logStore.append(entry);
+}
+
+QString getCurrentProtocol(QSettings &appSettings) {
+    QString defaultProtocol(VpnFeatures::default_protocol);
+    QString currentProtocol(appSettings.value("protocol", defaultProtocol).toString());
+
+    QSet<QString> knownProtocols;
+    for (auto &proto : VpnFeatures::protocols) {
+        knownProtocols << QString(proto);
+    }
+    if (knownProtocols.size() > 1) {
+        knownProtocols << "auto";
+    }
+
+    // Check currentProtocol (to always have an option checked)
+    if (!knownProtocols.contains(currentProtocol)) {
+        currentProtocol = defaultProtocol;
+        appSettings.setValue("protocol", defaultProtocol);
+    }
+
+    return currentProtocol;
+}
+
+QList<ProtocolProbe::Target> getProtocolTargets() {
+    QList<ProtocolProbe::Target> targets;
+    for (auto &proto : VpnFeatures::protocols) {
+        ProtocolProbe::Target t;
+        t.protocol = QString(proto);
+        if (t.protocol == "udp") {
+            t.port = 1196;
+            t.udp = true;
+        } else if (t.protocol == "udpl") {
+            t.port = 1194;
+            t.udp = true;
+        } else if (t.protocol == "tcp") {
+            t.port = 443;
+            t.udp = false;
+        } else {
+            continue;
+        }
+        targets.append(t);
+    }
+    return targets;
+}
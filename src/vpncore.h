@@ -0,0 +1,219 @@
+#ifndef VPNCORE_H
+#define VPNCORE_H
+
+#include <QObject>
+#include <QSettings>
+#include <QNetworkReply>
+#include <QNetworkAccessManager>
+#include <QList>
+#include <QString>
+#include <QDir>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QAbstractSocket>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "installer.h"
+#include "openvpn.h"
+#include "pwstore.h"
+#include "controlserver.h"
+#include "tunnelmanager.h"
+#include "logstore.h"
+#include "protocolprobe.h"
+#include "dohresolver.h"
+#include "dnscache.h"
+#include "compressionpolicy.h"
+#include "addressfamilies.h"
+#include "sockettuning.h"
+
+struct VPNGateway {
+    QString display_name;
+    QString hostname;
+};
+
+// Helper to get the selected protocol, check provider settings, and
+// default/fallback to UDP. "auto" if the protocols are raced.
+QString getCurrentProtocol(QSettings &appSettings);
+
+// Port & transport of the provider's protocols, in their default order
+QList<ProtocolProbe::Target> getProtocolTargets();
+
+/*
+ * Application logic that doesn't need any widget:
+ * settings, gateways list, DNS, OpenVPN config and the OpenVPN clients.
+ * VPNGUI adds the tray icon and windows on top of it, VPNDaemon runs it
+ * headless. Both can be driven through the ControlServer.
+ */
+class VPNCore : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode {
+        // Control socket, logs on disk, background measurements
+        Full,
+        // Only makeOpenVPNConfig(), for benchmarks: nothing is started and
+        // nothing in the install dir is touched, configs are written in a
+        // temporary directory
+        ConfigOnly,
+    };
+
+    explicit VPNCore(Installer &installer, QObject *parent = nullptr, Mode mode = Full);
+    virtual ~VPNCore();
+
+    // openvpn needs credentials, answer with OpenVPN::sendCredentials().
+    // Without a GUI, only known credentials can be used.
+    virtual void requestAuth(OpenVPN &openvpn, bool failed=false);
+
+    void queryGateways();
+    // protocols: in the order openvpn should try them.
+    // addresses: resolved here if empty.
+    // learned: use what was learned about the gateway and the network
+    // (path MTU, socket buffers) and track the compression savings.
+    // Without, nothing is read or recorded for them, for benchmarks; the
+    // framing (compression) is the same either way.
+    QString makeOpenVPNConfig(const QString &hostname, const QStringList &protocols,
+                              QStringList addresses = QStringList(), bool learned = true);
+    QStringList safeResolve(const QString &hostname);
+    // Socket options for the current network, what makeOpenVPNConfig()
+    // uses when learned
+    SocketTuning getSocketTuning(bool udp) const;
+
+    const QSettings &getAppSettings() const;
+    const QList<VPNGateway> &getGatewayList() const;
+    const Installer &getInstaller() const;
+    const OpenVPN &getOpenVPN() const;
+    const TunnelManager &getTunnels() const;
+    const LogStore &getLogStore() const;
+
+    QString getName() const;
+    QString getDisplayName() const;
+    QString getFullVersion() const;
+    QString getURL() const;
+    QString getUserAgent() const;
+
+    // Since startup: safeResolve() answered from a cache or not, and time
+    // from vpnConnect() to the OpenVPN process being started
+    struct ConnectMetrics {
+        int cacheHits;
+        int cacheMisses;
+        int spawns;
+        qint64 lastSpawnMs;
+        qint64 totalSpawnMs;
+
+        ConnectMetrics();
+        QString toString() const;
+    };
+    const ConnectMetrics &getConnectMetrics() const;
+
+signals:
+    void gatewaysUpdated();
+    void gatewaysError(const QString &error);
+    void diagnosticsFinished(const QString &path, bool ok, const QString &error);
+    // After vpnConnect(), once the config is ready (may be after a probe)
+    void tunnelStarted(OpenVPN *openvpn);
+
+public slots:
+    virtual void vpnConnect(QString hostname);
+    void vpnDisconnect();
+    void vpnDisconnect(const QString &hostname);
+
+    // Resolve every gateway in the background, connecting is then only a
+    // cache lookup
+    void prefetchGateways();
+
+    // Disconnect, then quit the application
+    void shutdown();
+
+    // Saved and session credentials
+    void forgetCredentials();
+
+    // Write a diagnostics bundle in the background, false if one is
+    // already being written. diagnosticsFinished() is emitted when done.
+    bool createDiagnostics(const QString &path);
+    // New bundle path in the install dir, for callers that can't be
+    // trusted with choosing where the elevated process writes
+    QString newDiagnosticsPath();
+
+    void gatewaysQueryFinished();
+
+private slots:
+    void storeTunnelLog(OpenVPN *openvpn);
+    void storeLogLine(const LogEntry &entry);
+    void diagnosticsDone(const QString &path, bool ok, const QString &error);
+    void protocolProbeFinished(const QStringList &order, const QString &winner);
+    void rememberProtocol(OpenVPN *openvpn);
+    void learnAddressFamily(OpenVPN *openvpn);
+    void reprobePathMtu();
+    void pathMtuProbed(const QString &address, int mtu, int rtt);
+    void updateLinkPeak(OpenVPN *openvpn);
+    void cipherBenchmarkFinished(const QStringList &order);
+    void updateCompression(OpenVPN *openvpn);
+    void tunnelAuthRequested(OpenVPN *openvpn, bool failed);
+
+protected:
+    // From this session, or saved. Forgotten when failed.
+    bool getKnownCredentials(VPNCreds &c, bool failed);
+    void rememberCredentials(const VPNCreds &c);
+    bool readSavedCredentials(VPNCreds &c);
+    void saveCredentials(const VPNCreds &c);
+    void onGatewaysReady();
+    void startTunnel(const QString &hostname, const QStringList &protocols,
+                     QStringList addresses = QStringList());
+    bool resolveIPv6() const;
+    QString apiNameserver() const;
+    void updateDohServer();
+    void cancelProtocolProbe(const QString &hostname);
+    void startMtuProbe(const QStringList &addresses);
+
+    QNetworkReply *m_gatewaysReply;
+    QList<VPNGateway> m_gateways;
+
+    QSettings m_appSettings;
+
+    QNetworkAccessManager m_qnam;
+    DohResolver m_doh;
+    DnsCache m_dnsCache;
+    CompressionPolicy m_compression;
+    AddressFamilies m_families;
+    Installer &m_installer;
+    TunnelManager m_tunnels;
+    LogStore m_logStore;
+    ControlServer m_controlServer;
+
+    QDir m_configDir;
+    // ConfigOnly: m_configDir
+    QScopedPointer<QTemporaryDir> m_tempConfigDir;
+    bool m_diagnosticsRunning;
+
+    // Last credentials that worked (or were just typed), for reconnects
+    // and other tunnels. Saves a decryption, or a prompt.
+    VPNCreds m_sessionCreds;
+
+    // "auto" protocol: probes running, by gateway, and the network each
+    // gateway was connected from, until the winning protocol is known.
+    QMap<QString, ProtocolProbe *> m_protocolProbes;
+    QMap<QString, QByteArray> m_connectNetworks;
+    ConnectMetrics m_connectMetrics;
+    QMap<QString, QElapsedTimer> m_connectClicks;
+
+    // Family of the first remote, for gateways with IPv4 and IPv6
+    QMap<QString, QAbstractSocket::NetworkLayerProtocol> m_firstFamilies;
+
+    // Path MTU of the current network, measured in the background when
+    // connecting to a new one and every MtuProbeInterval while connected
+    QTimer m_mtuTimer;
+    bool m_mtuProbeRunning;
+    QByteArray m_mtuProbeNetwork;
+
+    // Chosen by makeOpenVPNConfig(), by gateway, for the tunnel's log
+    QMap<QString, QString> m_socketTunings;
+
+    enum {
+        MtuProbeInterval = 15 * 60 * 1000,
+        // OpenVPN's default, UDP payload without IP/UDP headers
+        DefaultMssfix = 1450,
+    };
+};
+
+#endif // VPNCORE_H
@@ -0,0 +1,27 @@
+#include "vpndaemon.h"
+
+#include <cstdio>
+
+VPNDaemon::VPNDaemon(Installer &installer, QObject *parent)
+    : VPNCore(installer, parent)
+{
+    connect(&m_tunnels, SIGNAL(tunnelAdded(OpenVPN*)), this, SLOT(vpnTunnelAdded(OpenVPN*)));
+    vpnTunnelAdded(&m_tunnels.primary());
+    connect(this, SIGNAL(gatewaysError(QString)), this, SLOT(gatewaysQueryFailed(QString)));
+
+    // Update gateways list, will autoconnect when done
+    queryGateways();
+}
+
+void VPNDaemon::vpnTunnelAdded(OpenVPN *openvpn) {
+    connect(openvpn, SIGNAL(logUpdated(LogEntry)), this, SLOT(vpnLogUpdated(LogEntry)));
+}
+
+void VPNDaemon::vpnLogUpdated(const LogEntry &entry) {
+    fprintf(stdout, "[%s] %s\n", entry.tunnel.toLocal8Bit().constData(), entry.text.toLocal8Bit().constData());
+    fflush(stdout);
+}
+
+void VPNDaemon::gatewaysQueryFailed(const QString &error) {
+    fprintf(stderr, "Gateways update error: %s\n", error.toLocal8Bit().constData());
+}
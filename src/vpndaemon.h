@@ -0,0 +1,26 @@
+#ifndef VPNDAEMON_H
+#define VPNDAEMON_H
+
+#include <QObject>
+
+#include "vpncore.h"
+
+/*
+ * Headless mode (--daemon), without any widget.
+ * Runs on a QCoreApplication, logs to stdout and is only driven through
+ * the ControlServer and the "autoconnect" setting.
+ * Authentication is only possible with saved credentials.
+ */
+class VPNDaemon : public VPNCore
+{
+    Q_OBJECT
+public:
+    explicit VPNDaemon(Installer &installer, QObject *parent = nullptr);
+
+public slots:
+    void vpnTunnelAdded(OpenVPN *openvpn);
+    void vpnLogUpdated(const LogEntry &entry);
+    void gatewaysQueryFailed(const QString &error);
+};
+
+#endif // VPNDAEMON_H
@@ -7,97 +7,22 @@
 #include <QIcon>
 #include <QSysInfo>
 #include <QJsonDocument>
-#include <QJsonArray>
 #include <QJsonObject>
 #include <QSignalMapper>
-#include <QUuid>
-#include <QDnsLookup>
-#include <QEventLoop>
-#include <QHostAddress>
 #include <QMessageBox>
-
-QStringList _safeResolve(QString hostname, QString nameserver) {
-    QDnsLookup dns;
-    if (!nameserver.isEmpty()) {
-        dns.setNameserver(QHostAddress(nameserver));
-    }
-    dns.setType(QDnsLookup::A);
-    dns.setName(hostname);
-    dns.lookup();
-
-    QEventLoop loop;
-    QObject::connect(&dns, SIGNAL(finished()), &loop, SLOT(quit()), Qt::QueuedConnection);
-    loop.exec();
-
-    if (dns.error() != QDnsLookup::NoError) {
-        qDebug() << "DNS lookup failed: " << hostname;
-        qDebug() << dns.errorString();
-        return QStringList();
-    }
-
-    QStringList addresses;
-    foreach (QDnsHostAddressRecord record, dns.hostAddressRecords()) {
-        qDebug() << "resolved:" << record.value().toString();
-        addresses.append(record.value().toString());
-    }
-
-    return addresses;
-}
-
-QStringList VPNGUI::safeResolve(const QString &hostname) {
-    QStringList nameservers;
-
-
-    // 1. Custom nameserver
-    QString appNs(m_appSettings.value("dns_api").toString());
-    if (!appNs.isEmpty()) {
-        nameservers.append(appNs);
-    }
-
-    // 2. System default
-    nameservers.append("");
-
-    // 3. Brand nameserver
-    QString providerNs(VpnFeatures::nameserver);
-    if (!providerNs.isEmpty()) {
-        nameservers.append(providerNs);
-    }
-
-    // 4. Fallback
-    nameservers.append("8.8.8.8");
-    nameservers.append("8.8.4.4");
-
-    foreach(QString ns, nameservers) {
-        QStringList addresses = _safeResolve(hostname, ns);
-        if (addresses.size() > 0) {
-            return addresses;
-        }
-    }
-    throw std::runtime_error("DNS lookup failed");
-}
-
-VPNCreds::VPNCreds() {}
-VPNCreds::~VPNCreds() {
-    clear();
-}
-
-void VPNCreds::clear() {
-    secureStringClear(username);
-    secureStringClear(password);
-}
+#include <QTimer>
+#include <QDateTime>
+#include <QDir>
+#include <QFileDialog>
 
 
 VPNGUI::VPNGUI(Installer &installer, QObject *parent)
-    : QObject(parent)
+    : VPNCore(installer, parent)
     , m_connectMapper(nullptr)
     , m_trayMenu()
     , m_trayIcon(this)
     , m_latestVersionReply(nullptr)
-    , m_gatewaysReply(nullptr)
-    , m_appSettings(VPNGUI_ORGNAME, getName())
-    , m_qnam(this)
-    , m_installer(installer)
-    , m_openvpn(this, m_installer.getDir().filePath("openvpn.exe"))
+    , m_uninstallRetries(0)
     , m_logWindow(nullptr)
     , m_settingsWindow(nullptr)
 {
@@ -111,23 +36,24 @@ VPNGUI::VPNGUI(Installer &installer, QObject *parent)
 
     m_trayIcon.setContextMenu(&m_trayMenu);
     m_trayIcon.setIcon(QIcon(":/icon_disabled.png"));
+    updateToolTip();
 
-    connect(quitAction, SIGNAL(triggered(bool)), QApplication::instance(), SLOT(quit()));
+    connect(quitAction, SIGNAL(triggered(bool)), this, SLOT(shutdown()));
     connect(logAction, SIGNAL(triggered(bool)), this, SLOT(openLogWindow()));
     connect(settingsAction, SIGNAL(triggered(bool)), this, SLOT(openSettingsWindow()));
     connect(m_disconnectAction, SIGNAL(triggered(bool)), this, SLOT(vpnDisconnect()));
+    // Resolve while the user picks a gateway
+    connect(m_connectMenu, SIGNAL(aboutToShow()), this, SLOT(prefetchGateways()));
 
-    connect(&m_openvpn, SIGNAL(statusUpdated(OpenVPN::Status)), this, SLOT(vpnStatusUpdated(OpenVPN::Status)));
+    connect(&m_tunnels, SIGNAL(statusUpdated(OpenVPN*,OpenVPN::Status)), this, SLOT(vpnStatusUpdated(OpenVPN*,OpenVPN::Status)));
+    connect(&m_tunnels, SIGNAL(reconnectScheduled(OpenVPN*,int)), this, SLOT(vpnReconnectScheduled(OpenVPN*,int)));
+    connect(&m_tunnels, SIGNAL(tunnelRemoved(OpenVPN*)), this, SLOT(vpnTunnelRemoved(OpenVPN*)));
+    connect(&m_tunnels, SIGNAL(snapshotUpdated(OpenVPN*)), this, SLOT(vpnSnapshotUpdated(OpenVPN*)));
+    connect(this, SIGNAL(tunnelStarted(OpenVPN*)), this, SLOT(vpnTunnelStarted(OpenVPN*)));
 
-    // Cleanup OpenVPN config dir
-    m_configDir = QDir(m_installer.getDir().filePath("openvpn_config"));
-    if (m_configDir.exists()) {
-        foreach(QString f, m_configDir.entryList(QDir::Files)) {
-            m_configDir.remove(f);
-        }
-    } else {
-        m_configDir.mkdir(".");
-    }
+    connect(this, SIGNAL(gatewaysUpdated()), this, SLOT(updateGatewayList()));
+    connect(this, SIGNAL(gatewaysError(QString)), this, SLOT(gatewaysQueryFailed(QString)));
+    connect(this, SIGNAL(diagnosticsFinished(QString,bool,QString)), this, SLOT(diagnosticsSaved(QString,bool,QString)));
 
     // Show icon *after* installation.
     // When upgrading, we want the user to only see one icon if asked to quit
@@ -144,7 +70,6 @@ VPNGUI::VPNGUI(Installer &installer, QObject *parent)
 
 VPNGUI::~VPNGUI() {
     m_trayIcon.setVisible(false);
-    m_openvpn.disconnect();
 
     if (m_settingsWindow) {
         delete m_settingsWindow;
@@ -152,42 +77,21 @@ VPNGUI::~VPNGUI() {
     if (m_logWindow) {
         delete m_logWindow;
     }
+    qDeleteAll(m_authDialogs);
 }
 
-QString VPNGUI::getName() const {
-    return QString(VpnFeatures::name);
-}
-
-QString VPNGUI::getDisplayName() const {
-    return QString(VpnFeatures::display_name);
-}
-
-QString VPNGUI::getFullVersion() const {
-    return QString(VPNGUI_VERSION);
-}
-
-QString VPNGUI::getURL() const {
-    return QString(VpnFeatures::url);
-}
-
-QString VPNGUI::getUserAgent() const {
-    // User-Agent: Branded-name/version-bv Project-name/version
-    QString ua;
-    ua += getName() + "/" + getFullVersion();
-    ua += " (" + getURL() + ")";
-    ua += " " VPNGUI_ORGNAME "-" VPNGUI_NAME "/" VPNGUI_VERSION;
-    ua += " (" VPNGUI_URL ")";
-    return ua;
+void VPNGUI::openLogWindow() {
+    openLogWindow(m_tunnels.primary());
 }
 
-void VPNGUI::openLogWindow() {
+void VPNGUI::openLogWindow(const OpenVPN &openvpn) {
     // Clean up any previous LogWindow
     if (m_logWindow) {
         m_logWindow->close();
         delete m_logWindow;
     }
 
-    m_logWindow = new LogWindow(nullptr, *this, m_openvpn);
+    m_logWindow = new LogWindow(nullptr, *this, openvpn);
     m_logWindow->show();
 }
 
@@ -203,26 +107,6 @@ void VPNGUI::openSettingsWindow() {
     m_settingsWindow->show();
 }
 
-void VPNGUI::queryGateways() {
-    QString url(VpnFeatures::locations_url);
-
-    if (url.isEmpty()) {
-        /*
-         * TODO: Feature idea:
-         * load gateways from provider.ini for providers with no API
-         * [gateways] gw<N> = <a serialized map/VPNGateway>
-         */
-        return;
-    } else {
-        QNetworkRequest request;
-        request.setRawHeader("User-Agent", getUserAgent().toUtf8());
-        request.setUrl(url);
-
-        m_gatewaysReply = m_qnam.get(request);
-        connect(m_gatewaysReply, &QNetworkReply::finished, this, &VPNGUI::gatewaysQueryFinished);
-    }
-}
-
 void VPNGUI::queryLatestVersion() {
     QString url(VpnFeatures::releases_url);
 
@@ -247,100 +131,138 @@ void VPNGUI::updateGatewayList() {
     m_connectMapper = new QSignalMapper(this);
 
     m_connectMenu->clear();
+    m_gatewayActions.clear();
 
     foreach (gw, m_gateways) {
         QAction *act = m_connectMenu->addAction(gw.display_name);
+        act->setCheckable(true);
         connect(act, SIGNAL(triggered(bool)), m_connectMapper, SLOT(map()));
 
         m_connectMapper->setMapping(act, gw.hostname);
+        m_gatewayActions[gw.hostname] = act;
     }
-    connect(m_connectMapper, SIGNAL(mapped(QString)), this, SLOT(vpnConnect(QString)));
-}
+    connect(m_connectMapper, SIGNAL(mapped(QString)), this, SLOT(gatewayTriggered(QString)));
 
-VPNCreds VPNGUI::handleAuth(bool failed) {
-    VPNCreds c;
+    updateGatewayChecks();
+}
 
-    if (!failed) {
-        // The first time, try stored credentials
-        if (readSavedCredentials(c)) {
-            return c;
-        }
+// Check the gateways with a tunnel up
+void VPNGUI::updateGatewayChecks() {
+    QMap<QString, QAction *>::iterator it;
+    for (it=m_gatewayActions.begin(); it != m_gatewayActions.end(); ++it) {
+        OpenVPN *openvpn = m_tunnels.find(it.key());
+        it.value()->setChecked(openvpn && openvpn->getStatus() != OpenVPN::Disconnected);
     }
+}
 
-    AuthDialog d(nullptr, *this);
-    if (d.exec() != QDialog::Rejected) {
-        c.username = d.getUsername();
-        c.password = d.getPassword();
-        if (d.getRemember()) {
-            saveCredentials(c);
-        }
-        return c;
+void VPNGUI::gatewayTriggered(QString hostname) {
+    // With multiple tunnels, a connected gateway is a toggle
+    OpenVPN *openvpn = m_tunnels.find(hostname);
+    if (m_appSettings.value("multi_tunnel", false).toBool()
+        && openvpn && openvpn->getStatus() != OpenVPN::Disconnected) {
+        vpnDisconnect(hostname);
+    } else {
+        vpnConnect(hostname);
     }
-
-    // Clicked "Cancel", abort and return empty VPNCreds
-    m_openvpn.disconnect();
-    c.clear();
-    return c;
+    updateGatewayChecks();
 }
 
-bool VPNGUI::readSavedCredentials(VPNCreds &c) {
-    if (!m_appSettings.contains("auth")) {
-        return false;
+void VPNGUI::requestAuth(OpenVPN &openvpn, bool failed) {
+    VPNCreds c;
+
+    // The first time, try credentials from this session or stored ones
+    if (getKnownCredentials(c, failed)) {
+        openvpn.sendCredentials(c);
+        return;
     }
 
-    QByteArray encrypted = m_appSettings.value("auth").toByteArray();
-    if (encrypted.length() < 2) {
-        return false;
+    AuthDialog *&d = m_authDialogs[&openvpn];
+    if (!d) {
+        d = new AuthDialog(nullptr, *this);
+        connect(d, SIGNAL(finished(int)), this, SLOT(authDialogFinished(int)));
     }
+    d->show();
+    d->raise();
+    d->activateWindow();
+}
 
-    PwStore pwstore;
-    QString decrypted(pwstore.decrypt(encrypted));
+void VPNGUI::authDialogFinished(int result) {
+    AuthDialog *d = qobject_cast<AuthDialog *>(sender());
+    OpenVPN *openvpn = m_authDialogs.key(d, nullptr);
+    if (!openvpn) {
+        return;
+    }
+    m_authDialogs.remove(openvpn);
+    d->deleteLater();
 
-    int sep = decrypted.indexOf(':');
-    if (sep == -1) {
-        return false;
+    if (result == QDialog::Rejected) {
+        // Clicked "Cancel", abort
+        m_tunnels.disconnectTunnel(openvpn);
+        return;
     }
 
-    c.username = decrypted.left(sep);
-    c.password = decrypted.mid(sep + 1);
+    VPNCreds c;
+    c.username = d->takeUsername();
+    c.password = d->takePassword();
+    if (c.username.isEmpty()) {
+        requestAuth(*openvpn, true);
+        return;
+    }
 
-    return true;
+    if (d->getRemember()) {
+        saveCredentials(c);
+    }
+    rememberCredentials(c);
+    openvpn->sendCredentials(c);
 }
 
-void VPNGUI::saveCredentials(const VPNCreds &c) {
-    PwStore pwstore;
-    QString text(c.username + ":" + c.password);
-    QByteArray encrypted(pwstore.encrypt(text));
-    m_appSettings.setValue("auth", encrypted);
+void VPNGUI::closeAuthDialog(OpenVPN *openvpn) {
+    AuthDialog *d = m_authDialogs.take(openvpn);
+    if (d) {
+        // Not a "Cancel", don't let it disconnect
+        d->disconnect(this);
+        d->close();
+        d->deleteLater();
+    }
 }
 
 
 void VPNGUI::vpnConnect(QString hostname) {
-    qDebug() << "Connecting to " << hostname;
-    m_connectMenu->setDisabled(true);
     m_disconnectAction->setDisabled(false);
 
-    openLogWindow();
-
-    m_openvpn.connect(makeOpenVPNConfig(hostname));
+    VPNCore::vpnConnect(hostname);
 }
 
-void VPNGUI::vpnDisconnect() {
-    m_openvpn.disconnect();
+// The tunnel may only start after a protocol probe
+void VPNGUI::vpnTunnelStarted(OpenVPN *openvpn) {
+    openLogWindow(*openvpn);
 }
 
-void VPNGUI::vpnStatusUpdated(OpenVPN::Status s) {
-    if (s == OpenVPN::Disconnected) {
-        m_connectMenu->setDisabled(false);
+void VPNGUI::vpnStatusUpdated(OpenVPN *openvpn, OpenVPN::Status s) {
+    // The tray shows all the tunnels
+    OpenVPN::Status global = m_tunnels.getStatus();
+
+    if (global == OpenVPN::Disconnected && !m_tunnels.isReconnectPending()) {
         m_disconnectAction->setDisabled(true);
     }
 
-    if (s == OpenVPN::Connected) {
+    if (global == OpenVPN::Connected) {
         m_trayIcon.setIcon(QIcon(":/icon.png"));
     } else {
         m_trayIcon.setIcon(QIcon(":/icon_disabled.png"));
     }
 
+    if (m_gatewayActions.contains(openvpn->getName())) {
+        m_gatewayActions[openvpn->getName()]->setChecked(s != OpenVPN::Disconnected);
+    }
+
+    // Nothing to authenticate anymore
+    if (s == OpenVPN::Disconnecting || s == OpenVPN::Disconnected) {
+        closeAuthDialog(openvpn);
+    }
+
+    updateToolTip();
+
     if (m_logWindow && m_logWindow->isVisible()) {
         return;
     }
@@ -356,85 +278,83 @@ void VPNGUI::vpnStatusUpdated(OpenVPN::Status s) {
     }
 }
 
-QString VPNGUI::makeOpenVPNConfig(const QString &hostname) {
-    QString name(QUuid::createUuid().toString() + ".ovpn");
-    QString path(m_configDir.filePath(name));
-
-    QFile f(path);
-    if (!f.open(QFile::WriteOnly | QFile::Text)) {
-        qDebug() << "Cannot write config file " << path;
-        throw std::runtime_error("Cannot write config file " + path.toStdString());
-    }
-
-    QTextStream s(&f);
-
-    // Common
-    s << "verb 3\n";
-    s << "client\n";
-    s << "tls-client\n";
-    s << "remote-cert-tls server\n";
-    s << "dev tun\n";
-    s << "nobind\n";
-    s << "persist-key\n";
-    s << "persist-tun\n";
-    s << "auth-user-pass\n";
-    s << "register-dns\n";
-    s << "remote-random\n";
-
-    if (VpnFeatures::default_gw) {
-        s << "redirect-gateway def1\n";
-    }
-    /*if (m_providerSettings.value("openvpn_comp").toBool()) {
-        s << "compress lzo\n";
-    }*/
-
-    if (VpnFeatures::ipv6
-        && m_appSettings.value("ipv6_tunnel", true).toBool()) {
-        s << "tun-ipv6\n";
-        if (VpnFeatures::default_gw) {
-            s << "route-ipv6 2000::/3\n";
-        }
-    }
+void VPNGUI::vpnReconnectScheduled(OpenVPN *openvpn, int delay) {
+    Q_UNUSED(openvpn);
 
-    // Ca
-    s << "<ca>\n" << VpnFeatures::openvpn_ca << "\n</ca>\n";
+    // Still "connected" from the user's point of view, allow to cancel
+    m_disconnectAction->setDisabled(false);
 
-    // Remote
-    QString remoteParams;
-    QString protocol(getCurrentProtocol(m_appSettings));
-    if (protocol == "udp") {
-        remoteParams = "1196 udp";
-    } else if (protocol == "udpl") {
-        remoteParams = "1194 udp";
-    } else if (protocol == "tcp") {
-        remoteParams = "443 tcp";
+    if (m_logWindow && m_logWindow->isVisible()) {
+        return;
     }
 
-    foreach (QString addr, safeResolve(hostname)) {
-        s << "remote " << addr << " " << remoteParams << "\n";
+    m_trayIcon.showMessage(tr("Connection lost"),
+                           tr("Reconnecting in %1 seconds...").arg((delay + 999) / 1000),
+                           QSystemTrayIcon::Warning, 2000);
+}
+
+void VPNGUI::vpnTunnelRemoved(OpenVPN *openvpn) {
+    closeAuthDialog(openvpn);
+
+    // Don't keep a window on a deleted tunnel
+    if (m_logWindow && &m_logWindow->getOpenVPN() == openvpn) {
+        m_logWindow->close();
+        delete m_logWindow;
+        m_logWindow = nullptr;
     }
+}
 
-    // Options
-    QString httpProxy(m_appSettings.value("http_proxt").toString());
-    QString dns(m_appSettings.value("dns_system").toString());
+void VPNGUI::vpnSnapshotUpdated(OpenVPN *openvpn) {
+    Q_UNUSED(openvpn);
+    updateToolTip();
+}
 
-    if (!httpProxy.isEmpty()) {
-        s << "http-proxy " << httpProxy << "\n";
+// One line per tunnel that isn't down
+void VPNGUI::updateToolTip() {
+    QStringList lines;
+    lines << getDisplayName();
+
+    foreach (OpenVPN *openvpn, m_tunnels.tunnels()) {
+        if (openvpn->getStatus() == OpenVPN::Disconnected) {
+            continue;
+        }
+
+        QString line(openvpn->getName() + ": ");
+        StatusPoller *poller = m_tunnels.getStatusPoller(openvpn);
+        if (openvpn->getStatus() == OpenVPN::Connected && poller && poller->getSnapshot().valid) {
+            line += poller->getSummary();
+        } else {
+            line += getStatusString(openvpn->getStatus());
+        }
+        lines << line;
     }
-    if (!dns.isEmpty()) {
-        s << "dhcp-option DNS " << dns << "\n";
+
+    if (lines.size() == 1) {
+        lines << getStatusString(OpenVPN::Disconnected);
     }
+    m_trayIcon.setToolTip(lines.join("\n"));
+}
 
-    // Additional config
-    QString addConfig(m_appSettings.value("additional_config").toString());
-    if (!addConfig.isEmpty()) {
-        s << "# Additional config\n";
-        s << m_appSettings.value("additional_config").toString() << "\n";
+void VPNGUI::saveDiagnostics() {
+    QString name(QString("%1-diagnostics-%2.tar.gz").arg(getName(), QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+    QString path(QFileDialog::getSaveFileName(nullptr, tr("Save diagnostics"),
+                                              QDir::home().filePath(name),
+                                              tr("Archive (*.tar.gz)")));
+    if (path.isEmpty()) {
+        return;
     }
 
-    s.flush();
-    f.close();
-    return path;
+    if (!createDiagnostics(path)) {
+        QMessageBox::information(nullptr, tr("Save diagnostics"), tr("Diagnostics are already being saved."));
+    }
+}
+
+void VPNGUI::diagnosticsSaved(const QString &path, bool ok, const QString &error) {
+    if (ok) {
+        m_trayIcon.showMessage(tr("Diagnostics saved"), path);
+    } else {
+        QMessageBox::warning(nullptr, tr("Save diagnostics"), tr("Cannot save %1: %2").arg(path, error));
+    }
 }
 
 void VPNGUI::confirmUninstall() {
@@ -448,63 +368,33 @@ void VPNGUI::confirmUninstall() {
 }
 
 void VPNGUI::uninstall() {
-    m_openvpn.disconnect();
-
-    m_appSettings.clear();
-    m_installer.uninstall();
-
-    QMessageBox::information(nullptr, tr("Uninstall"),
-                             tr("%1 has been uninstalled.").arg(getName()));
-    QApplication::instance()->quit();
-}
-
-bool gatewaysSort(const VPNGateway &gw1, const VPNGateway &gw2) {
-    return gw1.display_name < gw2.display_name;
-}
-
-void VPNGUI::gatewaysQueryFinished() {
-    if (!m_gatewaysReply) {
+    // openvpn has to exit first, it's using the files we are deleting.
+    if (m_tunnels.getStatus() != OpenVPN::Disconnected) {
+        connect(&m_tunnels, SIGNAL(allDisconnected()), this, SLOT(uninstall()), Qt::UniqueConnection);
+        vpnDisconnect();
         return;
     }
+    disconnect(&m_tunnels, SIGNAL(allDisconnected()), this, SLOT(uninstall()));
 
-    if (m_gatewaysReply->error()) {
-        m_trayIcon.showMessage(tr("Gateways update error"), m_gatewaysReply->errorString());
-        onGUIReady();
+    // Even once it's killed, openvpn.exe is somehow still opened for a
+    // moment. Retry a few times without blocking the event loop.
+    QFile openvpnExe(m_installer.getDir().filePath("openvpn.exe"));
+    if (openvpnExe.exists() && !openvpnExe.remove() && m_uninstallRetries < 10) {
+        m_uninstallRetries++;
+        QTimer::singleShot(100, this, SLOT(uninstall()));
         return;
     }
 
-    QString jsonStr = m_gatewaysReply->readAll();
-    QJsonDocument json(QJsonDocument::fromJson(jsonStr.toUtf8()));
-    QJsonObject root(json.object());
-    QJsonArray locations(root["locations"].toArray());
-
-    m_gateways.clear();
-    for (int i=0; i<locations.size(); ++i) {
-        QJsonObject loc(locations[i].toObject());
-        VPNGateway gw;
-        gw.display_name = loc["country_name"].toString();
-        gw.hostname = loc["hostname"].toString();
-        m_gateways.append(gw);
-    }
+    m_appSettings.clear();
+    m_installer.uninstall(false);
 
-    // Add any additional gateway
-    QString addConfig(m_appSettings.value("additional_config").toString());
-    for (QString &line : addConfig.split('\n')) {
-        if (!line.startsWith("#$")) {
-            continue;
-        }
-        QStringList parts(line.split(' '));
-        if (parts.length() == 3 && parts[1].trimmed() == "server") {
-            VPNGateway gw;
-            gw.hostname = parts[2].trimmed();
-            gw.display_name = "$ " + gw.hostname;
-            m_gateways.append(gw);
-        }
-    }
+    QMessageBox::information(nullptr, tr("Uninstall"),
+                             tr("%1 has been uninstalled.").arg(getName()));
+    QApplication::instance()->quit();
+}
 
-    qSort(m_gateways.begin(), m_gateways.end(), &gatewaysSort);
-    updateGatewayList();
-    onGUIReady();
+void VPNGUI::gatewaysQueryFailed(const QString &error) {
+    m_trayIcon.showMessage(tr("Gateways update error"), error);
 }
 
 void VPNGUI::latestVersionQueryFinished() {
@@ -549,26 +439,6 @@ void VPNGUI::latestVersionQueryFinished() {
     }
 }
 
-// Called after queryGateways() has finished/failed
-void VPNGUI::onGUIReady() {
-    QString autoconnect(m_appSettings.value("autoconnect").toString());
-    if (!autoconnect.isEmpty()) {
-        vpnConnect(autoconnect);
-    }
-}
-
-const QSettings &VPNGUI::getAppSettings() const {
-    return m_appSettings;
-}
-
-const Installer &VPNGUI::getInstaller() const {
-    return m_installer;
-}
-
-const QList<VPNGateway> &VPNGUI::getGatewayList() const {
-    return m_gateways;
-}
-
 // Events that get triggered on settings save
 void VPNGUI::settingsChanged(const QSet<QString> &keys) {
     if (keys.contains("start_on_boot")) {
@@ -581,21 +451,3 @@ void VPNGUI::settingsChanged(const QSet<QString> &keys) {
         }
     }
 }
-
-QString getCurrentProtocol(QSettings &appSettings) {
-    QString defaultProtocol(VpnFeatures::default_protocol);
-    QString currentProtocol(appSettings.value("protocol", defaultProtocol).toString());
-
-    QSet<QString> knownProtocols;
-    for (auto &proto : VpnFeatures::protocols) {
-        knownProtocols << QString(proto);
-    }
-
-    // Check currentProtocol (to always have an option checked)
-    if (!knownProtocols.contains(currentProtocol)) {
-        currentProtocol = defaultProtocol;
-        appSettings.setValue("protocol", defaultProtocol);
-    }
-
-    return currentProtocol;
-}
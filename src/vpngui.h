@@ -7,108 +7,79 @@
 #include <QMenu>
 #include <QSettings>
 #include <QNetworkReply>
-#include <QNetworkAccessManager>
 #include <QList>
 #include <QString>
 #include <QSignalMapper>
 #include <QLockFile>
+#include <QMap>
 
-#include "installer.h"
-#include "openvpn.h"
-#include "pwstore.h"
+#include "vpncore.h"
 #include "logwindow.h"
 #include "settingswindow.h"
-
-struct VPNCreds {
-    QString username;
-    QString password;
-
-    VPNCreds();
-    VPNCreds(const VPNCreds &) = default;
-    ~VPNCreds();
-    void clear();
-};
-
-struct VPNGateway {
-    QString display_name;
-    QString hostname;
-};
-
-// Helper to get the selected protocol, check provider settings, and
-// default/fallback to UDP.
-QString getCurrentProtocol(QSettings &appSettings);
+#include "authdialog.h"
 
 /*
  * Main app logic and notifications.
  * Calls everything else at the right time.
  */
-class VPNGUI : public QObject
+class VPNGUI : public VPNCore
 {
     Q_OBJECT
 public:
     explicit VPNGUI(Installer &installer, QObject *parent = nullptr);
     ~VPNGUI();
 
-    VPNCreds handleAuth(bool failed=false);
+    void requestAuth(OpenVPN &openvpn, bool failed=false) override;
 
     void queryLatestVersion();
-    void queryGateways();
-    void updateGatewayList();
-    QString makeOpenVPNConfig(const QString &hostname);
-    QStringList safeResolve(const QString &hostname);
-    void uninstall();
-
-    const QSettings &getAppSettings() const;
-    const QList<VPNGateway> &getGatewayList() const;
-    const Installer &getInstaller() const;
-
-    QString getName() const;
-    QString getDisplayName() const;
-    QString getFullVersion() const;
-    QString getURL() const;
-    QString getUserAgent() const;
 
 signals:
 
 public slots:
-    void vpnConnect(QString hostname);
-    void vpnDisconnect();
-    void vpnStatusUpdated(OpenVPN::Status s);
+    void vpnConnect(QString hostname) override;
+    void vpnStatusUpdated(OpenVPN *openvpn, OpenVPN::Status s);
+    void vpnReconnectScheduled(OpenVPN *openvpn, int delay);
+    void vpnTunnelRemoved(OpenVPN *openvpn);
+    void vpnTunnelStarted(OpenVPN *openvpn);
+    void vpnSnapshotUpdated(OpenVPN *openvpn);
+    void gatewayTriggered(QString hostname);
 
+    void updateGatewayList();
     void latestVersionQueryFinished();
-    void gatewaysQueryFinished();
+    void gatewaysQueryFailed(const QString &error);
     void openLogWindow();
+    void openLogWindow(const OpenVPN &openvpn);
     void openSettingsWindow();
     void confirmUninstall();
+    void saveDiagnostics();
+    void diagnosticsSaved(const QString &path, bool ok, const QString &error);
+    void uninstall();
 
     void settingsChanged(const QSet<QString> &keys);
 
+private slots:
+    void authDialogFinished(int result);
+
 private:
-    bool readSavedCredentials(VPNCreds &c);
-    void saveCredentials(const VPNCreds &c);
-    void onGUIReady();
+    void updateGatewayChecks();
+    void updateToolTip();
+    void closeAuthDialog(OpenVPN *openvpn);
 
     QMenu *m_connectMenu;
     QAction *m_disconnectAction;
     QSignalMapper *m_connectMapper;
+    QMap<QString, QAction *> m_gatewayActions;
 
     QMenu m_trayMenu;
     QSystemTrayIcon m_trayIcon;
 
     QNetworkReply *m_latestVersionReply;
-    QNetworkReply *m_gatewaysReply;
-    QList<VPNGateway> m_gateways;
-
-    QSettings m_appSettings;
-
-    QNetworkAccessManager m_qnam;
-    Installer &m_installer;
-    OpenVPN m_openvpn;
+    int m_uninstallRetries;
 
     LogWindow *m_logWindow;
     SettingsWindow *m_settingsWindow;
-
-    QDir m_configDir;
+    // Open credential prompts, not modal
+    QMap<OpenVPN *, AuthDialog *> m_authDialogs;
 };
 
 #endif // VPNGUI_H
@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_addressfamilies
+
+SOURCES += \
+    tst_addressfamilies.cpp \
+    $$SRC/addressfamilies.cpp
+
+HEADERS += \
+    $$SRC/addressfamilies.h
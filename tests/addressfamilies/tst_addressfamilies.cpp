@@ -0,0 +1,157 @@
+#include <QtTest>
+#include <QSettings>
+#include <QSet>
+#include <QTemporaryDir>
+
+#include "addressfamilies.h"
+
+static bool isIPv6(const QString &address) {
+    return address.contains(':');
+}
+
+static QStringList addresses(const QString &pattern, int count) {
+    QStringList l;
+    for (int i=0; i<count; ++i) {
+        l.append(pattern.arg(i + 1));
+    }
+    return l;
+}
+
+class TestAddressFamilies : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_dir;
+    QSettings *m_settings;
+
+    void record(AddressFamilies &families, QAbstractSocket::NetworkLayerProtocol family,
+                bool ok, int times) {
+        for (int i=0; i<times; ++i) {
+            families.record(family, ok);
+        }
+    }
+
+private slots:
+    void init() {
+        m_settings = new QSettings(m_dir.path() + "/settings.ini", QSettings::IniFormat);
+        m_settings->clear();
+    }
+
+    void cleanup() {
+        delete m_settings;
+    }
+
+    void interleave_data() {
+        QTest::addColumn<int>("v4");
+        QTest::addColumn<int>("v6");
+        QTest::addColumn<bool>("preferIPv6");
+        QTest::addColumn<QString>("families");
+
+        QTest::newRow("IPv6 first") << 3 << 3 << true << "646464";
+        QTest::newRow("IPv4 first") << 3 << 3 << false << "464646";
+        QTest::newRow("more IPv4") << 4 << 1 << true << "6444";
+        QTest::newRow("more IPv6") << 1 << 3 << false << "466";
+        QTest::newRow("IPv4 only") << 2 << 0 << true << "44";
+        QTest::newRow("IPv6 only") << 0 << 2 << false << "66";
+        QTest::newRow("nothing") << 0 << 0 << true << "";
+    }
+
+    void interleave() {
+        QFETCH(int, v4);
+        QFETCH(int, v6);
+        QFETCH(bool, preferIPv6);
+        QFETCH(QString, families);
+
+        QStringList in4(addresses("192.0.2.%1", v4));
+        QStringList in6(addresses("2001:db8::%1", v6));
+        QStringList out(AddressFamilies::interleave(in4, in6, preferIPv6));
+
+        QString outFamilies;
+        foreach (const QString &address, out) {
+            outFamilies += isIPv6(address) ? '6' : '4';
+        }
+        QCOMPARE(outFamilies, families);
+        QCOMPARE(out.toSet(), (in4 + in6).toSet());
+    }
+
+    // Shuffled within a family, or every client would try the same server
+    void shuffled() {
+        QStringList v4(addresses("192.0.2.%1", 8));
+        QStringList v6(addresses("2001:db8::%1", 8));
+        QSet<QString> firsts;
+        for (int i=0; i<100; ++i) {
+            QStringList out(AddressFamilies::interleave(v4, v6, true));
+            QVERIFY(isIPv6(out[0]));
+            firsts.insert(out[0]);
+        }
+        QVERIFY(firsts.size() > 1);
+    }
+
+    void noStats() {
+        AddressFamilies families(*m_settings);
+        QVERIFY(families.preferIPv6());
+    }
+
+    void tieGoesToIPv6() {
+        AddressFamilies families(*m_settings);
+        record(families, QAbstractSocket::IPv4Protocol, true, 5);
+        record(families, QAbstractSocket::IPv6Protocol, true, 5);
+        QVERIFY(families.preferIPv6());
+    }
+
+    void failingIPv6() {
+        AddressFamilies families(*m_settings);
+        record(families, QAbstractSocket::IPv6Protocol, true, 2);
+        record(families, QAbstractSocket::IPv6Protocol, false, 3);
+        QVERIFY(!families.preferIPv6());
+
+        // IPv4 failing more often: back to IPv6
+        record(families, QAbstractSocket::IPv4Protocol, true, 1);
+        record(families, QAbstractSocket::IPv4Protocol, false, 1);
+        QVERIFY(!families.preferIPv6());
+        record(families, QAbstractSocket::IPv4Protocol, false, 2);
+        QVERIFY(families.preferIPv6());
+    }
+
+    // One failure isn't enough to give up on IPv6 after many successes
+    void smoothing() {
+        AddressFamilies families(*m_settings);
+        record(families, QAbstractSocket::IPv6Protocol, true, 20);
+        record(families, QAbstractSocket::IPv6Protocol, false, 1);
+        record(families, QAbstractSocket::IPv4Protocol, true, 1);
+        QVERIFY(families.preferIPv6());
+    }
+
+    // Counts are halved past MaxStats: a network that changed wins
+    // back the other family in about MaxStats attempts
+    void recentHistory() {
+        AddressFamilies families(*m_settings);
+        record(families, QAbstractSocket::IPv6Protocol, false, 1000);
+        int ok = m_settings->value("address_stats/ipv6_ok").toInt();
+        int failed = m_settings->value("address_stats/ipv6_failed").toInt();
+        QVERIFY(ok + failed <= AddressFamilies::MaxStats);
+        QVERIFY(!families.preferIPv6());
+
+        int attempts = 0;
+        while (!families.preferIPv6() && attempts < 1000) {
+            families.record(QAbstractSocket::IPv6Protocol, true);
+            attempts++;
+        }
+        QVERIFY(attempts <= AddressFamilies::MaxStats);
+    }
+
+    // Kept in the settings, across restarts
+    void persisted() {
+        {
+            AddressFamilies families(*m_settings);
+            record(families, QAbstractSocket::IPv6Protocol, false, 3);
+        }
+        AddressFamilies families(*m_settings);
+        QVERIFY(!families.preferIPv6());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestAddressFamilies)
+
+#include "tst_addressfamilies.moc"
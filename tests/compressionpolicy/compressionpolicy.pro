@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+TARGET = tst_compressionpolicy
+
+SOURCES += \
+    tst_compressionpolicy.cpp \
+    $$SRC/compressionpolicy.cpp \
+    $$SRC/statussnapshot.cpp
+
+HEADERS += \
+    $$SRC/compressionpolicy.h \
+    $$SRC/statussnapshot.h
@@ -0,0 +1,143 @@
+#include <QtTest>
+#include <QDateTime>
+#include <QSettings>
+#include <QTemporaryDir>
+
+#include "compressionpolicy.h"
+#include "config.h"
+
+static const QString Host("gw.example.net");
+
+// Cumulative counters, compressed at ratio in both directions
+static StatusSnapshot counters(qint64 raw, double ratio) {
+    StatusSnapshot s;
+    s.valid = true;
+    s.preCompress = raw / 2;
+    s.postCompress = static_cast<qint64>(raw / 2 * ratio);
+    s.postDecompress = raw - raw / 2;
+    s.preDecompress = static_cast<qint64>((raw - raw / 2) * ratio);
+    return s;
+}
+
+class TestCompressionPolicy : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_dir;
+    QSettings *m_settings;
+
+    QString ratioKey() const {
+        return "compression/" + Host + "/ratio";
+    }
+
+    QString lowSavingKey() const {
+        return "compression/" + Host + "/low_saving_at";
+    }
+
+private slots:
+    void initTestCase() {
+        if (!VpnFeatures::compression) {
+            QSKIP("The provider doesn't support compression");
+        }
+    }
+
+    void init() {
+        m_settings = new QSettings(m_dir.path() + "/settings.ini", QSettings::IniFormat);
+        m_settings->clear();
+    }
+
+    void cleanup() {
+        delete m_settings;
+    }
+
+    void compressibleTraffic() {
+        CompressionPolicy policy(*m_settings);
+        policy.track(Host);
+
+        // Baseline, then not enough for a sample
+        policy.update(Host, counters(1000, 0.5));
+        policy.update(Host, counters(1000 + CompressionPolicy::SampleBytes / 2, 0.5));
+        QVERIFY(!m_settings->contains(ratioKey()));
+
+        QCOMPARE(policy.saving(Host), -1.0);
+
+        QVERIFY(!policy.update(Host, counters(1000 + CompressionPolicy::SampleBytes, 0.5)));
+        QVERIFY(qAbs(m_settings->value(ratioKey()).toDouble() - 0.5) < 0.01);
+        QVERIFY(qAbs(policy.saving(Host) - 50) < 1);
+        QVERIFY(policy.isMeasured(Host));
+    }
+
+    // Already compressed or encrypted: reported once, then not measured
+    // for RetryDays
+    void incompressibleTraffic() {
+        CompressionPolicy policy(*m_settings);
+        policy.track(Host);
+
+        QVERIFY(!policy.update(Host, counters(0, 1.0)));
+        QVERIFY(policy.update(Host, counters(CompressionPolicy::SampleBytes, 0.99)));
+        QVERIFY(m_settings->contains(lowSavingKey()));
+        QVERIFY(qAbs(policy.saving(Host) - 1) < 0.1);
+        QVERIFY(!policy.isMeasured(Host));
+
+        // Nothing measured nor reported meanwhile
+        policy.track(Host);
+        QVERIFY(!policy.update(Host, counters(2 * CompressionPolicy::SampleBytes, 0.5)));
+        QVERIFY(!policy.update(Host, counters(3 * CompressionPolicy::SampleBytes, 0.5)));
+        QVERIFY(qAbs(policy.saving(Host) - 1) < 0.1);
+    }
+
+    // A sample is averaged with what was seen before
+    void smoothedRatio() {
+        m_settings->setValue(ratioKey(), 0.5);
+        CompressionPolicy policy(*m_settings);
+        policy.track(Host);
+
+        policy.update(Host, counters(0, 1.0));
+        policy.update(Host, counters(CompressionPolicy::SampleBytes, 1.0));
+        QVERIFY(qAbs(m_settings->value(ratioKey()).toDouble() - 0.75) < 0.01);
+        QVERIFY(policy.isMeasured(Host));
+    }
+
+    // Counters start over with a new connection: new baseline, no sample
+    void countersRestart() {
+        CompressionPolicy policy(*m_settings);
+        policy.track(Host);
+
+        policy.update(Host, counters(2 * CompressionPolicy::SampleBytes, 0.5));
+        policy.update(Host, counters(1000, 1.0));
+        policy.update(Host, counters(1000 + CompressionPolicy::SampleBytes - 1, 1.0));
+        QVERIFY(!m_settings->contains(ratioKey()));
+        QVERIFY(!m_settings->contains(lowSavingKey()));
+    }
+
+    // Only tunnels given to track() are measured
+    void ignoredUpdates() {
+        CompressionPolicy policy(*m_settings);
+        policy.update(Host, counters(0, 0.5));
+        policy.update(Host, counters(CompressionPolicy::SampleBytes, 0.5));
+        QVERIFY(!m_settings->contains(ratioKey()));
+
+        policy.track(Host);
+        StatusSnapshot invalid(counters(0, 0.5));
+        invalid.valid = false;
+        policy.update(Host, invalid);
+        policy.update(Host, counters(CompressionPolicy::SampleBytes, 0.5));
+        // That was the baseline, not a sample
+        QVERIFY(!m_settings->contains(ratioKey()));
+    }
+
+    void retryAfterDays() {
+        QDateTime now(QDateTime::currentDateTimeUtc());
+        CompressionPolicy policy(*m_settings);
+
+        m_settings->setValue(lowSavingKey(), now.addDays(-(CompressionPolicy::RetryDays - 1)));
+        QVERIFY(!policy.isMeasured(Host));
+        m_settings->setValue(lowSavingKey(), now.addDays(-(CompressionPolicy::RetryDays + 1)));
+        QVERIFY(policy.isMeasured(Host));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCompressionPolicy)
+
+#include "tst_compressionpolicy.moc"
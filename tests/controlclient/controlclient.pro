@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_controlclient
+
+SOURCES += \
+    tst_controlclient.cpp \
+    $$SRC/controlclient.cpp
+
+HEADERS += \
+    $$SRC/controlclient.h
@@ -0,0 +1,204 @@
+#include <QtTest>
+#include <algorithm>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QThread>
+
+#include "controlclient.h"
+
+/*
+ * Stands in for the running instance's ControlServer, on its own thread:
+ * ControlClient only uses blocking calls, like the second process does.
+ * "status" answers right away, "connect" fails for an unknown host,
+ * "log" with "follow" sends a few events then disconnects (the instance
+ * quitting).
+ */
+class InstanceStandIn : public QObject
+{
+    Q_OBJECT
+public:
+    InstanceStandIn()
+        : listening(false)
+        , m_server(this)
+    {
+        connect(&m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    }
+
+    // Only read from another thread after a blocking call
+    QList<QJsonObject> requests;
+    bool listening;
+
+public slots:
+    void listen(const QString &name) {
+        QLocalServer::removeServer(name);
+        m_server.setSocketOptions(QLocalServer::UserAccessOption);
+        listening = m_server.listen(name);
+    }
+
+    void close() {
+        m_server.close();
+    }
+
+private slots:
+    void newConnection() {
+        while (QLocalSocket *client = m_server.nextPendingConnection()) {
+            connect(client, SIGNAL(readyRead()), this, SLOT(readyRead()));
+            connect(client, SIGNAL(disconnected()), client, SLOT(deleteLater()));
+        }
+    }
+
+    void readyRead() {
+        QLocalSocket *client = qobject_cast<QLocalSocket *>(sender());
+        while (client->canReadLine()) {
+            QJsonObject request(QJsonDocument::fromJson(client->readLine()).object());
+            requests.append(request);
+            handle(client, request);
+        }
+    }
+
+private:
+    void send(QLocalSocket *client, const QJsonObject &object) {
+        client->write(QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n");
+        client->flush();
+    }
+
+    void handle(QLocalSocket *client, const QJsonObject &request) {
+        QJsonObject reply;
+        QString cmd(request["cmd"].toString());
+        if (cmd == "status") {
+            QJsonObject tunnel;
+            tunnel["host"] = "gw.example.net";
+            tunnel["status"] = "connected";
+            reply["ok"] = true;
+            reply["status"] = "connected";
+            reply["tunnels"] = QJsonArray() << tunnel;
+            send(client, reply);
+        } else if (cmd == "connect" && request["host"].toString() != "gw.example.net") {
+            reply["ok"] = false;
+            reply["error"] = "Unknown gateway";
+            send(client, reply);
+        } else if (cmd == "log" && request["follow"].toBool()) {
+            reply["ok"] = true;
+            reply["log"] = QJsonArray() << "line 1" << "line 2";
+            send(client, reply);
+            for (int i=3; i<=5; ++i) {
+                QJsonObject event;
+                event["event"] = "log";
+                event["line"] = QString("line %1").arg(i);
+                send(client, event);
+            }
+            client->disconnectFromServer();
+        } else {
+            reply["ok"] = true;
+            send(client, reply);
+        }
+    }
+
+    QLocalServer m_server;
+};
+
+class TestControlClient : public QObject
+{
+    Q_OBJECT
+
+private:
+    QString m_name;
+    QThread m_thread;
+    InstanceStandIn *m_standIn;
+
+    QList<QJsonObject> requests() {
+        // Blocking: what the stand-in's thread wrote is visible after it
+        QMetaObject::invokeMethod(m_standIn, "close", Qt::BlockingQueuedConnection);
+        return m_standIn->requests;
+    }
+
+    QJsonObject request(const QString &cmd) {
+        QJsonObject r;
+        r["cmd"] = cmd;
+        return r;
+    }
+
+private slots:
+    void init() {
+        m_name = QString("tst_controlclient-%1").arg(QCoreApplication::applicationPid());
+        m_standIn = new InstanceStandIn;
+        m_standIn->moveToThread(&m_thread);
+        m_thread.start();
+        QMetaObject::invokeMethod(m_standIn, "listen", Qt::BlockingQueuedConnection,
+                                  Q_ARG(QString, m_name));
+        QVERIFY(m_standIn->listening);
+    }
+
+    void cleanup() {
+        QMetaObject::invokeMethod(m_standIn, "close", Qt::BlockingQueuedConnection);
+        m_thread.quit();
+        m_thread.wait();
+        delete m_standIn;
+    }
+
+    void notRunning() {
+        ControlClient client(m_name + "-nobody");
+        QVERIFY(!client.connectToInstance(100));
+    }
+
+    void status() {
+        ControlClient client(m_name);
+        QVERIFY(client.connectToInstance());
+        QCOMPARE(client.run(request("status")), 0);
+
+        QList<QJsonObject> r(requests());
+        QCOMPARE(r.size(), 1);
+        QCOMPARE(r[0]["cmd"].toString(), QString("status"));
+    }
+
+    void errorExitCode() {
+        QJsonObject connect(request("connect"));
+        connect["host"] = "nowhere.example.net";
+        ControlClient client(m_name);
+        QVERIFY(client.connectToInstance());
+        QCOMPARE(client.run(connect), 1);
+        QCOMPARE(requests()[0]["host"].toString(), QString("nowhere.example.net"));
+    }
+
+    // Ends with the instance, with success
+    void follow() {
+        QJsonObject log(request("log"));
+        log["follow"] = true;
+        ControlClient client(m_name);
+        QVERIFY(client.connectToInstance());
+
+        QElapsedTimer timer;
+        timer.start();
+        QCOMPARE(client.run(log, true), 0);
+        QVERIFY(timer.elapsed() < 5000);
+    }
+
+    // What "lvpngui --status" costs once the instance is found: a new
+    // process connects, asks and prints
+    void roundTrip() {
+        const int Runs = 100;
+        const qint64 MaxMedianUs = 10 * 1000;
+
+        QList<qint64> times;
+        for (int i=0; i<Runs; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            ControlClient client(m_name);
+            QVERIFY(client.connectToInstance());
+            QCOMPARE(client.run(request("status")), 0);
+            times.append(timer.nsecsElapsed() / 1000);
+        }
+        std::sort(times.begin(), times.end());
+        qDebug() << "Round trip: median" << times[Runs / 2] << "us, max" << times.last() << "us";
+        QVERIFY(times[Runs / 2] < MaxMedianUs);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestControlClient)
+
+#include "tst_controlclient.moc"
@@ -0,0 +1,26 @@
+include(../tests.pri)
+
+TARGET = tst_diagnostics
+
+SOURCES += \
+    tst_diagnostics.cpp \
+    $$SRC/diagnostics.cpp \
+    $$SRC/logexport.cpp \
+    $$SRC/logstore.cpp \
+    $$SRC/logentry.cpp
+
+HEADERS += \
+    $$SRC/diagnostics.h \
+    $$SRC/logexport.h \
+    $$SRC/logstore.h \
+    $$SRC/logentry.h
+
+DISTFILES += \
+    fixture/index.txt \
+    fixture/settings.ini \
+    fixture/configs/gw1.example.net.ovpn
+
+# Crypto++
+LIBPATH += C:/CryptoPP/release
+INCLUDEPATH += C:/CryptoPP/include
+LIBS += -lcryptopp
@@ -0,0 +1,215 @@
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <QTemporaryDir>
+
+#include <string>
+#include <cryptopp/filters.h>
+#include <cryptopp/gzip.h>
+
+#include "diagnostics.h"
+#include "logstore.h"
+
+/*
+ * fixture/ is an install as the bundle sees it:
+ *   index.txt    the installer's "<sha1> <path>" index: openvpn.exe is
+ *                intact, tap/OemVista.inf changed, tap/tap0901.sys missing
+ *   install/     the install dir
+ *   configs/     a generated config, with inline keys
+ *   settings.ini with credentials and passwords that must not get out
+ */
+
+static QByteArray readFile(const QString &path) {
+    QFile f(path);
+    if (!f.open(QFile::ReadOnly)) {
+        return QByteArray();
+    }
+    return f.readAll();
+}
+
+// name -> content, from a .tar.gz (regular files only)
+static QMap<QString, QByteArray> untar(const QString &path) {
+    QByteArray gz(readFile(path));
+    std::string out;
+    CryptoPP::StringSource(reinterpret_cast<const byte *>(gz.constData()), gz.size(), true,
+                           new CryptoPP::Gunzip(new CryptoPP::StringSink(out)));
+    QByteArray tar(out.data(), static_cast<int>(out.size()));
+
+    QMap<QString, QByteArray> files;
+    int pos = 0;
+    while (pos + 512 <= tar.size()) {
+        QByteArray header(tar.mid(pos, 512));
+        if (header.count('\0') == 512) {
+            break;
+        }
+        QString name(QString::fromUtf8(header.left(100).constData()));
+        bool ok = false;
+        int size = header.mid(124, 11).toInt(&ok, 8);
+        if (!ok || header.mid(257, 5) != "ustar") {
+            break;
+        }
+        files.insert(name, tar.mid(pos + 512, size));
+        pos += 512 + (size + 511) / 512 * 512;
+    }
+    return files;
+}
+
+// Where a threaded bundle's finished() lands, on the test's thread
+class Receiver : public QObject
+{
+    Q_OBJECT
+public:
+    Receiver() : done(false), ok(false) {}
+
+    bool done;
+    bool ok;
+    QString path;
+
+public slots:
+    void finished(const QString &bundlePath, bool success, const QString &) {
+        done = true;
+        ok = success;
+        path = bundlePath;
+    }
+};
+
+class TestDiagnostics : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_dir;
+    QString m_fixture;
+    LogStore *m_store;
+
+    enum {
+        LogLines = 20000,
+    };
+
+    DiagnosticsBundle::Inputs inputs() {
+        DiagnosticsBundle::Inputs in;
+        in.name = "lvpngui-diagnostics-test";
+        in.installDir = m_fixture + "/install";
+        in.info = "Fixture\n";
+        in.tunnels = "[]\n";
+
+        QSettings settings(m_fixture + "/settings.ini", QSettings::IniFormat);
+        in.settings = DiagnosticsBundle::sanitizeSettings(settings);
+
+        foreach (QByteArray line, readFile(m_fixture + "/index.txt").split('\n')) {
+            QList<QByteArray> parts(line.trimmed().split(' '));
+            if (parts.size() == 2 && !line.startsWith('#')) {
+                in.index.insert(QString::fromUtf8(parts[1]), QString::fromLatin1(parts[0]));
+            }
+        }
+
+        QDir configs(m_fixture + "/configs");
+        foreach (QString f, configs.entryList(QDir::Files)) {
+            in.configFiles.append(configs.filePath(f));
+        }
+        in.logSegments = m_store->getSegmentFiles();
+        return in;
+    }
+
+    QMap<QString, QByteArray> writeBundle() {
+        QString path(m_dir.filePath("bundle.tar.gz"));
+        DiagnosticsBundle bundle(inputs(), path);
+        if (!bundle.write()) {
+            qWarning() << bundle.errorString();
+            return QMap<QString, QByteArray>();
+        }
+        return untar(path);
+    }
+
+private slots:
+    void initTestCase() {
+        m_fixture = QFileInfo(QFINDTESTDATA("fixture/index.txt")).absolutePath();
+        QVERIFY(!m_fixture.isEmpty());
+
+        m_store = new LogStore;
+        QVERIFY(m_store->open(m_dir.filePath("logs")));
+        for (int i=0; i<LogLines; ++i) {
+            LogEntry e(LogEntry::Process, LogEntry::Info, i % 2 ? "gw1.example.net" : "",
+                       QString("Line %1").arg(i));
+            e.time = Q_INT64_C(1555555555000) + i;
+            m_store->append(e);
+        }
+    }
+
+    void cleanupTestCase() {
+        delete m_store;
+    }
+
+    void contents() {
+        QMap<QString, QByteArray> files(writeBundle());
+        QString dir("lvpngui-diagnostics-test/");
+        QCOMPARE(files.keys(), QStringList()
+                 << dir + "configs/gw1.example.net.ovpn"
+                 << dir + "info.txt"
+                 << dir + "install.txt"
+                 << dir + "logs.txt"
+                 << dir + "settings.ini"
+                 << dir + "tunnels.json");
+        QCOMPARE(files[dir + "info.txt"], QByteArray("Fixture\n"));
+    }
+
+    void installHashes() {
+        QList<QByteArray> lines(writeBundle()["lvpngui-diagnostics-test/install.txt"].trimmed().split('\n'));
+        QCOMPARE(lines.size(), 3);
+        QVERIFY(lines[0].startsWith("ok "));
+        QVERIFY(lines[0].endsWith(" openvpn.exe"));
+        QVERIFY(lines[1].startsWith("MISMATCH 0000000000000000000000000000000000000000 "));
+        QVERIFY(lines[1].endsWith(" tap/OemVista.inf"));
+        QVERIFY(lines[2].startsWith("MISMATCH "));
+        QVERIFY(lines[2].endsWith(" missing tap/tap0901.sys"));
+    }
+
+    void noSecrets() {
+        QMap<QString, QByteArray> files(writeBundle());
+        foreach (const QByteArray &content, files) {
+            QVERIFY(!content.contains("fixtureENCRYPTEDCREDENTIALS"));
+            QVERIFY(!content.contains("fixturePROXYPASS"));
+            QVERIFY(!content.contains("fixturePASSWORD"));
+            QVERIFY(!content.contains("PRIVATEKEY"));
+            QVERIFY(!content.contains("CLIENTCERT"));
+            QVERIFY(!content.contains("STATICKEY"));
+        }
+
+        QByteArray settings(files["lvpngui-diagnostics-test/settings.ini"]);
+        QVERIFY(settings.contains("http_proxy=http://[removed]@proxy.example.net:3128\n"));
+        QVERIFY(settings.contains("address_stats/ipv6_ok=3\n"));
+
+        // What's left of the config still says what it does
+        QByteArray config(files["lvpngui-diagnostics-test/configs/gw1.example.net.ovpn"]);
+        QVERIFY(config.contains("remote 2001:db8::1 1194 udp\n"));
+        QVERIFY(config.contains("<key>\n[removed]\n</key>\n"));
+        // The CA is public
+        QVERIFY(config.contains("fixtureCA"));
+    }
+
+    void logs() {
+        QList<QByteArray> lines(writeBundle()["lvpngui-diagnostics-test/logs.txt"].trimmed().split('\n'));
+        QCOMPARE(lines.size(), static_cast<int>(LogLines));
+        QVERIFY(lines.first().endsWith(" Line 0"));
+        QVERIFY(lines.last().endsWith("[gw1.example.net] Line 19999"));
+    }
+
+    // On its own thread, finished() back on ours
+    void threaded() {
+        QString path(m_dir.filePath("threaded.tar.gz"));
+        Receiver receiver;
+        DiagnosticsBundle *bundle = new DiagnosticsBundle(inputs(), path);
+        connect(bundle, SIGNAL(finished(QString,bool,QString)), &receiver, SLOT(finished(QString,bool,QString)));
+        bundle->start();
+
+        QTRY_VERIFY_WITH_TIMEOUT(receiver.done, 10000);
+        QVERIFY(receiver.ok);
+        QCOMPARE(receiver.path, path);
+        QCOMPARE(untar(path).size(), 6);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDiagnostics)
+
+#include "tst_diagnostics.moc"
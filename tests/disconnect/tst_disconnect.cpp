@@ -0,0 +1,216 @@
+#include <QtTest>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <csignal>
+#include <cstdio>
+
+#include "openvpn.h"
+
+/*
+ * Stands in for openvpn, management interface included: the process
+ * OpenVPN starts is this program again (see main()), with openvpn's
+ * arguments. It connects as soon as the hold is released, and its config
+ * file says how it takes a stop:
+ *   "exit"    exits on "signal SIGTERM" like openvpn
+ *   "stuck"   ignores it, and SIGTERM too, only a kill gets rid of it
+ */
+class StandInOpenVPN : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StandInOpenVPN(bool stuck)
+        : m_server(this)
+        , m_client(nullptr)
+        , m_stuck(stuck)
+    {
+        connect(&m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    }
+
+    bool listen(const QString &host, quint16 port) {
+        return m_server.listen(QHostAddress(host), port);
+    }
+
+private slots:
+    void newConnection() {
+        m_client = m_server.nextPendingConnection();
+        connect(m_client, SIGNAL(readyRead()), this, SLOT(readyRead()));
+        send(">INFO:OpenVPN Management Interface Version 1 -- type 'help' for more info");
+        send(">HOLD:Waiting for hold release:0");
+    }
+
+    void readyRead() {
+        while (m_client->canReadLine()) {
+            QByteArray command(m_client->readLine().trimmed());
+            if (command == "hold release") {
+                send("SUCCESS: hold release succeeded");
+                printf("Initialization Sequence Completed\n");
+                fflush(stdout);
+            } else if (command == "signal SIGTERM") {
+                send("SUCCESS: signal SIGTERM thrown");
+                m_client->flush();
+                if (!m_stuck) {
+                    QCoreApplication::quit();
+                }
+            } else {
+                send("ERROR: unknown command, enter 'help' for more options");
+            }
+        }
+    }
+
+private:
+    void send(const QByteArray &line) {
+        m_client->write(line + "\r\n");
+    }
+
+    QTcpServer m_server;
+    QTcpSocket *m_client;
+    bool m_stuck;
+};
+
+static int standInOpenVPN(const QStringList &args) {
+    QFile config(args.value(2));
+    bool stuck = config.open(QFile::ReadOnly) && config.readAll().trimmed() == "stuck";
+    if (stuck) {
+        // QProcess::terminate(); on Windows it's a WM_CLOSE, which a
+        // console program doesn't get anyway
+        signal(SIGTERM, SIG_IGN);
+    }
+
+    int i = args.indexOf("--management");
+    StandInOpenVPN openvpn(stuck);
+    if (i < 0 || !openvpn.listen(args.value(i + 1), static_cast<quint16>(args.value(i + 2).toUInt()))) {
+        printf("Options error: no management port\n");
+        return 1;
+    }
+    return QCoreApplication::exec();
+}
+
+/*
+ * How long the event loop goes without running: a 1 ms timer that
+ * notes the longest gap between two of its ticks.
+ */
+class StallMeter : public QObject
+{
+    Q_OBJECT
+public:
+    StallMeter()
+        : maxStall(0)
+    {
+        m_timer.setTimerType(Qt::PreciseTimer);
+        m_timer.setInterval(1);
+        connect(&m_timer, SIGNAL(timeout()), this, SLOT(tick()));
+        m_timer.start();
+        m_sinceTick.start();
+    }
+
+    qint64 maxStall;
+
+private slots:
+    void tick() {
+        maxStall = qMax(maxStall, m_sinceTick.elapsed());
+        m_sinceTick.restart();
+    }
+
+private:
+    QTimer m_timer;
+    QElapsedTimer m_sinceTick;
+};
+
+class TestDisconnect : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_dir;
+    OpenVPN *m_openvpn;
+
+    void connectTo(const QByteArray &behaviour) {
+        QString path(m_dir.filePath(QString::fromLatin1(behaviour) + ".ovpn"));
+        QFile f(path);
+        QVERIFY(f.open(QFile::WriteOnly));
+        f.write(behaviour + "\n");
+        f.close();
+
+        QVERIFY(m_openvpn->connect(path));
+        QTRY_COMPARE_WITH_TIMEOUT(m_openvpn->getStatus(), OpenVPN::Connected, 5000);
+        QTRY_VERIFY_WITH_TIMEOUT(m_openvpn->isManagementReady(), 5000);
+    }
+
+    // Until the process is gone: the time it took and the longest stall
+    void disconnect(qint64 &elapsed, qint64 &maxStall) {
+        QSignalSpy exited(m_openvpn, SIGNAL(disconnected()));
+        StallMeter meter;
+        QElapsedTimer timer;
+        timer.start();
+        m_openvpn->disconnect();
+        QTRY_COMPARE_WITH_TIMEOUT(exited.size(), 1, 10000);
+        elapsed = timer.elapsed();
+        maxStall = meter.maxStall;
+        QCOMPARE(m_openvpn->getStatus(), OpenVPN::Disconnected);
+        qDebug() << "Stopped in" << elapsed << "ms, event loop stalled" << maxStall << "ms at most";
+    }
+
+private slots:
+    void init() {
+        m_openvpn = new OpenVPN(nullptr, QCoreApplication::applicationFilePath());
+        m_openvpn->setName("standin");
+    }
+
+    void cleanup() {
+        delete m_openvpn;
+    }
+
+    void graceful() {
+        connectTo("exit");
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        qint64 elapsed, maxStall;
+        disconnect(elapsed, maxStall);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        QVERIFY(elapsed < 1000);
+        QVERIFY(maxStall < 50);
+    }
+
+    // SIGTERM through the management socket, then terminate(), then kill():
+    // seconds of waiting, none of it on the event loop
+    void ignoresSigterm() {
+        connectTo("stuck");
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        qint64 elapsed, maxStall;
+        disconnect(elapsed, maxStall);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        QVERIFY(elapsed >= 3000);
+        QVERIFY(maxStall < 50);
+
+        bool killed = false;
+        foreach (const LogEntry &entry, m_openvpn->getLog()) {
+            killed = killed || entry.text == "# openvpn did not exit, killing";
+        }
+        QVERIFY(killed);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    if (argc > 1 && qstrcmp(argv[1], "--config") == 0) {
+        return standInOpenVPN(app.arguments());
+    }
+
+    TestDisconnect test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_disconnect.moc"
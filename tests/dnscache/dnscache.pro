@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_dnscache
+
+SOURCES += \
+    tst_dnscache.cpp \
+    $$SRC/dnscache.cpp
+
+HEADERS += \
+    $$SRC/dnscache.h
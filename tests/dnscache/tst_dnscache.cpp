@@ -0,0 +1,267 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QRegularExpression>
+#include <QTimer>
+#include <QUdpSocket>
+
+#include "dnscache.h"
+
+/*
+ * Stands in for a nameserver on 127.0.0.1, UDP only. Every answer waits
+ * Delay ms, so lookups overlap and the concurrency can be measured.
+ *   gw<n>.example.test         A 192.0.2.<n>, AAAA 2001:db8::<n>, TTL 300
+ *   v4only<n>.example.test     A only
+ *   broken.example.test        SERVFAIL
+ *   anything else              NXDOMAIN
+ *
+ * QDnsLookup can't be given a port (Qt 5), so it has to be 53: tests
+ * needing it are skipped where that port can't be bound.
+ */
+class NameserverStandIn : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        Delay = 50,
+        Ttl = 300,
+    };
+
+    NameserverStandIn()
+        : queries(0)
+        , maxInFlight(0)
+        , m_socket(this)
+    {
+        connect(&m_socket, SIGNAL(readyRead()), this, SLOT(readyRead()));
+    }
+
+    bool listen() {
+        return m_socket.bind(QHostAddress::LocalHost, 53);
+    }
+
+    int queries;
+    int maxInFlight;
+
+private slots:
+    void readyRead() {
+        while (m_socket.hasPendingDatagrams()) {
+            Pending p;
+            p.query.resize(static_cast<int>(m_socket.pendingDatagramSize()));
+            m_socket.readDatagram(p.query.data(), p.query.size(), &p.address, &p.port);
+            if (p.query.size() < 12) {
+                continue;
+            }
+            queries++;
+            m_pending.append(p);
+            maxInFlight = qMax(maxInFlight, m_pending.size());
+            QTimer::singleShot(Delay, this, SLOT(reply()));
+        }
+    }
+
+    void reply() {
+        Pending p(m_pending.takeFirst());
+        m_socket.writeDatagram(answer(p.query), p.address, p.port);
+    }
+
+private:
+    struct Pending {
+        QByteArray query;
+        QHostAddress address;
+        quint16 port;
+    };
+
+    static void put16(QByteArray &out, int value) {
+        out += static_cast<char>((value >> 8) & 0xff);
+        out += static_cast<char>(value & 0xff);
+    }
+
+    static QByteArray answer(const QByteArray &query) {
+        // Question: labels, then type and class
+        QStringList labels;
+        int pos = 12;
+        while (pos < query.size() && query[pos] != 0) {
+            int len = static_cast<quint8>(query[pos]);
+            labels.append(QString::fromLatin1(query.mid(pos + 1, len)));
+            pos += len + 1;
+        }
+        int end = pos + 5;
+        int type = (static_cast<quint8>(query[pos + 1]) << 8) | static_cast<quint8>(query[pos + 2]);
+        QString name(labels.join('.').toLower());
+
+        QList<QByteArray> records;
+        int rcode = 0;
+        QRegularExpressionMatch m(QRegularExpression("^(gw|v4only)(\\d+)\\.example\\.test$").match(name));
+        if (m.hasMatch()) {
+            int n = m.captured(2).toInt();
+            if (type == 1) {
+                quint32 ip = QHostAddress(QString("192.0.2.%1").arg(n)).toIPv4Address();
+                QByteArray rdata;
+                put16(rdata, static_cast<int>(ip >> 16));
+                put16(rdata, static_cast<int>(ip & 0xffff));
+                records << rdata;
+            } else if (type == 28 && m.captured(1) == "gw") {
+                Q_IPV6ADDR ip(QHostAddress(QString("2001:db8::%1").arg(n)).toIPv6Address());
+                records << QByteArray(reinterpret_cast<const char *>(ip.c), 16);
+            }
+        } else if (name == "broken.example.test") {
+            rcode = 2;
+        } else {
+            rcode = 3;
+        }
+
+        QByteArray out(query.left(2));
+        put16(out, 0x8180 | rcode);
+        put16(out, 1);
+        put16(out, records.size());
+        put16(out, 0);
+        put16(out, 0);
+        out += query.mid(12, end - 12);
+        foreach (const QByteArray &rdata, records) {
+            put16(out, 0xc00c);
+            put16(out, type);
+            put16(out, 1);
+            put16(out, 0);
+            put16(out, Ttl);
+            put16(out, rdata.size());
+            out += rdata;
+        }
+        return out;
+    }
+
+    QUdpSocket m_socket;
+    QList<Pending> m_pending;
+};
+
+class TestDnsCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    NameserverStandIn *m_nameserver;
+    bool m_listening;
+
+    static QStringList hosts(const QString &pattern, int count) {
+        QStringList l;
+        for (int i=1; i<=count; ++i) {
+            l.append(pattern.arg(i));
+        }
+        return l;
+    }
+
+    int cached(DnsCache &cache, const QStringList &hostnames, bool ipv6) {
+        int n = 0;
+        QStringList v4, v6;
+        foreach (const QString &host, hostnames) {
+            n += cache.lookup(host, ipv6, v4, v6) ? 1 : 0;
+        }
+        return n;
+    }
+
+private slots:
+    void initTestCase() {
+        m_nameserver = new NameserverStandIn;
+        m_listening = m_nameserver->listen();
+    }
+
+    void cleanupTestCase() {
+        delete m_nameserver;
+    }
+
+    void storeAndLookup() {
+        DnsCache cache;
+        QStringList v4, v6;
+        QVERIFY(!cache.lookup("gw1.example.test", false, v4, v6));
+
+        cache.store("GW1.example.test", true, QStringList("192.0.2.1"), QStringList("2001:db8::1"), 300);
+        QVERIFY(cache.lookup("gw1.EXAMPLE.test", true, v4, v6));
+        QCOMPARE(v4, QStringList("192.0.2.1"));
+        QCOMPARE(v6, QStringList("2001:db8::1"));
+
+        // Only IPv4 asked, none given
+        QVERIFY(cache.lookup("gw1.example.test", false, v4, v6));
+        QVERIFY(v6.isEmpty());
+    }
+
+    // Resolved without AAAA: not good enough once IPv6 is wanted
+    void ipv6Needed() {
+        DnsCache cache;
+        QStringList v4, v6;
+        cache.store("gw1.example.test", false, QStringList("192.0.2.1"), QStringList(), 300);
+        QVERIFY(cache.lookup("gw1.example.test", false, v4, v6));
+        QVERIFY(!cache.lookup("gw1.example.test", true, v4, v6));
+    }
+
+    // Clamped: a TTL of 0 would make every prefetch useless
+    void ttlClamped() {
+        DnsCache cache;
+        QStringList v4, v6;
+        cache.store("gw1.example.test", false, QStringList("192.0.2.1"), QStringList(), 0);
+        QVERIFY(cache.lookup("gw1.example.test", false, v4, v6));
+    }
+
+    /*
+     * The whole gateway list, through the stand-in: at most MaxLookups
+     * hosts (two queries each) at a time, everything cached after, and a
+     * click only costs a cache lookup.
+     */
+    void prefetch() {
+        if (!m_listening) {
+            QSKIP("Cannot bind 127.0.0.1:53 for the stand-in nameserver");
+        }
+        QStringList gateways(hosts("gw%1.example.test", 20) + hosts("v4only%1.example.test", 4));
+        m_nameserver->queries = 0;
+        m_nameserver->maxInFlight = 0;
+
+        DnsCache cache;
+        QElapsedTimer timer;
+        timer.start();
+        cache.prefetch(gateways, "127.0.0.1", true);
+        QTRY_COMPARE_WITH_TIMEOUT(cached(cache, gateways, true), gateways.size(), 10000);
+        qDebug() << gateways.size() << "gateways prefetched in" << timer.elapsed() << "ms,"
+                 << m_nameserver->maxInFlight << "queries in flight at most";
+
+        QCOMPARE(m_nameserver->queries, gateways.size() * 2);
+        QVERIFY(m_nameserver->maxInFlight <= DnsCache::MaxLookups * 2);
+        QVERIFY(m_nameserver->maxInFlight > 2);
+        // Concurrent: much less than one host after the other
+        QVERIFY(timer.elapsed() < gateways.size() * NameserverStandIn::Delay);
+
+        QStringList v4, v6;
+        QVERIFY(cache.lookup("gw7.example.test", true, v4, v6));
+        QCOMPARE(v4, QStringList("192.0.2.7"));
+        QCOMPARE(v6, QStringList("2001:db8::7"));
+        QVERIFY(cache.lookup("v4only2.example.test", true, v4, v6));
+        QCOMPARE(v4, QStringList("192.0.2.2"));
+        QVERIFY(v6.isEmpty());
+
+        // Every click is a hit now
+        timer.restart();
+        QCOMPARE(cached(cache, gateways, true), gateways.size());
+        qDebug() << "Click-time lookup:" << timer.nsecsElapsed() / gateways.size() << "ns";
+
+        // Cached hosts aren't asked again
+        int queries = m_nameserver->queries;
+        cache.prefetch(gateways, "127.0.0.1", true);
+        QTest::qWait(3 * NameserverStandIn::Delay);
+        QCOMPARE(m_nameserver->queries, queries);
+    }
+
+    // Not cached, left to the resolution on connect
+    void failures() {
+        if (!m_listening) {
+            QSKIP("Cannot bind 127.0.0.1:53 for the stand-in nameserver");
+        }
+        QStringList gateways;
+        gateways << "broken.example.test" << "nothing.example.test" << "gw1.example.test";
+
+        DnsCache cache;
+        cache.prefetch(gateways, "127.0.0.1", true);
+        QTRY_COMPARE_WITH_TIMEOUT(cached(cache, QStringList("gw1.example.test"), true), 1, 5000);
+        QTest::qWait(3 * NameserverStandIn::Delay);
+        QCOMPARE(cached(cache, gateways, true), 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDnsCache)
+
+#include "tst_dnscache.moc"
@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_dohresolver
+
+SOURCES += \
+    tst_dohresolver.cpp \
+    $$SRC/dohresolver.cpp
+
+HEADERS += \
+    $$SRC/dohresolver.h
@@ -0,0 +1,96 @@
+#include <QtTest>
+
+#include "dohresolver.h"
+
+class TestDohResolver : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // As Cloudflare answers, with the CNAME chain first
+    void parseAddresses() {
+        QByteArray json(
+            "{\"Status\":0,\"TC\":false,\"RD\":true,\"RA\":true,\"AD\":false,\"CD\":false,"
+            "\"Question\":[{\"name\":\"gw.example.net\",\"type\":1}],"
+            "\"Answer\":["
+            "{\"name\":\"gw.example.net\",\"type\":5,\"TTL\":30,\"data\":\"lb.example.net.\"},"
+            "{\"name\":\"lb.example.net\",\"type\":1,\"TTL\":300,\"data\":\"192.0.2.1\"},"
+            "{\"name\":\"lb.example.net\",\"type\":1,\"TTL\":120,\"data\":\"192.0.2.2\"}"
+            "]}");
+
+        QStringList addresses;
+        int ttl = 0;
+        QVERIFY(DohResolver::parseAnswer(json, DohResolver::TypeA, addresses, ttl));
+        QCOMPARE(addresses, QStringList() << "192.0.2.1" << "192.0.2.2");
+        // The CNAME's TTL doesn't count
+        QCOMPARE(ttl, 120);
+    }
+
+    void parseIPv6() {
+        QByteArray json(
+            "{\"Status\":0,\"Answer\":["
+            "{\"name\":\"gw.example.net\",\"type\":28,\"TTL\":600,\"data\":\"2001:DB8:0::1\"},"
+            "{\"name\":\"gw.example.net\",\"type\":1,\"TTL\":600,\"data\":\"192.0.2.1\"}"
+            "]}");
+
+        QStringList addresses;
+        int ttl = 0;
+        QVERIFY(DohResolver::parseAnswer(json, DohResolver::TypeAAAA, addresses, ttl));
+        QCOMPARE(addresses, QStringList("2001:db8::1"));
+        QCOMPARE(ttl, 600);
+    }
+
+    void clampTtl_data() {
+        QTest::addColumn<int>("ttl");
+        QTest::addColumn<int>("expected");
+        QTest::newRow("short") << 5 << static_cast<int>(DohResolver::MinTtl);
+        QTest::newRow("long") << 86400 << static_cast<int>(DohResolver::MaxTtl);
+        QTest::newRow("in range") << 900 << 900;
+    }
+
+    void clampTtl() {
+        QFETCH(int, ttl);
+        QFETCH(int, expected);
+
+        QByteArray json(QString("{\"Status\":0,\"Answer\":[{\"type\":1,\"TTL\":%1,\"data\":\"192.0.2.1\"}]}")
+                        .arg(ttl).toUtf8());
+        QStringList addresses;
+        int parsed = 0;
+        QVERIFY(DohResolver::parseAnswer(json, DohResolver::TypeA, addresses, parsed));
+        QCOMPARE(parsed, expected);
+    }
+
+    // NXDOMAIN, or a name without records of that type, is an answer
+    void parseNoAddress() {
+        QStringList addresses("stale");
+        int ttl = 0;
+        QVERIFY(DohResolver::parseAnswer("{\"Status\":3,\"Authority\":[]}", DohResolver::TypeA, addresses, ttl));
+        QVERIFY(addresses.isEmpty());
+        QCOMPARE(ttl, static_cast<int>(DohResolver::MinTtl));
+
+        QVERIFY(DohResolver::parseAnswer("{\"Status\":0,\"Answer\":[{\"type\":1,\"TTL\":60,\"data\":\"not an address\"}]}",
+                                         DohResolver::TypeA, addresses, ttl));
+        QVERIFY(addresses.isEmpty());
+    }
+
+    // The server couldn't answer: fall back to plain DNS
+    void parseFailure_data() {
+        QTest::addColumn<QByteArray>("json");
+        QTest::newRow("SERVFAIL") << QByteArray("{\"Status\":2}");
+        QTest::newRow("REFUSED") << QByteArray("{\"Status\":5}");
+        QTest::newRow("no status") << QByteArray("{\"Answer\":[]}");
+        QTest::newRow("not JSON") << QByteArray("<html>Bad gateway</html>");
+        QTest::newRow("empty") << QByteArray();
+    }
+
+    void parseFailure() {
+        QFETCH(QByteArray, json);
+        QStringList addresses;
+        int ttl = 0;
+        QVERIFY(!DohResolver::parseAnswer(json, DohResolver::TypeA, addresses, ttl));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDohResolver)
+
+#include "tst_dohresolver.moc"
@@ -0,0 +1,96 @@
+#include <QtTest>
+#include <QFile>
+#include <QStringList>
+
+#include "openvpn.h"
+
+struct CorpusLine {
+    LogEntry::Source source;
+    LogEntry::Level level;
+    QString text;
+};
+
+Q_DECLARE_METATYPE(LogEntry::Source)
+Q_DECLARE_METATYPE(LogEntry::Level)
+
+// corpus.txt: "<source>|<level>|<line>", # comments
+static QList<CorpusLine> readCorpus() {
+    QList<CorpusLine> corpus;
+    QFile f(QFINDTESTDATA("corpus.txt"));
+    if (!f.open(QFile::ReadOnly | QFile::Text)) {
+        return corpus;
+    }
+
+    foreach (const QString &line, QString::fromUtf8(f.readAll()).split('\n')) {
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        QString source(line.section('|', 0, 0));
+        QString level(line.section('|', 1, 1));
+
+        CorpusLine c;
+        c.source = source == "status" ? LogEntry::Status
+                 : source == "management" ? LogEntry::Management : LogEntry::Process;
+        c.level = level == "debug" ? LogEntry::Debug
+                : level == "warning" ? LogEntry::Warning
+                : level == "error" ? LogEntry::Error : LogEntry::Info;
+        c.text = line.section('|', 2);
+        corpus.append(c);
+    }
+    return corpus;
+}
+
+class TestLogClassify : public QObject
+{
+    Q_OBJECT
+
+private:
+    QList<CorpusLine> m_corpus;
+
+private slots:
+    void initTestCase() {
+        m_corpus = readCorpus();
+        QVERIFY(m_corpus.size() > 50);
+    }
+
+    void corpus_data() {
+        QTest::addColumn<LogEntry::Source>("source");
+        QTest::addColumn<LogEntry::Level>("level");
+        QTest::addColumn<QString>("line");
+
+        QList<CorpusLine> corpus(readCorpus());
+        for (int i=0; i<corpus.size(); ++i) {
+            QTest::newRow(qPrintable(QString("%1: %2").arg(i).arg(corpus[i].text.left(40))))
+                << corpus[i].source << corpus[i].level << corpus[i].text;
+        }
+    }
+
+    void corpus() {
+        QFETCH(LogEntry::Source, source);
+        QFETCH(LogEntry::Level, level);
+        QFETCH(QString, line);
+
+        QCOMPARE(int(OpenVPN::classify(source, line)), int(level));
+    }
+
+    // Every line goes through it once, as it comes in
+    void throughput() {
+        int errors = 0;
+        QBENCHMARK {
+            errors = 0;
+            for (int i=0; i<1000; ++i) {
+                foreach (const CorpusLine &c, m_corpus) {
+                    if (OpenVPN::classify(c.source, c.text) == LogEntry::Error) {
+                        errors++;
+                    }
+                }
+            }
+        }
+        QVERIFY(errors > 0);
+        qDebug() << "Per iteration:" << 1000 * m_corpus.size() << "lines";
+    }
+};
+
+QTEST_GUILESS_MAIN(TestLogClassify)
+
+#include "tst_logclassify.moc"
@@ -0,0 +1,19 @@
+include(../tests.pri)
+
+TARGET = tst_logexport
+
+SOURCES += \
+    tst_logexport.cpp \
+    $$SRC/logexport.cpp \
+    $$SRC/logstore.cpp \
+    $$SRC/logentry.cpp
+
+HEADERS += \
+    $$SRC/logexport.h \
+    $$SRC/logstore.h \
+    $$SRC/logentry.h
+
+# Crypto++
+LIBPATH += C:/CryptoPP/release
+INCLUDEPATH += C:/CryptoPP/include
+LIBS += -lcryptopp
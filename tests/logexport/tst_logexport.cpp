@@ -0,0 +1,153 @@
+#include <QtTest>
+#include <QDateTime>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <string>
+#include <cryptopp/filters.h>
+#include <cryptopp/gzip.h>
+
+#include "logexport.h"
+#include "logstore.h"
+
+static LogEntry makeEntry(int i) {
+    LogEntry e(LogEntry::Process, LogEntry::Info, i % 2 ? "gw2" : "", QString("Line %1 éè").arg(i));
+    e.time = Q_INT64_C(1555555555000) + i * 1000;
+    return e;
+}
+
+static QByteArray readFile(const QString &path) {
+    QFile f(path);
+    if (!f.open(QFile::ReadOnly)) {
+        return QByteArray();
+    }
+    return f.readAll();
+}
+
+static QByteArray gunzip(const QByteArray &data) {
+    std::string out;
+    CryptoPP::StringSource(reinterpret_cast<const byte *>(data.constData()), data.size(), true,
+                           new CryptoPP::Gunzip(new CryptoPP::StringSink(out)));
+    return QByteArray(out.data(), static_cast<int>(out.size()));
+}
+
+static bool exportEntries(const QString &path, int count) {
+    LogExporter exporter(path);
+    if (!exporter.open()) {
+        return false;
+    }
+    for (int i=0; i<count; ++i) {
+        if (!exporter.write(makeEntry(i))) {
+            return false;
+        }
+    }
+    return exporter.finish() && exporter.getCount() == count;
+}
+
+// Where a LogExportJob's finished() lands, on the test's thread
+class Receiver : public QObject
+{
+    Q_OBJECT
+public:
+    Receiver() : done(false), ok(false) {}
+
+    bool done;
+    bool ok;
+    QString error;
+
+public slots:
+    void finished(const QString &, bool success, const QString &message) {
+        done = true;
+        ok = success;
+        error = message;
+    }
+};
+
+class TestLogExport : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void lineFormat() {
+        QTemporaryDir dir;
+        QString path(dir.path() + "/log.txt");
+        QVERIFY(exportEntries(path, 2));
+
+        LogEntry first(makeEntry(0));
+        QString time(QDateTime::fromMSecsSinceEpoch(first.time).toString("yyyy-MM-dd hh:mm:ss"));
+        QString second(QDateTime::fromMSecsSinceEpoch(makeEntry(1).time).toString("yyyy-MM-dd hh:mm:ss"));
+        QByteArray expected((time + " Line 0 éè\n" + second + " [gw2] Line 1 éè\n").toUtf8());
+        QCOMPARE(readFile(path), expected);
+    }
+
+    // A million lines, many chunks: the gzip file holds the same text
+    void gzipMatchesPlain() {
+        QTemporaryDir dir;
+        const int count = 1000000;
+        QVERIFY(exportEntries(dir.path() + "/log.txt", count));
+        QVERIFY(exportEntries(dir.path() + "/log.txt.gz", count));
+
+        QByteArray plain(readFile(dir.path() + "/log.txt"));
+        QByteArray compressed(readFile(dir.path() + "/log.txt.gz"));
+        QVERIFY(plain.size() > 16 * LogExporter::ChunkSize);
+        QVERIFY(compressed.size() < plain.size());
+        QCOMPARE(plain.count('\n'), count);
+        QVERIFY(gunzip(compressed) == plain);
+    }
+
+    void openFails() {
+        QTemporaryDir dir;
+        LogExporter exporter(dir.path() + "/missing/log.txt");
+        QVERIFY(!exporter.open());
+        QVERIFY(!exporter.errorString().isEmpty());
+        QVERIFY(!exporter.finish());
+    }
+
+    void jobFromEntries() {
+        QTemporaryDir dir;
+        QList<LogEntry> entries;
+        for (int i=0; i<1000; ++i) {
+            entries.append(makeEntry(i));
+        }
+
+        Receiver receiver;
+        LogExportJob *job = new LogExportJob(dir.path() + "/log.txt", entries);
+        connect(job, SIGNAL(finished(QString,bool,QString)), &receiver, SLOT(finished(QString,bool,QString)));
+        job->start();
+
+        QTRY_VERIFY_WITH_TIMEOUT(receiver.done, 30000);
+        QVERIFY2(receiver.ok, qPrintable(receiver.error));
+        QCOMPARE(readFile(dir.path() + "/log.txt").count('\n'), 1000);
+    }
+
+    // What matches the query in the stored segments
+    void jobFromSegments() {
+        QTemporaryDir dir;
+        LogStore store;
+        QVERIFY(store.open(dir.path() + "/logs"));
+        for (int i=0; i<1000; ++i) {
+            store.append(makeEntry(i));
+        }
+
+        LogQuery query;
+        query.tunnel = "gw2";
+        query.text = "line 9";
+
+        Receiver receiver;
+        LogExportJob *job = new LogExportJob(dir.path() + "/log.txt.gz", store.getSegmentFiles(), query);
+        connect(job, SIGNAL(finished(QString,bool,QString)), &receiver, SLOT(finished(QString,bool,QString)));
+        job->start();
+
+        QTRY_VERIFY_WITH_TIMEOUT(receiver.done, 30000);
+        QVERIFY2(receiver.ok, qPrintable(receiver.error));
+        // Odd lines starting with 9: 9, 91..99, 901..999
+        QByteArray text(gunzip(readFile(dir.path() + "/log.txt.gz")));
+        QCOMPARE(text.count('\n'), 1 + 5 + 50);
+        QVERIFY(text.contains("[gw2] Line 999 "));
+        QVERIFY(!text.contains("Line 98 "));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestLogExport)
+
+#include "tst_logexport.moc"
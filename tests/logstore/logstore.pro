@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+TARGET = tst_logstore
+
+SOURCES += \
+    tst_logstore.cpp \
+    $$SRC/logstore.cpp \
+    $$SRC/logentry.cpp
+
+HEADERS += \
+    $$SRC/logstore.h \
+    $$SRC/logentry.h
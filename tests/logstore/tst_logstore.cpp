@@ -0,0 +1,212 @@
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "logstore.h"
+
+static LogEntry makeEntry(qint64 time, LogEntry::Level level, const QString &tunnel, const QString &text) {
+    LogEntry e(LogEntry::Process, level, tunnel, text);
+    e.time = time;
+    return e;
+}
+
+static QStringList texts(const QList<LogEntry> &entries) {
+    QStringList list;
+    foreach (const LogEntry &e, entries) {
+        list.append(e.text);
+    }
+    return list;
+}
+
+class TestLogStore : public QObject
+{
+    Q_OBJECT
+
+private:
+    // 10 entries, time i * 1000, tunnels a/b, every third one an error
+    void fill(LogStore &store) {
+        for (int i=0; i<10; ++i) {
+            LogEntry::Level level = i % 3 == 0 ? LogEntry::Error : LogEntry::Info;
+            store.append(makeEntry(i * 1000, level, i % 2 ? "b" : "a", QString("Line %1").arg(i)));
+        }
+    }
+
+    // One record per call, to fill segments quickly
+    void appendLarge(LogStore &store, int count, int first = 0) {
+        QString text(60 * 1024, 'x');
+        for (int i=0; i<count; ++i) {
+            store.append(makeEntry(first + i, LogEntry::Info, "a", QString::number(first + i) + text));
+        }
+    }
+
+private slots:
+    void search() {
+        QTemporaryDir dir;
+        LogStore store;
+        QVERIFY(store.open(dir.path()));
+        fill(store);
+
+        LogQuery all;
+        QCOMPARE(store.search(all).size(), 10);
+        QCOMPARE(store.search(all).first().text, QString("Line 0"));
+
+        LogQuery text;
+        text.text = "line 7";
+        QCOMPARE(texts(store.search(text)), QStringList("Line 7"));
+
+        LogQuery errors;
+        errors.levelMask = 1 << LogEntry::Error;
+        QCOMPARE(texts(store.search(errors)), QStringList() << "Line 0" << "Line 3" << "Line 6" << "Line 9");
+
+        LogQuery tunnel;
+        tunnel.tunnel = "b";
+        QCOMPARE(store.search(tunnel).size(), 5);
+        QCOMPARE(store.search(tunnel).first().tunnel, QString("b"));
+
+        LogQuery range;
+        range.from = 2000;
+        range.to = 4000;
+        QCOMPARE(texts(store.search(range)), QStringList() << "Line 2" << "Line 3" << "Line 4");
+
+        // The most recent matches
+        LogQuery limit;
+        limit.limit = 2;
+        QCOMPARE(texts(store.search(limit)), QStringList() << "Line 8" << "Line 9");
+    }
+
+    void forEachStops() {
+        QTemporaryDir dir;
+        LogStore store;
+        QVERIFY(store.open(dir.path()));
+        fill(store);
+
+        QStringList seen;
+        store.forEach(LogQuery(), [&seen](const LogEntry &e) {
+            seen.append(e.text);
+            return seen.size() < 3;
+        });
+        QCOMPARE(seen, QStringList() << "Line 0" << "Line 1" << "Line 2");
+    }
+
+    // What worker threads use, without the LogStore
+    void forEachInSegment() {
+        QTemporaryDir dir;
+        LogStore store;
+        QVERIFY(store.open(dir.path()));
+        fill(store);
+
+        QList<LogStore::SegmentFile> files(store.getSegmentFiles());
+        QCOMPARE(files.size(), 1);
+
+        LogQuery query;
+        query.tunnel = "a";
+        query.levelMask = 1 << LogEntry::Error;
+        QStringList seen;
+        QVERIFY(LogStore::forEachInSegment(files.first(), [&seen](const LogEntry &e) {
+            seen.append(e.text);
+            return true;
+        }, query));
+        QCOMPARE(seen, QStringList() << "Line 0" << "Line 6");
+
+        QVERIFY(!LogStore::forEachInSegment(files.first(), [](const LogEntry &) {
+            return false;
+        }));
+    }
+
+    void reopen() {
+        QTemporaryDir dir;
+        {
+            LogStore store;
+            QVERIFY(store.open(dir.path()));
+            fill(store);
+        }
+
+        LogStore store;
+        QVERIFY(store.open(dir.path()));
+        QCOMPARE(store.search(LogQuery()).size(), 10);
+
+        // Appends go on after the old records
+        store.append(makeEntry(10000, LogEntry::Info, "a", "Line 10"));
+        QCOMPARE(store.search(LogQuery()).last().text, QString("Line 10"));
+    }
+
+    // After a crash: no index, and half a record at the end
+    void recoverAfterCrash() {
+        QTemporaryDir dir;
+        {
+            LogStore store;
+            QVERIFY(store.open(dir.path()));
+            fill(store);
+        }
+
+        QDir logs(dir.path());
+        foreach (QString name, logs.entryList(QStringList("*.idx"))) {
+            QVERIFY(logs.remove(name));
+        }
+        QString segment(logs.filePath(logs.entryList(QStringList("*.seg")).first()));
+        qint64 size = QFileInfo(segment).size();
+        QFile f(segment);
+        QVERIFY(f.open(QFile::Append));
+        f.write(QByteArray("\x40\x00\x00\x00\x01\x02", 6));
+        f.close();
+
+        LogStore store;
+        QVERIFY(store.open(dir.path()));
+        QCOMPARE(QFileInfo(segment).size(), size);
+        QCOMPARE(store.search(LogQuery()).size(), 10);
+        LogQuery errors;
+        errors.levelMask = 1 << LogEntry::Error;
+        QCOMPARE(store.search(errors).size(), 4);
+    }
+
+    void rotate() {
+        QTemporaryDir dir;
+        LogStore store;
+        QVERIFY(store.open(dir.path()));
+
+        int perSegment = LogStore::SegmentSize / (61 * 1024);
+        appendLarge(store, perSegment * 3);
+
+        QList<LogStore::SegmentFile> files(store.getSegmentFiles());
+        QVERIFY(files.size() >= 3);
+        foreach (const LogStore::SegmentFile &f, files) {
+            QVERIFY(f.size <= LogStore::SegmentSize);
+        }
+
+        // Searches span segments
+        LogQuery query;
+        query.limit = perSegment * 3;
+        QList<LogEntry> found(store.search(query));
+        QCOMPARE(found.size(), perSegment * 3);
+        for (int i=0; i<found.size(); ++i) {
+            QCOMPARE(found[i].time, qint64(i));
+        }
+    }
+
+    // Past MaxSegments the oldest go, with their records
+    void dropOldSegments() {
+        QTemporaryDir dir;
+        LogStore store;
+        QVERIFY(store.open(dir.path()));
+
+        int perSegment = LogStore::SegmentSize / (61 * 1024);
+        int count = perSegment * (LogStore::MaxSegments + 2);
+        appendLarge(store, count);
+
+        QCOMPARE(store.getSegmentFiles().size(), static_cast<int>(LogStore::MaxSegments));
+        QCOMPARE(QDir(dir.path()).entryList(QStringList("*.seg")).size(), static_cast<int>(LogStore::MaxSegments));
+
+        LogQuery first;
+        first.to = 0;
+        QVERIFY(store.search(first).isEmpty());
+        LogQuery last;
+        last.from = count - 1;
+        QCOMPARE(store.search(last).size(), 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestLogStore)
+
+#include "tst_logstore.moc"
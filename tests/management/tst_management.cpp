@@ -0,0 +1,465 @@
+#include <QtTest>
+#include <QCoreApplication>
+#include <QSignalSpy>
+#include <QQueue>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#include "openvpn.h"
+
+/*
+ * Stands in for openvpn's management interface, the real OpenVPN client
+ * talks to it. The process OpenVPN starts is this program again (see
+ * main()), it only waits to be killed.
+ *
+ * Responses come in order, each after a random delay, and real-time
+ * notifications (">BYTECOUNT:", ">LOG:") are sent in between at random.
+ * Besides "hold release", credentials and signals, it answers
+ * "test <n> <kind>" with a response that can be checked:
+ *   kind 0: "SUCCESS: test <n>"
+ *   kind 1: "ERROR: test <n>"
+ *   kind 2: n % 5 lines "test <n> line <i>", then "END"
+ */
+class MockManagement : public QObject
+{
+    Q_OBJECT
+public:
+    MockManagement()
+        : m_server(this)
+        , m_client(nullptr)
+        , m_maxLatency(0)
+        , m_notifications(false)
+        , m_paused(false)
+    {
+        m_replyTimer.setSingleShot(true);
+        connect(&m_replyTimer, SIGNAL(timeout()), this, SLOT(sendReply()));
+        m_noiseTimer.setSingleShot(true);
+        connect(&m_noiseTimer, SIGNAL(timeout()), this, SLOT(sendNoise()));
+        connect(&m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    }
+
+    bool listen(quint16 port) {
+        return m_server.listen(QHostAddress::LocalHost, port);
+    }
+
+    bool isConnected() const {
+        return m_client != nullptr;
+    }
+
+    // Every response waits up to that long
+    void setMaxLatency(int ms) {
+        m_maxLatency = ms;
+    }
+
+    void setNotifications(bool enabled) {
+        m_notifications = enabled;
+        if (enabled && m_client) {
+            m_noiseTimer.start(qrand() % 4);
+        }
+    }
+
+    // Hold the responses back, e.g. to have many queries in flight
+    void setPaused(bool paused) {
+        m_paused = paused;
+        if (!paused) {
+            scheduleReply();
+        }
+    }
+
+    // A notification, right away
+    void send(const QByteArray &line) {
+        m_client->write(line + "\r\n");
+    }
+
+    void disconnectClient() {
+        m_replies.clear();
+        m_client->disconnectFromHost();
+    }
+
+    // Every command line received
+    QList<QByteArray> commands;
+
+private slots:
+    void newConnection() {
+        m_client = m_server.nextPendingConnection();
+        connect(m_client, SIGNAL(readyRead()), this, SLOT(readyRead()));
+        connect(m_client, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+        send(">INFO:OpenVPN Management Interface Version 1 -- type 'help' for more info");
+        send(">HOLD:Waiting for hold release:0");
+        setNotifications(m_notifications);
+    }
+
+    void clientDisconnected() {
+        m_replyTimer.stop();
+        m_noiseTimer.stop();
+        m_client->deleteLater();
+        m_client = nullptr;
+    }
+
+    void readyRead() {
+        while (m_client && m_client->canReadLine()) {
+            QByteArray line(m_client->readLine());
+            line.chop(1);
+            commands.append(line);
+            m_replies.enqueue(reply(line));
+        }
+        scheduleReply();
+    }
+
+    void sendReply() {
+        if (!m_client || m_replies.isEmpty() || m_paused) {
+            return;
+        }
+        m_client->write(m_replies.dequeue());
+        scheduleReply();
+    }
+
+    void sendNoise() {
+        if (!m_client) {
+            return;
+        }
+        if (qrand() % 2) {
+            send(">BYTECOUNT:" + QByteArray::number(qrand()) + "," + QByteArray::number(qrand()));
+        } else {
+            send(">LOG:1555000000,,MANAGEMENT: noise " + QByteArray::number(qrand()));
+        }
+        if (m_notifications) {
+            m_noiseTimer.start(qrand() % 4);
+        }
+    }
+
+private:
+    void scheduleReply() {
+        if (!m_replies.isEmpty() && !m_paused && !m_replyTimer.isActive()) {
+            m_replyTimer.start(m_maxLatency > 0 ? qrand() % (m_maxLatency + 1) : 0);
+        }
+    }
+
+    static QByteArray reply(const QByteArray &command) {
+        QList<QByteArray> words(command.split(' '));
+        if (command == "hold release") {
+            return "SUCCESS: hold release succeeded\r\n";
+        }
+        if (words[0] == "username" || words[0] == "password") {
+            return "SUCCESS: " + words.value(1).replace('"', '\'') + " "
+                + words[0] + " entered, but not yet verified\r\n";
+        }
+        if (words[0] == "signal") {
+            return "SUCCESS: signal " + words.value(1) + " thrown\r\n";
+        }
+        if (words[0] == "test" && words.size() == 3) {
+            QByteArray n(words[1]);
+            int kind = words[2].toInt();
+            if (kind == 0) {
+                return "SUCCESS: test " + n + "\r\n";
+            } else if (kind == 1) {
+                return "ERROR: test " + n + "\r\n";
+            }
+            QByteArray lines;
+            for (int i=0; i<n.toInt() % 5; ++i) {
+                lines += "test " + n + " line " + QByteArray::number(i) + "\r\n";
+            }
+            return lines + "END\r\n";
+        }
+        return "ERROR: unknown command, enter 'help' for more options\r\n";
+    }
+
+    QTcpServer m_server;
+    QTcpSocket *m_client;
+    QQueue<QByteArray> m_replies;
+    QTimer m_replyTimer;
+    QTimer m_noiseTimer;
+    int m_maxLatency;
+    bool m_notifications;
+    bool m_paused;
+};
+
+// What the mock answers to "test <n> <kind>"
+static void expected(int n, int kind, bool &ok, QStringList &lines) {
+    lines.clear();
+    ok = kind != 1;
+    if (kind == 0) {
+        lines << QString("SUCCESS: test %1").arg(n);
+    } else if (kind == 1) {
+        lines << QString("ERROR: test %1").arg(n);
+    } else {
+        for (int i=0; i<n % 5; ++i) {
+            lines << QString("test %1 line %2").arg(n).arg(i);
+        }
+    }
+}
+
+struct Response {
+    int n;
+    bool ok;
+    QStringList lines;
+};
+
+class TestManagement : public QObject
+{
+    Q_OBJECT
+
+private:
+    MockManagement *m_mock;
+    OpenVPN *m_openvpn;
+
+    // openvpn "running", its management interface being the mock's
+    void start() {
+        QVERIFY(m_openvpn->connect("mock.ovpn"));
+
+        quint16 port = 0;
+        foreach (const LogEntry &entry, m_openvpn->getLog()) {
+            if (entry.text.startsWith("# Management: ")) {
+                port = static_cast<quint16>(entry.text.section(':', -1).toUInt());
+            }
+        }
+        QVERIFY(port != 0);
+        QVERIFY(m_mock->listen(port));
+
+        QTRY_VERIFY_WITH_TIMEOUT(m_openvpn->isManagementReady(), 5000);
+        QTRY_VERIFY_WITH_TIMEOUT(m_mock->commands.contains("hold release"), 5000);
+    }
+
+    static VPNCreds creds(const QByteArray &username, const QByteArray &password) {
+        VPNCreds c;
+        c.username = SecureBuffer(username.constData(), username.size());
+        c.password = SecureBuffer(password.constData(), password.size());
+        return c;
+    }
+
+    bool logContains(const QString &text) const {
+        foreach (const LogEntry &entry, m_openvpn->getLog()) {
+            if (entry.text.contains(text)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void query(int n, int kind, QList<Response> &responses) {
+        m_openvpn->queryManagement(QString("test %1 %2").arg(n).arg(kind),
+                                   [n, &responses](bool ok, const QStringList &lines) {
+            Response r;
+            r.n = n;
+            r.ok = ok;
+            r.lines = lines;
+            responses.append(r);
+        });
+    }
+
+private slots:
+    void initTestCase() {
+        qsrand(static_cast<uint>(QDateTime::currentMSecsSinceEpoch()));
+    }
+
+    void init() {
+        m_mock = new MockManagement;
+        m_openvpn = new OpenVPN(nullptr, QCoreApplication::applicationFilePath());
+        m_openvpn->setName("mock");
+    }
+
+    void cleanup() {
+        delete m_openvpn;
+        delete m_mock;
+    }
+
+    /*
+     * Many queries in flight at once, answered after random delays, with
+     * notifications in between: every callback gets its own response, in
+     * the order the queries were sent.
+     */
+    void pipelinedQueries() {
+        start();
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        m_mock->setMaxLatency(5);
+        m_mock->setNotifications(true);
+
+        const int Count = 500;
+        QList<int> kinds;
+        QList<Response> responses;
+        for (int n=0; n<Count; ++n) {
+            kinds.append(qrand() % 3);
+            query(n, kinds.last(), responses);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(responses.size(), Count, 30000);
+
+        for (int n=0; n<Count; ++n) {
+            bool ok;
+            QStringList lines;
+            expected(n, kinds[n], ok, lines);
+            QCOMPARE(responses[n].n, n);
+            QCOMPARE(responses[n].ok, ok);
+            QCOMPARE(responses[n].lines, lines);
+        }
+    }
+
+    // All sent before the first response comes back
+    void burst() {
+        start();
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        m_mock->setPaused(true);
+
+        QList<Response> responses;
+        for (int n=0; n<100; ++n) {
+            query(n, 2, responses);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(m_mock->commands.size(), 101, 5000);
+        QVERIFY(responses.isEmpty());
+
+        m_mock->setPaused(false);
+        QTRY_COMPARE_WITH_TIMEOUT(responses.size(), 100, 5000);
+        for (int n=0; n<100; ++n) {
+            QCOMPARE(responses[n].n, n);
+        }
+    }
+
+    // The queue is in order before a callback runs: it can send more
+    void queryFromCallback() {
+        start();
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        m_mock->setMaxLatency(2);
+
+        QList<Response> responses;
+        m_openvpn->queryManagement("test 1 0", [this, &responses](bool, const QStringList &) {
+            query(2, 2, responses);
+            query(3, 0, responses);
+        });
+        query(4, 1, responses);
+
+        QTRY_COMPARE_WITH_TIMEOUT(responses.size(), 3, 5000);
+        QCOMPARE(responses[0].n, 4);
+        QCOMPARE(responses[1].n, 2);
+        QCOMPARE(responses[1].lines, QStringList() << "test 2 line 0" << "test 2 line 1");
+        QCOMPARE(responses[2].n, 3);
+    }
+
+    // The socket goes away: whatever is waiting fails, once
+    void disconnectFailsQueries() {
+        start();
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        m_mock->setPaused(true);
+
+        QList<Response> responses;
+        for (int n=0; n<10; ++n) {
+            query(n, 0, responses);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(m_mock->commands.size(), 11, 5000);
+
+        m_mock->disconnectClient();
+        QTRY_COMPARE_WITH_TIMEOUT(responses.size(), 10, 5000);
+        for (int n=0; n<10; ++n) {
+            QCOMPARE(responses[n].n, n);
+            QVERIFY(!responses[n].ok);
+            QCOMPARE(responses[n].lines, QStringList("ERROR: management interface closed"));
+        }
+
+        QVERIFY(!m_openvpn->isManagementReady());
+        QVERIFY(!m_openvpn->queryManagement("test 10 0", OpenVPN::MgmtCallback()));
+        QTest::qWait(100);
+        QCOMPARE(responses.size(), 10);
+    }
+
+    /*
+     * openvpn asks for credentials again on every reconnect. The server's
+     * session token replaces the password until it's refused, and only
+     * then, or on a first connect, is the user asked again.
+     */
+    void repeatedPasswordNeed() {
+        start();
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        const QByteArray Need(">PASSWORD:Need 'Auth' username/password");
+        QSignalSpy asked(m_openvpn, SIGNAL(authRequested(bool)));
+
+        m_mock->send(Need);
+        QTRY_COMPARE_WITH_TIMEOUT(asked.size(), 1, 5000);
+        QCOMPARE(asked[0][0].toBool(), false);
+
+        // Nobody answered yet, the socket is still read
+        QList<Response> responses;
+        query(1, 0, responses);
+        QTRY_COMPARE_WITH_TIMEOUT(responses.size(), 1, 5000);
+
+        // Quoted, spaces and all
+        m_openvpn->sendCredentials(creds("user", "pa\"ss w\\d"));
+        QTRY_VERIFY_WITH_TIMEOUT(m_mock->commands.contains("password \"Auth\" \"pa\\\"ss w\\\\d\""), 5000);
+        QVERIFY(m_mock->commands.contains("username \"Auth\" \"user\""));
+
+        // Pushed by the server, then used for every reconnect
+        m_mock->send(">PASSWORD:Auth-Token:T0KEN-1");
+        for (int i=0; i<3; ++i) {
+            m_mock->send(Need);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(m_mock->commands.count("password \"Auth\" \"T0KEN-1\""), 3, 5000);
+        QCOMPARE(m_mock->commands.count("username \"Auth\" \"user\""), 4);
+        QCOMPARE(asked.size(), 1);
+
+        // Kept by a restart of the same process
+        QVERIFY(m_openvpn->restart());
+        m_mock->send(Need);
+        QTRY_COMPARE_WITH_TIMEOUT(m_mock->commands.count("password \"Auth\" \"T0KEN-1\""), 4, 5000);
+        QCOMPARE(asked.size(), 1);
+
+        // Refused: dropped, and the user is asked
+        m_mock->send(">PASSWORD:Verification Failed: 'Auth'");
+        m_mock->send(Need);
+        QTRY_COMPARE_WITH_TIMEOUT(asked.size(), 2, 5000);
+        QCOMPARE(asked[1][0].toBool(), true);
+        m_openvpn->sendCredentials(creds("user", "second"));
+        QTRY_VERIFY_WITH_TIMEOUT(m_mock->commands.contains("password \"Auth\" \"second\""), 5000);
+        QCOMPARE(m_mock->commands.count("password \"Auth\" \"T0KEN-1\""), 4);
+
+        // The token never reaches the log
+        QVERIFY(logContains("Auth-Token:[redacted]"));
+        QVERIFY(!logContains("T0KEN"));
+    }
+
+    // Another gateway: the token doesn't apply anymore
+    void tokenDroppedOnSwitch() {
+        start();
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        const QByteArray Need(">PASSWORD:Need 'Auth' username/password");
+        QSignalSpy asked(m_openvpn, SIGNAL(authRequested(bool)));
+
+        m_mock->send(Need);
+        QTRY_COMPARE_WITH_TIMEOUT(asked.size(), 1, 5000);
+        m_openvpn->sendCredentials(creds("user", "password"));
+        m_mock->send(">PASSWORD:Auth-Token:T0KEN-2");
+        QTRY_VERIFY_WITH_TIMEOUT(m_mock->commands.contains("password \"Auth\" \"password\""), 5000);
+
+        QVERIFY(m_openvpn->switchConfig(m_openvpn->getConfigPath()));
+        QTRY_VERIFY_WITH_TIMEOUT(m_mock->commands.contains("signal SIGHUP"), 5000);
+        m_mock->send(Need);
+        QTRY_COMPARE_WITH_TIMEOUT(asked.size(), 2, 5000);
+        QCOMPARE(asked[1][0].toBool(), false);
+        QVERIFY(!m_mock->commands.contains("password \"Auth\" \"T0KEN-2\""));
+    }
+};
+
+int main(int argc, char *argv[]) {
+    // Started by OpenVPN as its "openvpn": the management interface is the
+    // mock's, only wait to be killed
+    if (argc > 1 && qstrcmp(argv[1], "--config") == 0) {
+        QThread::sleep(60);
+        return 0;
+    }
+
+    QCoreApplication app(argc, argv);
+    TestManagement test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_management.moc"
@@ -0,0 +1,14 @@
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_mtuprobe
+
+SOURCES += \
+    tst_mtuprobe.cpp \
+    $$SRC/mtuprobe.cpp
+
+HEADERS += \
+    $$SRC/mtuprobe.h
+
+win32: LIBS += -liphlpapi
@@ -0,0 +1,212 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QThread>
+#include <QUdpSocket>
+
+#include "mtuprobe.h"
+
+/*
+ * Stands in for a path with a given MTU: a UDP echo server on 127.0.0.1,
+ * on its own thread. A datagram that would be bigger than the MTU on the
+ * wire (payload + IPv4 + UDP headers, the same 28 bytes as ICMP) gets
+ * "F" back, like a router's fragmentation needed, or nothing at all in
+ * blackHole mode. dropEvery > 0 loses every n-th datagram on top of that.
+ */
+class PathStandIn : public QObject
+{
+    Q_OBJECT
+public:
+    PathStandIn()
+        : mtu(1500)
+        , blackHole(false)
+        , dropEvery(0)
+        , port(0)
+        , received(0)
+        , m_socket(this)
+    {
+        connect(&m_socket, SIGNAL(readyRead()), this, SLOT(readyRead()));
+    }
+
+    // Set before listen(), read from another thread after a blocking call
+    int mtu;
+    bool blackHole;
+    int dropEvery;
+    quint16 port;
+    int received;
+
+public slots:
+    void listen() {
+        received = 0;
+        port = m_socket.bind(QHostAddress::LocalHost, 0) ? m_socket.localPort() : 0;
+    }
+
+    void close() {
+        m_socket.close();
+    }
+
+private slots:
+    void readyRead() {
+        while (m_socket.hasPendingDatagrams()) {
+            QByteArray datagram;
+            QHostAddress address;
+            quint16 from;
+            datagram.resize(static_cast<int>(m_socket.pendingDatagramSize()));
+            m_socket.readDatagram(datagram.data(), datagram.size(), &address, &from);
+            received++;
+
+            if (dropEvery > 0 && received % dropEvery == 0) {
+                continue;
+            }
+            if (datagram.size() + MtuProbe::Overhead <= mtu) {
+                m_socket.writeDatagram(datagram, address, from);
+            } else if (!blackHole) {
+                m_socket.writeDatagram(QByteArray("F"), address, from);
+            }
+        }
+    }
+
+private:
+    QUdpSocket m_socket;
+};
+
+class TestMtuProbe : public QObject
+{
+    Q_OBJECT
+
+private:
+    enum {
+        // Shorter than the real EchoTimeout, it's all on loopback
+        Timeout = 150,
+    };
+
+    QThread m_thread;
+    PathStandIn *m_standIn;
+
+    void listen(int mtu, bool blackHole, int dropEvery = 0) {
+        m_standIn->mtu = mtu;
+        m_standIn->blackHole = blackHole;
+        m_standIn->dropEvery = dropEvery;
+        QMetaObject::invokeMethod(m_standIn, "listen", Qt::BlockingQueuedConnection);
+        QVERIFY(m_standIn->port != 0);
+    }
+
+    int received() {
+        QMetaObject::invokeMethod(m_standIn, "close", Qt::BlockingQueuedConnection);
+        return m_standIn->received;
+    }
+
+    // An echo of that size on the wire, through the stand-in
+    MtuProbe::Result echo(QUdpSocket &socket, int size) {
+        QByteArray payload(size - MtuProbe::Overhead, 'x');
+        socket.writeDatagram(payload, QHostAddress::LocalHost, m_standIn->port);
+        if (!socket.waitForReadyRead(Timeout)) {
+            return MtuProbe::Lost;
+        }
+        QByteArray reply(static_cast<int>(socket.pendingDatagramSize()), 0);
+        socket.readDatagram(reply.data(), reply.size());
+        return reply == payload ? MtuProbe::Fits : MtuProbe::TooBig;
+    }
+
+    int search(int *rtt = nullptr) {
+        QUdpSocket socket;
+        socket.bind(QHostAddress::LocalHost, 0);
+        return MtuProbe::search([this, &socket](int size) {
+            return echo(socket, size);
+        }, rtt);
+    }
+
+private slots:
+    void init() {
+        m_standIn = new PathStandIn;
+        m_standIn->moveToThread(&m_thread);
+        m_thread.start();
+    }
+
+    void cleanup() {
+        QMetaObject::invokeMethod(m_standIn, "close", Qt::BlockingQueuedConnection);
+        m_thread.quit();
+        m_thread.wait();
+        delete m_standIn;
+    }
+
+    void finds_data() {
+        QTest::addColumn<int>("mtu");
+        QTest::addColumn<bool>("blackHole");
+
+        QList<int> mtus;
+        mtus << 1500 << 1492 << 1420 << 1400 << 1280 << 1000 << 600 << 576;
+        for (int mtu : mtus) {
+            QTest::newRow(qPrintable(QString("%1 too big").arg(mtu))) << mtu << false;
+            QTest::newRow(qPrintable(QString("%1 black hole").arg(mtu))) << mtu << true;
+        }
+    }
+
+    // Never above the path's MTU, never more than Precision below it
+    void finds() {
+        QFETCH(int, mtu);
+        QFETCH(bool, blackHole);
+        listen(mtu, blackHole);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+
+        int rtt = -1;
+        int found = search(&rtt);
+        QVERIFY2(found <= mtu, qPrintable(QString::number(found)));
+        QVERIFY2(found > mtu - MtuProbe::Precision || found == MtuProbe::MinMtu,
+                 qPrintable(QString::number(found)));
+        if (mtu == MtuProbe::MaxMtu) {
+            QCOMPARE(found, static_cast<int>(MtuProbe::MaxMtu));
+        }
+        QVERIFY(rtt >= 0 && rtt < Timeout);
+
+        // MinMtu, MaxMtu, then log2(924 / 8) rounded up, lost ones retried
+        int echos = received();
+        QVERIFY2(echos <= 1 + 8 * (blackHole ? MtuProbe::Attempts : 1),
+                 qPrintable(QString::number(echos)));
+    }
+
+    void belowMinimum() {
+        listen(MtuProbe::MinMtu - 1, true);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        QCOMPARE(search(), 0);
+    }
+
+    void noAnswer() {
+        listen(MtuProbe::MaxMtu, false);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        QMetaObject::invokeMethod(m_standIn, "close", Qt::BlockingQueuedConnection);
+        QCOMPARE(search(), 0);
+    }
+
+    // One lost echo in a row isn't taken for a black hole
+    void lossyPath() {
+        listen(1400, false, MtuProbe::Attempts);
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+        int found = search();
+        QVERIFY2(found <= 1400 && found > 1400 - MtuProbe::Precision,
+                 qPrintable(QString::number(found)));
+    }
+
+    // The real thing, where ICMP sockets are allowed: loopback has a
+    // bigger MTU than anything probed
+    void loopback() {
+        if (MtuProbe::echo("127.0.0.1", MtuProbe::MinMtu) == MtuProbe::Unavailable) {
+            QSKIP("ICMP echo not allowed here (net.ipv4.ping_group_range)");
+        }
+        QElapsedTimer timer;
+        timer.start();
+        QCOMPARE(MtuProbe::probe("127.0.0.1"), static_cast<int>(MtuProbe::MaxMtu));
+        QVERIFY(timer.elapsed() < MtuProbe::EchoTimeout);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestMtuProbe)
+#include "tst_mtuprobe.moc"
@@ -0,0 +1,20 @@
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_openvpnio
+
+SOURCES += \
+    tst_openvpnio.cpp \
+    $$SRC/openvpnio.cpp \
+    $$SRC/securebuffer.cpp
+
+HEADERS += \
+    $$SRC/openvpnio.h \
+    $$SRC/securebuffer.h \
+    $$SRC/spscqueue.h
+
+# Crypto++
+LIBPATH += C:/CryptoPP/release
+INCLUDEPATH += C:/CryptoPP/include
+LIBS += -lcryptopp
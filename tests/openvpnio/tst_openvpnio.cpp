@@ -0,0 +1,228 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#include "openvpnio.h"
+
+/*
+ * Stands in for openvpn's management interface, on its own thread so it
+ * keeps going while the test's main thread is busy.
+ * Every millisecond, a ">LOG:" notification with the time it was sent.
+ * Every "ping <time>" command received is timed the same way.
+ * Times are OpenVPNEvent::now(), the same clock on every thread.
+ */
+class ManagementStandIn : public QObject
+{
+    Q_OBJECT
+public:
+    ManagementStandIn()
+        : port(0)
+        , sent(0)
+        , pings(0)
+        , pingLatencyMax(0)
+        , m_server(this)
+        , m_client(nullptr)
+        , m_timer(this)
+    {
+        m_timer.setTimerType(Qt::PreciseTimer);
+        m_timer.setInterval(1);
+        connect(&m_timer, SIGNAL(timeout()), this, SLOT(tick()));
+        connect(&m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    }
+
+    // Only read from another thread after a blocking call
+    quint16 port;
+    int sent;
+    int pings;
+    qint64 pingLatencyMax;
+
+public slots:
+    void listen() {
+        m_server.listen(QHostAddress::LocalHost, 0);
+        port = m_server.serverPort();
+    }
+
+    void startNotifications() {
+        m_timer.start();
+    }
+
+    void stopNotifications() {
+        m_timer.stop();
+        if (m_client) {
+            m_client->flush();
+        }
+    }
+
+    void close() {
+        m_timer.stop();
+        delete m_client;
+        m_client = nullptr;
+        m_server.close();
+    }
+
+private slots:
+    void newConnection() {
+        m_client = m_server.nextPendingConnection();
+        connect(m_client, SIGNAL(readyRead()), this, SLOT(readyRead()));
+        m_client->write(">INFO:OpenVPN Management Interface Version 1 -- type 'help' for more info\r\n");
+    }
+
+    void tick() {
+        if (!m_client) {
+            return;
+        }
+        m_client->write(QString(">LOG:%1,,notification %2\r\n")
+                        .arg(OpenVPNEvent::now()).arg(sent).toLatin1());
+        sent++;
+    }
+
+    void readyRead() {
+        while (m_client->canReadLine()) {
+            QByteArray line(m_client->readLine().trimmed());
+            if (line.startsWith("ping ")) {
+                qint64 latency = OpenVPNEvent::now() - line.mid(5).toLongLong();
+                pingLatencyMax = qMax(pingLatencyMax, latency);
+                pings++;
+            }
+        }
+    }
+
+private:
+    QTcpServer m_server;
+    QTcpSocket *m_client;
+    QTimer m_timer;
+};
+
+class TestOpenVPNIO : public QObject
+{
+    Q_OBJECT
+
+private:
+    QThread m_ioThread;
+    OpenVPNIO *m_io;
+    QThread m_standInThread;
+    ManagementStandIn *m_standIn;
+
+    // Polls without running the event loop, like a busy thread would
+    bool waitForEvent(OpenVPNEvent::Type type, int timeout) {
+        QElapsedTimer timer;
+        timer.start();
+        OpenVPNEvent event;
+        while (timer.elapsed() < timeout) {
+            if (!m_io->takeEvent(event)) {
+                QThread::msleep(1);
+            } else if (event.type == type) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int pingCount() {
+        // Blocking: what the stand-in's thread wrote is visible after it
+        QMetaObject::invokeMethod(m_standIn, "stopNotifications", Qt::BlockingQueuedConnection);
+        return m_standIn->pings;
+    }
+
+private slots:
+    void init() {
+        m_io = new OpenVPNIO;
+        m_io->moveToThread(&m_ioThread);
+        m_ioThread.start();
+
+        m_standIn = new ManagementStandIn;
+        m_standIn->moveToThread(&m_standInThread);
+        m_standInThread.start();
+        QMetaObject::invokeMethod(m_standIn, "listen", Qt::BlockingQueuedConnection);
+        QVERIFY(m_standIn->port != 0);
+
+        OpenVPNCommand connect(OpenVPNCommand::MgmtConnect);
+        connect.host = "127.0.0.1";
+        connect.port = m_standIn->port;
+        m_io->sendCommand(connect);
+        QVERIFY(waitForEvent(OpenVPNEvent::MgmtConnected, 5000));
+    }
+
+    void cleanup() {
+        QMetaObject::invokeMethod(m_io, "shutdown", Qt::BlockingQueuedConnection);
+        m_ioThread.quit();
+        m_ioThread.wait();
+        delete m_io;
+
+        QMetaObject::invokeMethod(m_standIn, "close", Qt::BlockingQueuedConnection);
+        m_standInThread.quit();
+        m_standInThread.wait();
+        delete m_standIn;
+    }
+
+    /*
+     * The main thread is kept busy (think a long repaint or a modal
+     * dialog's own work) without running its event loop. Meanwhile the
+     * I/O thread must still read every notification as it comes, and
+     * the commands sent from the busy thread must still go out right away.
+     */
+    void busyMainThread() {
+        const int BusyMs = 1000;
+        const qint64 MaxLatencyUs = 100 * 1000;
+
+        QMetaObject::invokeMethod(m_standIn, "startNotifications", Qt::QueuedConnection);
+
+        QElapsedTimer busy;
+        busy.start();
+        QElapsedTimer lastPing;
+        lastPing.start();
+        int pings = 0;
+        volatile quint64 work = 0;
+        while (busy.elapsed() < BusyMs) {
+            for (int i=0; i<10000; ++i) {
+                work = work * 31 + i;
+            }
+            if (lastPing.elapsed() >= 10) {
+                OpenVPNCommand ping(OpenVPNCommand::MgmtWrite);
+                ping.data = "ping " + QByteArray::number(OpenVPNEvent::now()) + "\n";
+                m_io->sendCommand(ping);
+                pings++;
+                lastPing.restart();
+            }
+        }
+
+        QMetaObject::invokeMethod(m_standIn, "stopNotifications", Qt::BlockingQueuedConnection);
+        int sent = m_standIn->sent;
+        QVERIFY(sent > BusyMs / 10);
+
+        // Only now is anything taken from the queue: each event carries
+        // the time the I/O thread read it
+        QElapsedTimer timer;
+        timer.start();
+        int received = 0;
+        qint64 latencyMax = 0;
+        OpenVPNEvent event;
+        while (received < sent && timer.elapsed() < 5000) {
+            if (!m_io->takeEvent(event)) {
+                QThread::msleep(1);
+                continue;
+            }
+            if (event.type != OpenVPNEvent::MgmtLine || !event.text.startsWith(">LOG:")) {
+                continue;
+            }
+            QString time(event.text.mid(5).section(',', 0, 0));
+            QCOMPARE(event.text.section(' ', 1).toInt(), received);
+            latencyMax = qMax(latencyMax, event.time - time.toLongLong());
+            received++;
+        }
+        QCOMPARE(received, sent);
+        qDebug() << sent << "notifications, read at most" << latencyMax << "us after being sent";
+        QVERIFY(latencyMax < MaxLatencyUs);
+
+        QTRY_COMPARE_WITH_TIMEOUT(pingCount(), pings, 5000);
+        qDebug() << pings << "commands, received at most" << m_standIn->pingLatencyMax << "us after being sent";
+        QVERIFY(m_standIn->pingLatencyMax < MaxLatencyUs);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestOpenVPNIO)
+
+#include "tst_openvpnio.moc"
@@ -0,0 +1,17 @@
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_protocolprobe
+
+SOURCES += \
+    tst_protocolprobe.cpp \
+    $$SRC/protocolprobe.cpp
+
+HEADERS += \
+    $$SRC/protocolprobe.h
+
+# Crypto++
+LIBPATH += C:/CryptoPP/release
+INCLUDEPATH += C:/CryptoPP/include
+LIBS += -lcryptopp
@@ -0,0 +1,172 @@
+#include <QtTest>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QUdpSocket>
+
+#include "protocolprobe.h"
+
+// Stands in for an openvpn server on UDP: answers every packet, with a
+// server hard reset or with garbage
+class UdpServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit UdpServer(bool reset = true)
+        : m_reset(reset)
+        , received(0)
+    {
+        m_socket.bind(QHostAddress::LocalHost, 0);
+        connect(&m_socket, SIGNAL(readyRead()), this, SLOT(readyRead()));
+    }
+
+    quint16 port() const {
+        return m_socket.localPort();
+    }
+
+    int received;
+
+private slots:
+    void readyRead() {
+        while (m_socket.hasPendingDatagrams()) {
+            QByteArray packet(static_cast<int>(m_socket.pendingDatagramSize()), '\0');
+            QHostAddress from;
+            quint16 fromPort;
+            m_socket.readDatagram(packet.data(), packet.size(), &from, &fromPort);
+            received++;
+
+            QByteArray reply(26, '\0');
+            reply[0] = char((m_reset ? 8 : 4) << 3);
+            m_socket.writeDatagram(reply, from, fromPort);
+        }
+    }
+
+private:
+    QUdpSocket m_socket;
+    bool m_reset;
+};
+
+static ProtocolProbe::Target target(const QString &protocol, quint16 port, bool udp) {
+    ProtocolProbe::Target t;
+    t.protocol = protocol;
+    t.port = port;
+    t.udp = udp;
+    return t;
+}
+
+// A local port nothing listens on
+static quint16 closedTcpPort() {
+    QTcpServer server;
+    server.listen(QHostAddress::LocalHost, 0);
+    return server.serverPort();
+}
+
+class TestProtocolProbe : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Run a probe to 127.0.0.1, returns (order, winner)
+    QList<QVariant> probe(const QList<ProtocolProbe::Target> &targets) {
+        ProtocolProbe probe("127.0.0.1", targets);
+        QSignalSpy spy(&probe, SIGNAL(finished(QStringList,QString)));
+        probe.start();
+        if (!spy.wait(ProtocolProbe::Timeout + 2000)) {
+            return QList<QVariant>();
+        }
+        return spy.takeFirst();
+    }
+
+private slots:
+    void packets() {
+        QByteArray reset(ProtocolProbe::clientResetPacket());
+        QCOMPARE(reset.size(), 14);
+        QCOMPARE(static_cast<quint8>(reset[0]) >> 3, 7);
+        // Random session id
+        QVERIFY(reset.mid(1, 8) != ProtocolProbe::clientResetPacket().mid(1, 8));
+
+        QVERIFY(!ProtocolProbe::isServerReset(reset));
+        QVERIFY(!ProtocolProbe::isServerReset(QByteArray()));
+        QVERIFY(ProtocolProbe::isServerReset(QByteArray(1, char(8 << 3))));
+        // Key id in the low bits
+        QVERIFY(ProtocolProbe::isServerReset(QByteArray(1, char((8 << 3) | 2))));
+    }
+
+    void udpAnswers() {
+        UdpServer server;
+        QList<ProtocolProbe::Target> targets;
+        targets << target("udp", server.port(), true)
+                << target("tcp", closedTcpPort(), false);
+
+        QList<QVariant> result(probe(targets));
+        QCOMPARE(result.size(), 2);
+        QCOMPARE(result[0].toStringList(), QStringList() << "udp" << "tcp");
+        QCOMPARE(result[1].toString(), QString("udp"));
+        QVERIFY(server.received >= 1);
+    }
+
+    // UDP blocked (nothing answers): TCP first, UDP kept as a fallback
+    void udpBlocked() {
+        QUdpSocket silent;
+        QVERIFY(silent.bind(QHostAddress::LocalHost, 0));
+        QTcpServer tcp;
+        QVERIFY(tcp.listen(QHostAddress::LocalHost, 0));
+
+        QList<ProtocolProbe::Target> targets;
+        targets << target("udp", silent.localPort(), true)
+                << target("tcp", tcp.serverPort(), false);
+
+        QList<QVariant> result(probe(targets));
+        QCOMPARE(result.size(), 2);
+        QCOMPARE(result[0].toStringList(), QStringList() << "tcp" << "udp");
+        QCOMPARE(result[1].toString(), QString("tcp"));
+    }
+
+    // Something that isn't an openvpn server on that port
+    void udpWrongAnswer() {
+        UdpServer server(false);
+        QTcpServer tcp;
+        QVERIFY(tcp.listen(QHostAddress::LocalHost, 0));
+
+        QList<ProtocolProbe::Target> targets;
+        targets << target("udp", server.port(), true)
+                << target("tcp", tcp.serverPort(), false);
+
+        QList<QVariant> result(probe(targets));
+        QCOMPARE(result.size(), 2);
+        QCOMPARE(result[1].toString(), QString("tcp"));
+        QVERIFY(server.received >= 1);
+    }
+
+    // The first protocol given wins when both answer
+    void preference() {
+        UdpServer server;
+        QTcpServer tcp;
+        QVERIFY(tcp.listen(QHostAddress::LocalHost, 0));
+
+        QList<ProtocolProbe::Target> targets;
+        targets << target("udp", server.port(), true)
+                << target("tcp", tcp.serverPort(), false);
+        QCOMPARE(probe(targets)[1].toString(), QString("udp"));
+
+        targets.swap(0, 1);
+        QCOMPARE(probe(targets)[1].toString(), QString("tcp"));
+    }
+
+    void nothingAnswers() {
+        QUdpSocket silent;
+        QVERIFY(silent.bind(QHostAddress::LocalHost, 0));
+
+        QList<ProtocolProbe::Target> targets;
+        targets << target("udp", silent.localPort(), true)
+                << target("tcp", closedTcpPort(), false);
+
+        QList<QVariant> result(probe(targets));
+        QCOMPARE(result.size(), 2);
+        QCOMPARE(result[0].toStringList(), QStringList() << "udp" << "tcp");
+        QVERIFY(result[1].toString().isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestProtocolProbe)
+
+#include "tst_protocolprobe.moc"
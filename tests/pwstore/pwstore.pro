@@ -0,0 +1,20 @@
+include(../tests.pri)
+
+# QNetworkInterface, for the fingerprint
+QT += network
+
+TARGET = tst_pwstore
+
+SOURCES += \
+    tst_pwstore.cpp \
+    $$SRC/pwstore.cpp \
+    $$SRC/securebuffer.cpp
+
+HEADERS += \
+    $$SRC/pwstore.h \
+    $$SRC/securebuffer.h
+
+# Crypto++
+LIBPATH += C:/CryptoPP/release
+INCLUDEPATH += C:/CryptoPP/include
+LIBS += -lcryptopp
@@ -0,0 +1,128 @@
+#include <QtTest>
+#include <QElapsedTimer>
+
+#include <string>
+#include <cryptopp/aes.h>
+#include <cryptopp/filters.h>
+#include <cryptopp/gcm.h>
+#include <cryptopp/osrng.h>
+
+#include "pwstore.h"
+
+// From pwstore.cpp, this platform's fingerprint
+QByteArray fingerprintInputs();
+QByteArray legacyFingerprint(const QByteArray &inputs);
+
+static SecureBuffer secret(const QByteArray &s) {
+    return SecureBuffer(s.constData(), s.size());
+}
+
+static QByteArray toByteArray(const SecureBuffer &s) {
+    return QByteArray(s.constData(), s.size());
+}
+
+// What a version with the SHA1 key saved
+static QByteArray legacyEncrypt(const QByteArray &plaintext) {
+    QByteArray key(legacyFingerprint(fingerprintInputs()).left(16));
+    QByteArray iv(16, '\0');
+    CryptoPP::OS_GenerateRandomBlock(false, reinterpret_cast<byte *>(iv.data()), iv.size());
+
+    CryptoPP::GCM<CryptoPP::AES>::Encryption enc;
+    enc.SetKeyWithIV(reinterpret_cast<const byte *>(key.constData()), key.size(),
+                     reinterpret_cast<const byte *>(iv.constData()), iv.size());
+    std::string ciphertext;
+    CryptoPP::AuthenticatedEncryptionFilter aef(enc, new CryptoPP::StringSink(ciphertext));
+    aef.Put(reinterpret_cast<const byte *>(plaintext.constData()), plaintext.size());
+    aef.MessageEnd();
+    return iv + QByteArray(ciphertext.data(), static_cast<int>(ciphertext.size()));
+}
+
+class TestPwStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // The first PwStore derives the key, once for the whole process
+    void initTestCase() {
+        QElapsedTimer timer;
+        timer.start();
+        PwStore store;
+        qDebug() << "First key derivation:" << timer.elapsed() << "ms";
+    }
+
+    void roundTrip() {
+        QByteArray saved(PwStore().encrypt(secret("user\npa ss\xc3\xa9")));
+        bool legacy = true;
+        QCOMPARE(toByteArray(PwStore().decrypt(saved, &legacy)), QByteArray("user\npa ss\xc3\xa9"));
+        QVERIFY(!legacy);
+    }
+
+    // A random IV every time
+    void freshIv() {
+        PwStore store;
+        QVERIFY(store.encrypt(secret("same")) != store.encrypt(secret("same")));
+    }
+
+    void tampered() {
+        QByteArray saved(PwStore().encrypt(secret("password")));
+        saved[saved.size() - 1] = static_cast<char>(saved[saved.size() - 1] ^ 1);
+        QVERIFY(PwStore().decrypt(saved).isEmpty());
+        QVERIFY(PwStore().decrypt(QByteArray("short")).isEmpty());
+    }
+
+    // Still readable, and flagged to be saved again with the new key
+    void legacyKey() {
+        bool legacy = false;
+        SecureBuffer plaintext(PwStore().decrypt(legacyEncrypt("old password"), &legacy));
+        QCOMPARE(toByteArray(plaintext), QByteArray("old password"));
+        QVERIFY(legacy);
+    }
+
+    /*
+     * The auth path (every prompt and reconnect reads the saved
+     * credentials), before: fingerprint and 1000 rounds of SHA1 for every
+     * PwStore. After: the key cached for the process.
+     */
+    void authPathBefore() {
+        QByteArray saved(legacyEncrypt("password"));
+        QBENCHMARK {
+            QByteArray key(legacyFingerprint(fingerprintInputs()).left(16));
+            QVERIFY(!key.isEmpty());
+            QVERIFY(!PwStore().decrypt(saved).isEmpty());
+        }
+    }
+
+    void authPathAfter() {
+        QByteArray saved(PwStore().encrypt(secret("password")));
+        QBENCHMARK {
+            QVERIFY(!PwStore().decrypt(saved).isEmpty());
+        }
+    }
+
+    void cachedIsFaster() {
+        const int Runs = 50;
+        QByteArray legacySaved(legacyEncrypt("password"));
+        QByteArray saved(PwStore().encrypt(secret("password")));
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i=0; i<Runs; ++i) {
+            legacyFingerprint(fingerprintInputs());
+            PwStore().decrypt(legacySaved);
+        }
+        qint64 before = timer.nsecsElapsed();
+
+        timer.restart();
+        for (int i=0; i<Runs; ++i) {
+            PwStore().decrypt(saved);
+        }
+        qint64 after = timer.nsecsElapsed();
+
+        qDebug() << "Auth path:" << before / Runs / 1000 << "us before," << after / Runs / 1000 << "us after";
+        QVERIFY(after < before);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPwStore)
+
+#include "tst_pwstore.moc"
@@ -0,0 +1,29 @@
+include(../tests.pri)
+
+# OpenVPN's status strings come from QApplication::tr()
+QT += network widgets
+
+TARGET = tst_reconnector
+
+SOURCES += \
+    tst_reconnector.cpp \
+    $$SRC/reconnector.cpp \
+    $$SRC/netwatch.cpp \
+    $$SRC/openvpn.cpp \
+    $$SRC/openvpnio.cpp \
+    $$SRC/logentry.cpp \
+    $$SRC/securebuffer.cpp
+
+HEADERS += \
+    $$SRC/reconnector.h \
+    $$SRC/netwatch.h \
+    $$SRC/openvpn.h \
+    $$SRC/openvpnio.h \
+    $$SRC/logentry.h \
+    $$SRC/securebuffer.h \
+    $$SRC/spscqueue.h
+
+# Crypto++
+LIBPATH += C:/CryptoPP/release
+INCLUDEPATH += C:/CryptoPP/include
+LIBS += -lcryptopp
@@ -0,0 +1,196 @@
+#include <QtTest>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegularExpression>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QThread>
+#include <cstdio>
+
+#include "reconnector.h"
+
+/*
+ * The openvpn started by OpenVPN is this program again (see main()), run
+ * by the script in its config file, one line per run:
+ *   "up <ms>"  connects, then exits with an error after that long
+ *   "fail"     exits with an error right away, never connected
+ * Past the last line, it connects and stays up until killed. The runs are
+ * counted in "<config>.runs".
+ */
+static int standInOpenVPN(const QString &configPath) {
+    QFile runsFile(configPath + ".runs");
+    int run = 0;
+    if (runsFile.open(QFile::ReadOnly)) {
+        run = runsFile.readAll().toInt();
+        runsFile.close();
+    }
+    if (runsFile.open(QFile::WriteOnly | QFile::Truncate)) {
+        runsFile.write(QByteArray::number(run + 1));
+        runsFile.close();
+    }
+
+    QStringList script;
+    QFile config(configPath);
+    if (config.open(QFile::ReadOnly | QFile::Text)) {
+        script = QString::fromUtf8(config.readAll()).split('\n', QString::SkipEmptyParts);
+    }
+    QString step(script.value(run));
+
+    if (step == "fail") {
+        printf("Options error: scripted failure\n");
+        fflush(stdout);
+        return 1;
+    }
+
+    printf("Initialization Sequence Completed\n");
+    fflush(stdout);
+    if (step.startsWith("up ")) {
+        QThread::msleep(step.mid(3).toULong());
+        printf("SIGUSR1[soft,ping-restart] received, process restarting\n");
+        fflush(stdout);
+        return 1;
+    }
+    QThread::sleep(60);
+    return 0;
+}
+
+class TestReconnector : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_dir;
+    QString m_configPath;
+    OpenVPN *m_openvpn;
+    NetworkWatcher *m_watcher;
+    Reconnector *m_reconnector;
+
+    void writeScript(const QStringList &steps) {
+        QFile::remove(m_configPath + ".runs");
+        QFile f(m_configPath);
+        QVERIFY(f.open(QFile::WriteOnly | QFile::Truncate | QFile::Text));
+        f.write(steps.join('\n').toUtf8() + "\n");
+    }
+
+    int runs() const {
+        QFile f(m_configPath + ".runs");
+        return f.open(QFile::ReadOnly) ? f.readAll().toInt() : 0;
+    }
+
+    // From Reconnector's "Reconnected after <ms> ms", -1 if not there
+    qint64 outage() const {
+        QRegularExpression re("^# Reconnected after (\\d+) ms$");
+        foreach (const LogEntry &entry, m_openvpn->getLog()) {
+            QRegularExpressionMatch m(re.match(entry.text));
+            if (m.hasMatch()) {
+                return m.captured(1).toLongLong();
+            }
+        }
+        return -1;
+    }
+
+private slots:
+    void init() {
+        m_configPath = m_dir.filePath("standin.ovpn");
+        m_openvpn = new OpenVPN(nullptr, QCoreApplication::applicationFilePath());
+        m_openvpn->setName("standin");
+        m_watcher = new NetworkWatcher;
+        m_reconnector = new Reconnector(*m_openvpn, *m_watcher);
+    }
+
+    void cleanup() {
+        delete m_reconnector;
+        delete m_openvpn;
+        delete m_watcher;
+    }
+
+    // Dropped once connected: back after the first backoff step (0.5 to
+    // 1 s), plus a process start
+    void outageDuration() {
+        writeScript(QStringList() << "up 300");
+        QSignalSpy scheduled(m_reconnector, SIGNAL(reconnectScheduled(int)));
+
+        QVERIFY(m_openvpn->connect(m_configPath));
+        QTRY_COMPARE_WITH_TIMEOUT(scheduled.size(), 1, 5000);
+        int delay = scheduled[0][0].toInt();
+        QVERIFY(delay >= 500 && delay <= 1000);
+
+        QTRY_COMPARE_WITH_TIMEOUT(m_openvpn->getStatus(), OpenVPN::Connected, 5000);
+        QCOMPARE(runs(), 2);
+        QTRY_VERIFY_WITH_TIMEOUT(outage() >= 0, 1000);
+        qDebug() << "Backoff" << delay << "ms, outage" << outage() << "ms";
+        QVERIFY(outage() >= delay);
+        QVERIFY(outage() < delay + 1000);
+    }
+
+    // Every failure in a row waits longer, a connection starts over
+    void backoff() {
+        writeScript(QStringList() << "fail" << "fail" << "up 100");
+        QSignalSpy scheduled(m_reconnector, SIGNAL(reconnectScheduled(int)));
+
+        QVERIFY(m_openvpn->connect(m_configPath));
+        QTRY_COMPARE_WITH_TIMEOUT(scheduled.size(), 4, 15000);
+        QVERIFY(scheduled[0][0].toInt() <= 1000);
+        QVERIFY(scheduled[1][0].toInt() >= 1000 && scheduled[1][0].toInt() <= 2000);
+        QVERIFY(scheduled[2][0].toInt() >= 2000 && scheduled[2][0].toInt() <= 4000);
+        // Was connected in between
+        QVERIFY(scheduled[3][0].toInt() <= 1000);
+    }
+
+    // No waiting for the backoff on a new network
+    void networkChangeSkipsBackoff() {
+        writeScript(QStringList() << "fail");
+        QSignalSpy scheduled(m_reconnector, SIGNAL(reconnectScheduled(int)));
+
+        QVERIFY(m_openvpn->connect(m_configPath));
+        QTRY_COMPARE_WITH_TIMEOUT(scheduled.size(), 1, 5000);
+        QVERIFY(m_reconnector->isPending());
+
+        QElapsedTimer timer;
+        timer.start();
+        emit m_watcher->changed();
+        QVERIFY(!m_reconnector->isPending());
+        QTRY_COMPARE_WITH_TIMEOUT(m_openvpn->getStatus(), OpenVPN::Connected, 5000);
+        QCOMPARE(runs(), 2);
+        qDebug() << "Connected" << timer.elapsed() << "ms after the network change";
+    }
+
+    // Disconnected by the user: stays down
+    void userDisconnect() {
+        writeScript(QStringList());
+        QSignalSpy scheduled(m_reconnector, SIGNAL(reconnectScheduled(int)));
+
+        QVERIFY(m_openvpn->connect(m_configPath));
+        QTRY_COMPARE_WITH_TIMEOUT(m_openvpn->getStatus(), OpenVPN::Connected, 5000);
+        m_openvpn->disconnect();
+        QTRY_COMPARE_WITH_TIMEOUT(m_openvpn->getStatus(), OpenVPN::Disconnected, 5000);
+
+        QTest::qWait(1500);
+        QCOMPARE(scheduled.size(), 0);
+        QCOMPARE(runs(), 1);
+    }
+
+    void disabled() {
+        writeScript(QStringList() << "fail");
+        m_reconnector->setEnabled(false);
+        QSignalSpy scheduled(m_reconnector, SIGNAL(reconnectScheduled(int)));
+
+        QVERIFY(m_openvpn->connect(m_configPath));
+        QTRY_COMPARE_WITH_TIMEOUT(m_openvpn->getStatus(), OpenVPN::Disconnected, 5000);
+        QTest::qWait(1500);
+        QCOMPARE(scheduled.size(), 0);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    if (argc > 2 && qstrcmp(argv[1], "--config") == 0) {
+        return standInOpenVPN(QString::fromLocal8Bit(argv[2]));
+    }
+
+    QCoreApplication app(argc, argv);
+    TestReconnector test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_reconnector.moc"
@@ -0,0 +1,20 @@
+include(../tests.pri)
+
+QT += network
+
+TARGET = tst_securebuffer
+
+SOURCES += \
+    tst_securebuffer.cpp \
+    $$SRC/securebuffer.cpp \
+    $$SRC/openvpnio.cpp
+
+HEADERS += \
+    $$SRC/securebuffer.h \
+    $$SRC/openvpnio.h \
+    $$SRC/spscqueue.h
+
+# Crypto++
+LIBPATH += C:/CryptoPP/release
+INCLUDEPATH += C:/CryptoPP/include
+LIBS += -lcryptopp
@@ -0,0 +1,241 @@
+#include <QtTest>
+#include <QByteArray>
+#include <QString>
+#include <algorithm>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "securebuffer.h"
+#include "openvpnio.h"
+#include "spscqueue.h"
+
+/*
+ * The secrets are random, and only ever kept XORed with Mask here: the
+ * test itself must not leave a copy of what it looks for.
+ */
+static const char Mask = 0x5a;
+
+static bool containsMasked(const char *data, size_t size, const QByteArray &masked) {
+    size_t n = static_cast<size_t>(masked.size());
+    for (size_t i=0; i + n <= size; ++i) {
+        size_t j = 0;
+        while (j < n && char(data[i + j] ^ Mask) == masked[int(j)]) {
+            ++j;
+        }
+        if (j == n) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool canScanMemory() {
+#if defined(_WIN32) || defined(Q_OS_LINUX)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Every readable page of the process, read the way a debugger would
+static bool memoryContains(const QByteArray &masked) {
+    const size_t Chunk = 1024 * 1024;
+    std::vector<char> buffer(Chunk + masked.size());
+    bool found = false;
+
+#ifdef _WIN32
+    HANDLE process = GetCurrentProcess();
+    MEMORY_BASIC_INFORMATION info;
+    char *p = nullptr;
+    while (!found && VirtualQuery(p, &info, sizeof(info)) == sizeof(info)) {
+        char *start = static_cast<char *>(info.BaseAddress);
+        char *end = start + info.RegionSize;
+        DWORD readable = PAGE_READONLY | PAGE_READWRITE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE;
+        if (info.State == MEM_COMMIT && (info.Protect & readable) && !(info.Protect & PAGE_GUARD)) {
+            for (char *at = start; !found && at < end; at += Chunk) {
+                SIZE_T size = qMin<SIZE_T>(end - at, buffer.size());
+                SIZE_T read = 0;
+                if (ReadProcessMemory(process, at, buffer.data(), size, &read)) {
+                    found = containsMasked(buffer.data(), read, masked);
+                }
+            }
+        }
+        p = end;
+    }
+#elif defined(Q_OS_LINUX)
+    QFile maps("/proc/self/maps");
+    int mem = open("/proc/self/mem", O_RDONLY);
+    if (!maps.open(QFile::ReadOnly) || mem == -1) {
+        qFatal("Cannot read /proc/self");
+    }
+    foreach (const QByteArray &line, maps.readAll().split('\n')) {
+        QList<QByteArray> fields(line.simplified().split(' '));
+        if (fields.size() < 5 || !fields[1].startsWith('r')
+            || fields.value(5) == "[vvar]" || fields.value(5) == "[vsyscall]") {
+            continue;
+        }
+        QList<QByteArray> range(fields[0].split('-'));
+        quint64 start = range[0].toULongLong(nullptr, 16);
+        quint64 end = range[1].toULongLong(nullptr, 16);
+        for (quint64 at = start; !found && at < end; at += Chunk) {
+            size_t size = static_cast<size_t>(qMin<quint64>(end - at, buffer.size()));
+            ssize_t read = pread(mem, buffer.data(), size, static_cast<off_t>(at));
+            if (read > 0) {
+                found = containsMasked(buffer.data(), static_cast<size_t>(read), masked);
+            }
+        }
+        if (found) {
+            break;
+        }
+    }
+    close(mem);
+#else
+    Q_UNUSED(masked);
+#endif
+    // What was found must not be found again by the next scan
+    std::fill(buffer.begin(), buffer.end(), 0);
+    return found;
+}
+
+// A random secret of printable ASCII, written straight into a QString:
+// no temporary copy anywhere. Gives the masked UTF-8 and UTF-16 forms.
+static QString makeSecret(int length, QByteArray &utf8, QByteArray &utf16) {
+    QString s(length, Qt::Uninitialized);
+    QChar *c = s.data();
+    utf8.clear();
+    utf16.clear();
+    for (int i=0; i<length; ++i) {
+        char ch = char('!' + qrand() % 94);
+        c[i] = QLatin1Char(ch);
+        utf8.append(char(ch ^ Mask));
+        // Little endian, as on every system this runs on
+        utf16.append(char(ch ^ Mask));
+        utf16.append(char(0 ^ Mask));
+    }
+    return s;
+}
+
+class TestSecureBuffer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {
+        qsrand(static_cast<uint>(QDateTime::currentMSecsSinceEpoch()));
+    }
+
+    void basics() {
+        SecureBuffer b("abc", 3);
+        b.append('d');
+        b.append(SecureBuffer("ef", 2));
+        QCOMPARE(QByteArray(b.constData(), b.size()), QByteArray("abcdef"));
+        QCOMPARE(b.indexOf('d'), 3);
+        QCOMPARE(b.indexOf('z'), -1);
+
+        SecureBuffer mid(b.mid(2, 2));
+        QCOMPARE(QByteArray(mid.constData(), mid.size()), QByteArray("cd"));
+        QVERIFY(b.mid(10).isEmpty());
+
+        // Deep copies
+        SecureBuffer copy(b);
+        b.clear();
+        QVERIFY(b.isEmpty());
+        QCOMPARE(QByteArray(copy.constData(), copy.size()), QByteArray("abcdef"));
+
+        // Growing past a page keeps the content
+        SecureBuffer big;
+        for (int i=0; i<10000; ++i) {
+            big.append(char('a' + i % 26));
+        }
+        QCOMPARE(big.size(), 10000);
+        QCOMPARE(big.constData()[9999], char('a' + 9999 % 26));
+    }
+
+    void takeStringUtf8() {
+        QString s(QString::fromUtf8("p\xc3\xa9 \"x\" \xe2\x82\xac \xf0\x9f\x94\x91"));
+        QByteArray expected(s.toUtf8());
+        SecureBuffer b(SecureBuffer::takeString(s));
+        QVERIFY(s.isEmpty());
+        QCOMPARE(QByteArray(b.constData(), b.size()), expected);
+    }
+
+    // Another QString still uses the data: left alone
+    void sharedStringUntouched() {
+        if (!canScanMemory()) {
+            QSKIP("No memory scan on this system");
+        }
+        QByteArray utf8, utf16;
+        QString a(makeSecret(24, utf8, utf16));
+        QString b(a);
+        secureStringClear(b);
+        QVERIFY(b.isEmpty());
+        QCOMPARE(a.size(), 24);
+        QVERIFY(memoryContains(utf16));
+
+        secureStringClear(a);
+        QVERIFY(!memoryContains(utf16));
+    }
+
+    // The scanner itself: it does find what's there
+    void scannerFindsSecrets() {
+        if (!canScanMemory()) {
+            QSKIP("No memory scan on this system");
+        }
+        QByteArray utf8, utf16;
+        QString s(makeSecret(24, utf8, utf16));
+        QVERIFY(memoryContains(utf16));
+        QVERIFY(!memoryContains(utf8));
+
+        SecureBuffer b(SecureBuffer::takeString(s));
+        QVERIFY(memoryContains(utf8));
+        QVERIFY(!memoryContains(utf16));
+    }
+
+    /*
+     * What a login goes through, from the dialog's strings to the bytes
+     * written on the management socket: takeString(), a credential line
+     * built in locked memory, the command queue to the I/O thread. Once
+     * it's all gone, neither form of the password is left anywhere.
+     */
+    void authCycle() {
+        if (!canScanMemory()) {
+            QSKIP("No memory scan on this system");
+        }
+        QByteArray utf8, utf16;
+        QString input(makeSecret(32, utf8, utf16));
+
+        {
+            SecureBuffer password(SecureBuffer::takeString(input));
+            QVERIFY(!memoryContains(utf16));
+
+            SecureBuffer line;
+            line.append("password \"Auth\" \"", 17);
+            line.append(password);
+            line.append("\"\n", 2);
+
+            SpscQueue<OpenVPNCommand, 4> queue;
+            {
+                OpenVPNCommand write(OpenVPNCommand::MgmtWrite);
+                write.secret = line;
+                QVERIFY(queue.push(write));
+            }
+            OpenVPNCommand taken;
+            QVERIFY(queue.pop(taken));
+            QCOMPARE(taken.secret.size(), line.size());
+            QVERIFY(memoryContains(utf8));
+        }
+
+        QVERIFY(!memoryContains(utf8));
+        QVERIFY(!memoryContains(utf16));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSecureBuffer)
+
+#include "tst_securebuffer.moc"
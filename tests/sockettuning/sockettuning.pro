@@ -0,0 +1,10 @@
+include(../tests.pri)
+
+TARGET = tst_sockettuning
+
+SOURCES += \
+    tst_sockettuning.cpp \
+    $$SRC/sockettuning.cpp
+
+HEADERS += \
+    $$SRC/sockettuning.h
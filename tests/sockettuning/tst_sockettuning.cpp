@@ -0,0 +1,80 @@
+#include <QtTest>
+
+#include "sockettuning.h"
+
+class TestSocketTuning : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // Nothing measured yet: 100 Mbit/s on 50 ms, 625000 bytes in flight
+    void defaults() {
+        SocketTuning t(SocketTuning::choose(true, 0, 0));
+        QCOMPARE(t.sndbuf, 10 * 64 * 1024);
+        QCOMPARE(t.rcvbuf, t.sndbuf);
+#ifdef _WIN32
+        QVERIFY(!t.fastIo);
+        QCOMPARE(t.txqueuelen, 0);
+#else
+        QVERIFY(t.fastIo);
+        QCOMPARE(t.txqueuelen, 625000 / static_cast<int>(SocketTuning::PacketSize));
+#endif
+    }
+
+    void buffers_data() {
+        QTest::addColumn<int>("rtt");
+        QTest::addColumn<qint64>("bandwidth");
+        QTest::addColumn<int>("buffer");
+
+        // Never below openvpn's own default
+        QTest::newRow("LAN") << 1 << Q_INT64_C(1000000) << static_cast<int>(SocketTuning::MinBuffer);
+        // The peak is doubled: 2 * 50 MB/s * 100 ms = 10 MB, capped
+        QTest::newRow("fast, far") << 100 << Q_INT64_C(50000000) << static_cast<int>(SocketTuning::MaxBuffer);
+        // 2 * 20 MB/s * 30 ms = 1200000, rounded up to 64K steps
+        QTest::newRow("fast, near") << 30 << Q_INT64_C(20000000) << 19 * 64 * 1024;
+        // Slower than the default bandwidth, which is kept: 12.5 MB/s * 200 ms
+        QTest::newRow("slow, far") << 200 << Q_INT64_C(100000) << 39 * 64 * 1024;
+    }
+
+    void buffers() {
+        QFETCH(int, rtt);
+        QFETCH(qint64, bandwidth);
+        QFETCH(int, buffer);
+
+        SocketTuning t(SocketTuning::choose(true, rtt, bandwidth));
+        QCOMPARE(t.sndbuf, buffer);
+        QCOMPARE(t.rcvbuf, buffer);
+        QCOMPARE(t.sndbuf % static_cast<int>(SocketTuning::BufferStep), 0);
+    }
+
+    void tcp() {
+        SocketTuning t(SocketTuning::choose(false, 0, 0));
+        QVERIFY(!t.fastIo);
+        QCOMPARE(t.sndbuf, SocketTuning::choose(true, 0, 0).sndbuf);
+    }
+
+    void txqueuelenBounds() {
+#ifdef _WIN32
+        QSKIP("No txqueuelen for openvpn on Windows");
+#else
+        QCOMPARE(SocketTuning::choose(true, 1, 0).txqueuelen, static_cast<int>(SocketTuning::MinTxQueueLen));
+        QCOMPARE(SocketTuning::choose(true, 1000, Q_INT64_C(1000000000)).txqueuelen,
+                 static_cast<int>(SocketTuning::MaxTxQueueLen));
+#endif
+    }
+
+    void toString() {
+        SocketTuning t;
+        t.sndbuf = t.rcvbuf = 65536;
+        t.fastIo = true;
+        t.txqueuelen = 0;
+        QCOMPARE(t.toString(), QString("sndbuf 65536, rcvbuf 65536, fast-io"));
+        t.fastIo = false;
+        t.txqueuelen = 500;
+        QCOMPARE(t.toString(), QString("sndbuf 65536, rcvbuf 65536, txqueuelen 500"));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestSocketTuning)
+
+#include "tst_sockettuning.moc"
@@ -0,0 +1,9 @@
+include(../tests.pri)
+
+TARGET = tst_spscqueue
+
+SOURCES += \
+    tst_spscqueue.cpp
+
+HEADERS += \
+    $$SRC/spscqueue.h
@@ -0,0 +1,139 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QString>
+#include <QThread>
+
+#include "spscqueue.h"
+
+// Pushes count items in order, waiting whenever the queue is full
+template <typename Queue, typename Make>
+class Producer : public QThread
+{
+public:
+    Producer(Queue &queue, int count, Make make)
+        : m_queue(queue)
+        , m_count(count)
+        , m_make(make)
+    {}
+
+protected:
+    void run() override {
+        for (int i=0; i<m_count; ) {
+            if (m_queue.push(m_make(i))) {
+                ++i;
+            } else {
+                QThread::yieldCurrentThread();
+            }
+        }
+    }
+
+private:
+    Queue &m_queue;
+    int m_count;
+    Make m_make;
+};
+
+class TestSpscQueue : public QObject
+{
+    Q_OBJECT
+
+private:
+    // Consume everything on this thread, in order, nothing lost or doubled
+    template <typename T, int Capacity, typename Make>
+    void stress(int count, Make make) {
+        typedef SpscQueue<T, Capacity> Queue;
+        Queue queue;
+        Producer<Queue, Make> producer(queue, count, make);
+        producer.start();
+
+        QElapsedTimer timer;
+        timer.start();
+        int next = 0;
+        bool ordered = true;
+        T item;
+        while (next < count && ordered && timer.elapsed() < 60000) {
+            if (!queue.pop(item)) {
+                QThread::yieldCurrentThread();
+                continue;
+            }
+            ordered = item == make(next);
+            ++next;
+        }
+
+        // Let the producer finish whatever happened, it's waiting on us
+        while (!producer.isFinished()) {
+            queue.pop(item);
+        }
+        producer.wait();
+
+        QVERIFY2(ordered, qPrintable(QString("item %1 out of order").arg(next - 1)));
+        QCOMPARE(next, count);
+        QVERIFY(!queue.pop(item));
+    }
+
+private slots:
+    void emptyAndFull() {
+        SpscQueue<int, 8> queue;
+        int item = -1;
+        QVERIFY(!queue.pop(item));
+
+        // One slot is always kept free
+        for (int i=0; i<7; ++i) {
+            QVERIFY(queue.push(i));
+        }
+        QVERIFY(!queue.push(7));
+
+        for (int i=0; i<7; ++i) {
+            QVERIFY(queue.pop(item));
+            QCOMPARE(item, i);
+        }
+        QVERIFY(!queue.pop(item));
+    }
+
+    void wrapAround() {
+        SpscQueue<int, 4> queue;
+        int item = -1;
+        for (int round=0; round<100; ++round) {
+            for (int i=0; i<3; ++i) {
+                QVERIFY(queue.push(round * 3 + i));
+            }
+            QVERIFY(!queue.push(-1));
+            for (int i=0; i<3; ++i) {
+                QVERIFY(queue.pop(item));
+                QCOMPARE(item, round * 3 + i);
+            }
+        }
+        QVERIFY(!queue.pop(item));
+    }
+
+    // The popped slot is reset, it doesn't keep a reference
+    void popReleasesItem() {
+        SpscQueue<QString, 4> queue;
+        QString s(QString::number(12345));
+        QVERIFY(queue.push(s));
+        QVERIFY(s.data_ptr()->ref.isShared());
+
+        QString item;
+        QVERIFY(queue.pop(item));
+        item.clear();
+        QVERIFY(!s.data_ptr()->ref.isShared());
+    }
+
+    void stressInts() {
+        stress<int, 1024>(5000000, [](int i) { return i; });
+    }
+
+    // Small queue, always full or empty: most pushes and pops fail
+    void stressSmallQueue() {
+        stress<int, 2>(200000, [](int i) { return i; });
+    }
+
+    // Implicitly shared items, as the I/O thread queues
+    void stressStrings() {
+        stress<QString, 256>(500000, [](int i) { return QString::number(i); });
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSpscQueue)
+
+#include "tst_spscqueue.moc"
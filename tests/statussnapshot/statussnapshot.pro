@@ -0,0 +1,10 @@
+include(../tests.pri)
+
+TARGET = tst_statussnapshot
+
+SOURCES += \
+    tst_statussnapshot.cpp \
+    $$SRC/statussnapshot.cpp
+
+HEADERS += \
+    $$SRC/statussnapshot.h
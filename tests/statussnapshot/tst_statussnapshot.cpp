@@ -0,0 +1,124 @@
+#include <QtTest>
+
+#include "statussnapshot.h"
+
+class TestStatusSnapshot : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // "state" lists the history, the last line is the current state
+    void parseState() {
+        QStringList lines;
+        lines << "1555555000,CONNECTING,,,,,,,"
+              << "1555555555,CONNECTED,SUCCESS,10.8.0.6,1.2.3.4,1194,192.168.1.10,51000,fd00::6";
+
+        StatusSnapshot s;
+        QVERIFY(s.parseState(lines));
+        QCOMPARE(s.localIP, QString("10.8.0.6"));
+        QCOMPARE(s.remoteIP, QString("1.2.3.4"));
+        QCOMPARE(s.remotePort, 1194);
+        QCOMPARE(s.localIPv6, QString("fd00::6"));
+    }
+
+    // Without IPv6 in the tunnel, the previous value isn't touched
+    void parseStateWithoutIPv6() {
+        StatusSnapshot s;
+        s.localIPv6 = "fd00::6";
+        QVERIFY(s.parseState(QStringList("1555555555,CONNECTED,SUCCESS,10.8.0.6,1.2.3.4,443")));
+        QCOMPARE(s.localIP, QString("10.8.0.6"));
+        QCOMPARE(s.remotePort, 443);
+        QCOMPARE(s.localIPv6, QString("fd00::6"));
+    }
+
+    void parseStateInvalid() {
+        StatusSnapshot s;
+        s.localIP = "10.8.0.6";
+        QVERIFY(!s.parseState(QStringList()));
+        QVERIFY(!s.parseState(QStringList("1555555555,CONNECTED,SUCCESS")));
+        QCOMPARE(s.localIP, QString("10.8.0.6"));
+    }
+
+    // "status 3": tab separated
+    void parseStatusTabs() {
+        QStringList lines;
+        lines << "OpenVPN STATISTICS"
+              << "Updated\t2019-04-18 00:00:00"
+              << "TUN/TAP read bytes\t1000"
+              << "TUN/TAP write bytes\t2000"
+              << "TCP/UDP read bytes\t3000"
+              << "TCP/UDP write bytes\t4000"
+              << "Auth read bytes\t5000"
+              << "pre-compress bytes\t600"
+              << "post-compress bytes\t500"
+              << "pre-decompress bytes\t700"
+              << "post-decompress bytes\t900"
+              << "END";
+
+        StatusSnapshot s;
+        QVERIFY(s.parseStatus(lines));
+        QCOMPARE(s.tunRead, Q_INT64_C(1000));
+        QCOMPARE(s.tunWrite, Q_INT64_C(2000));
+        QCOMPARE(s.linkRead, Q_INT64_C(3000));
+        QCOMPARE(s.linkWrite, Q_INT64_C(4000));
+        QCOMPARE(s.preCompress, Q_INT64_C(600));
+        QCOMPARE(s.postCompress, Q_INT64_C(500));
+        QCOMPARE(s.preDecompress, Q_INT64_C(700));
+        QCOMPARE(s.postDecompress, Q_INT64_C(900));
+    }
+
+    // "status"/"status 2" and older versions: comma separated, 64-bit counters
+    void parseStatusCommas() {
+        QStringList lines;
+        lines << "OpenVPN STATISTICS"
+              << "Updated,Thu Apr 18 00:00:00 2019"
+              << "TCP/UDP read bytes,8589934592"
+              << "TCP/UDP write bytes,12";
+
+        StatusSnapshot s;
+        QVERIFY(s.parseStatus(lines));
+        QCOMPARE(s.linkRead, Q_INT64_C(8589934592));
+        QCOMPARE(s.linkWrite, Q_INT64_C(12));
+    }
+
+    // Only what's in the response changes
+    void parseStatusPartial() {
+        StatusSnapshot s;
+        s.tunRead = 42;
+        QVERIFY(s.parseStatus(QStringList("TCP/UDP read bytes\t7")));
+        QCOMPARE(s.linkRead, Q_INT64_C(7));
+        QCOMPARE(s.tunRead, Q_INT64_C(42));
+    }
+
+    void parseStatusNothingKnown() {
+        QStringList lines;
+        lines << "OpenVPN STATISTICS"
+              << "Updated\t2019-04-18 00:00:00"
+              << "TCP/UDP read bytes\tnot a number"
+              << "Unknown counter\t12"
+              << "END";
+
+        StatusSnapshot s;
+        QVERIFY(!s.parseStatus(lines));
+        QCOMPARE(s.linkRead, Q_INT64_C(0));
+    }
+
+    void formatBytes_data() {
+        QTest::addColumn<qint64>("bytes");
+        QTest::addColumn<QString>("text");
+        QTest::newRow("bytes") << Q_INT64_C(512) << QString("512 B");
+        QTest::newRow("KB") << Q_INT64_C(1536) << QString("1.5 KB");
+        QTest::newRow("MB") << Q_INT64_C(1048576) << QString("1.0 MB");
+        QTest::newRow("GB") << Q_INT64_C(2147483648) << QString("2.00 GB");
+    }
+
+    void formatBytes() {
+        QFETCH(qint64, bytes);
+        QFETCH(QString, text);
+        QCOMPARE(::formatBytes(bytes), text);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestStatusSnapshot)
+
+#include "tst_statussnapshot.moc"
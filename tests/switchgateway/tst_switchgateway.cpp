@@ -0,0 +1,170 @@
+#include <QtTest>
+#include <QCoreApplication>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <cstdio>
+
+#include "openvpn.h"
+
+/*
+ * Stands in for openvpn, management interface included: the process
+ * OpenVPN starts is this program again (see main()), with openvpn's
+ * arguments. Like openvpn with --management-hold, it holds at startup
+ * and after every SIGHUP/SIGUSR1 restart, and "connects" (prints
+ * "Initialization Sequence Completed") once released. SIGTERM exits.
+ */
+class StandInOpenVPN : public QObject
+{
+    Q_OBJECT
+public:
+    StandInOpenVPN()
+        : m_server(this)
+        , m_client(nullptr)
+    {
+        connect(&m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    }
+
+    bool listen(const QString &host, quint16 port) {
+        return m_server.listen(QHostAddress(host), port);
+    }
+
+private slots:
+    void newConnection() {
+        m_client = m_server.nextPendingConnection();
+        connect(m_client, SIGNAL(readyRead()), this, SLOT(readyRead()));
+        send(">INFO:OpenVPN Management Interface Version 1 -- type 'help' for more info");
+        send(">HOLD:Waiting for hold release:0");
+    }
+
+    void readyRead() {
+        while (m_client->canReadLine()) {
+            QByteArray command(m_client->readLine().trimmed());
+            if (command == "hold release") {
+                send("SUCCESS: hold release succeeded");
+                printf("Initialization Sequence Completed\n");
+                fflush(stdout);
+            } else if (command == "signal SIGHUP" || command == "signal SIGUSR1") {
+                send("SUCCESS: " + command + " thrown");
+                send(">HOLD:Waiting for hold release:0");
+            } else if (command == "signal SIGTERM") {
+                send("SUCCESS: signal SIGTERM thrown");
+                m_client->flush();
+                QCoreApplication::quit();
+            } else {
+                send("ERROR: unknown command, enter 'help' for more options");
+            }
+        }
+    }
+
+private:
+    void send(const QByteArray &line) {
+        m_client->write(line + "\r\n");
+    }
+
+    QTcpServer m_server;
+    QTcpSocket *m_client;
+};
+
+static int standInOpenVPN(const QStringList &args) {
+    int i = args.indexOf("--management");
+    StandInOpenVPN openvpn;
+    if (i < 0 || !openvpn.listen(args.value(i + 1), static_cast<quint16>(args.value(i + 2).toUInt()))) {
+        printf("Options error: no management port\n");
+        return 1;
+    }
+    return QCoreApplication::exec();
+}
+
+class TestSwitchGateway : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_dir;
+    OpenVPN *m_openvpn;
+    int m_configs;
+
+    // Like VPNCore, a new config file for every connection
+    QString writeConfig() {
+        QString path(m_dir.filePath(QString("gateway%1.ovpn").arg(m_configs++)));
+        QFile f(path);
+        if (f.open(QFile::WriteOnly)) {
+            f.write("remote gw.example.net 1194 udp\n");
+        }
+        return path;
+    }
+
+    bool waitForConnected(QSignalSpy &spy) {
+        return spy.size() > 0 || spy.wait(5000);
+    }
+
+private slots:
+    void init() {
+        m_configs = 0;
+        m_openvpn = new OpenVPN(nullptr, QCoreApplication::applicationFilePath());
+        m_openvpn->setName("standin");
+
+        QSignalSpy connected(m_openvpn, SIGNAL(connected()));
+        QVERIFY(m_openvpn->connect(writeConfig()));
+        QVERIFY(waitForConnected(connected));
+        QTRY_VERIFY_WITH_TIMEOUT(m_openvpn->isManagementReady(), 5000);
+    }
+
+    void cleanup() {
+        m_openvpn->disconnect();
+        QTRY_COMPARE_WITH_TIMEOUT(m_openvpn->getStatus(), OpenVPN::Disconnected, 5000);
+        delete m_openvpn;
+    }
+
+    // The running openvpn re-reads the new config on SIGHUP
+    void switchGateway() {
+        QSignalSpy exited(m_openvpn, SIGNAL(disconnected()));
+        QBENCHMARK {
+            QSignalSpy connected(m_openvpn, SIGNAL(connected()));
+            QVERIFY(m_openvpn->switchConfig(writeConfig()));
+            QVERIFY(waitForConnected(connected));
+        }
+        QCOMPARE(exited.size(), 0);
+        QVERIFY(m_openvpn->getTimings().reconnect);
+    }
+
+    // Same, in a new process: what every switch used to cost
+    void respawn() {
+        QSignalSpy exited(m_openvpn, SIGNAL(disconnected()));
+        int runs = 0;
+        QBENCHMARK {
+            QSignalSpy connected(m_openvpn, SIGNAL(connected()));
+            QVERIFY(m_openvpn->connect(writeConfig()));
+            QVERIFY(waitForConnected(connected));
+            runs++;
+        }
+        QCOMPARE(exited.size(), runs);
+        QVERIFY(!m_openvpn->getTimings().reconnect);
+    }
+
+    // Reconnect to the same gateway, the process kept
+    void restart() {
+        QSignalSpy exited(m_openvpn, SIGNAL(disconnected()));
+        QBENCHMARK {
+            QSignalSpy connected(m_openvpn, SIGNAL(connected()));
+            QVERIFY(m_openvpn->restart());
+            QVERIFY(waitForConnected(connected));
+        }
+        QCOMPARE(exited.size(), 0);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    if (argc > 1 && qstrcmp(argv[1], "--config") == 0) {
+        return standInOpenVPN(app.arguments());
+    }
+
+    TestSwitchGateway test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_switchgateway.moc"
@@ -0,0 +1,10 @@
+# Shared by every test: a Qt Test console app, sources from src/
+QT += testlib
+QT -= gui
+
+TEMPLATE = app
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+SRC = $$PWD/../src
+INCLUDEPATH += $$PWD/.. $$SRC
@@ -0,0 +1,27 @@
+# Unit tests of the parts that don't need a GUI, an openvpn or a network:
+#   qmake tests/tests.pro && make check
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    spscqueue \
+    statussnapshot \
+    logstore \
+    dohresolver \
+    compressionpolicy \
+    sockettuning \
+    logexport \
+    protocolprobe \
+    securebuffer \
+    openvpnio \
+    management \
+    logclassify \
+    addressfamilies \
+    controlclient \
+    reconnector \
+    switchgateway \
+    disconnect \
+    tunnels \
+    diagnostics \
+    pwstore \
+    dnscache \
+    mtuprobe
@@ -0,0 +1,276 @@
+#include <QtTest>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "tunnelmanager.h"
+
+/*
+ * Stands in for openvpn, management interface included: the process
+ * OpenVPN starts is this program again (see main()), with openvpn's
+ * arguments. It connects as soon as the hold is released, exits on
+ * SIGTERM, answers "state" and "status 3" like openvpn, and logs a
+ * ">LOG:" line every LogInterval ms.
+ */
+class StandInOpenVPN : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        LogInterval = 100,
+    };
+
+    StandInOpenVPN()
+        : m_server(this)
+        , m_client(nullptr)
+        , m_bytes(0)
+    {
+        connect(&m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+        m_logTimer.setInterval(LogInterval);
+        connect(&m_logTimer, SIGNAL(timeout()), this, SLOT(log()));
+    }
+
+    bool listen(const QString &host, quint16 port) {
+        return m_server.listen(QHostAddress(host), port);
+    }
+
+private slots:
+    void newConnection() {
+        m_client = m_server.nextPendingConnection();
+        connect(m_client, SIGNAL(readyRead()), this, SLOT(readyRead()));
+        send(">INFO:OpenVPN Management Interface Version 1 -- type 'help' for more info");
+        send(">HOLD:Waiting for hold release:0");
+    }
+
+    void readyRead() {
+        while (m_client->canReadLine()) {
+            QByteArray command(m_client->readLine().trimmed());
+            if (command == "hold release") {
+                send("SUCCESS: hold release succeeded");
+                printf("Initialization Sequence Completed\n");
+                fflush(stdout);
+                m_logTimer.start();
+            } else if (command == "state") {
+                send("1555555555,CONNECTED,SUCCESS,10.8.0.6,192.0.2.1,1194,,,");
+                send("END");
+            } else if (command == "status 3") {
+                m_bytes += 100000;
+                send("OpenVPN STATISTICS");
+                send("Updated\t2019-04-18 06:12:35");
+                send("TCP/UDP read bytes\t" + QByteArray::number(m_bytes));
+                send("TCP/UDP write bytes\t" + QByteArray::number(m_bytes / 10));
+                send("END");
+            } else if (command == "signal SIGTERM") {
+                send("SUCCESS: signal SIGTERM thrown");
+                m_client->flush();
+                QCoreApplication::quit();
+            } else {
+                send("ERROR: unknown command, enter 'help' for more options");
+            }
+        }
+    }
+
+    void log() {
+        send(">LOG:1555555555,,Data Channel: using negotiated cipher 'AES-256-GCM'");
+    }
+
+private:
+    void send(const QByteArray &line) {
+        m_client->write(line + "\r\n");
+    }
+
+    QTcpServer m_server;
+    QTcpSocket *m_client;
+    QTimer m_logTimer;
+    qint64 m_bytes;
+};
+
+static int standInOpenVPN(const QStringList &args) {
+    int i = args.indexOf("--management");
+    StandInOpenVPN openvpn;
+    if (i < 0 || !openvpn.listen(args.value(i + 1), static_cast<quint16>(args.value(i + 2).toUInt()))) {
+        printf("Options error: no management port\n");
+        return 1;
+    }
+    return QCoreApplication::exec();
+}
+
+// User + system time of this process (the stand-ins are others), in ms
+static qint64 cpuTime() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return static_cast<qint64>((k.QuadPart + u.QuadPart) / 10000);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+         + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#endif
+}
+
+// Lines received, by tunnel
+class LogCounter : public QObject
+{
+    Q_OBJECT
+public:
+    QMap<QString, int> lines;
+
+public slots:
+    void logUpdated(const LogEntry &entry) {
+        lines[entry.tunnel]++;
+    }
+};
+
+class TestTunnels : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_dir;
+    TunnelManager *m_tunnels;
+
+    enum {
+        Tunnels = 32,
+    };
+
+    QString writeConfig(int i) {
+        QString path(m_dir.filePath(QString("gw%1.ovpn").arg(i)));
+        QFile f(path);
+        if (f.open(QFile::WriteOnly)) {
+            f.write("remote gw.example.net 1194 udp\n");
+        }
+        return path;
+    }
+
+    int connectedCount() const {
+        int n = 0;
+        foreach (OpenVPN *openvpn, m_tunnels->tunnels()) {
+            n += openvpn->getStatus() == OpenVPN::Connected ? 1 : 0;
+        }
+        return n;
+    }
+
+private slots:
+    void initTestCase() {
+        m_tunnels = new TunnelManager(QCoreApplication::applicationFilePath());
+    }
+
+    void cleanupTestCase() {
+        m_tunnels->disconnectAll();
+        QTRY_COMPARE_WITH_TIMEOUT(m_tunnels->getStatus(), OpenVPN::Disconnected, 10000);
+        delete m_tunnels;
+    }
+
+    // Each with its own process, management port and log
+    void connectAll() {
+        QSignalSpy added(m_tunnels, SIGNAL(tunnelAdded(OpenVPN*)));
+        QElapsedTimer timer;
+        timer.start();
+        for (int i=0; i<Tunnels; ++i) {
+            m_tunnels->connectTunnel(QString("gw%1.example.net").arg(i), writeConfig(i), true, false);
+        }
+        QCOMPARE(m_tunnels->tunnels().size(), static_cast<int>(Tunnels));
+        QCOMPARE(added.size(), Tunnels - 1);
+
+        QTRY_COMPARE_WITH_TIMEOUT(connectedCount(), static_cast<int>(Tunnels), 30000);
+        qDebug() << Tunnels << "tunnels connected in" << timer.elapsed() << "ms";
+
+        QSet<QString> names, ports;
+        foreach (OpenVPN *openvpn, m_tunnels->tunnels()) {
+            names.insert(openvpn->getName());
+            foreach (const LogEntry &entry, openvpn->getLog()) {
+                QCOMPARE(entry.tunnel, openvpn->getName());
+                if (entry.text.startsWith("# Management: ")) {
+                    ports.insert(entry.text);
+                }
+            }
+        }
+        QCOMPARE(names.size(), static_cast<int>(Tunnels));
+        QCOMPARE(ports.size(), static_cast<int>(Tunnels));
+    }
+
+    // A window following one tunnel only gets that tunnel's lines
+    void logFollowsOneTunnel() {
+        if (connectedCount() != Tunnels) {
+            QSKIP("Not connected");
+        }
+        OpenVPN *followed = m_tunnels->tunnels()[Tunnels / 2];
+        LogCounter counter;
+        connect(followed, SIGNAL(logUpdated(LogEntry)), &counter, SLOT(logUpdated(LogEntry)));
+
+        QTest::qWait(20 * StandInOpenVPN::LogInterval);
+        QCOMPARE(counter.lines.keys(), QStringList(followed->getName()));
+        QVERIFY(counter.lines[followed->getName()] >= 10);
+    }
+
+    /*
+     * Steady state: every tunnel logs and is polled every second (as with
+     * its details window open). Our side of it (main thread, every I/O
+     * thread), per tunnel, in percent of a core.
+     */
+    void cpuPerTunnel() {
+        if (connectedCount() != Tunnels) {
+            QSKIP("Not connected");
+        }
+        const int MeasureMs = 5000;
+        const double MaxPercentPerTunnel = 1.0;
+
+        QSignalSpy snapshots(m_tunnels, SIGNAL(snapshotUpdated(OpenVPN*)));
+        foreach (OpenVPN *openvpn, m_tunnels->tunnels()) {
+            m_tunnels->getStatusPoller(openvpn)->setFast(true);
+        }
+        QTest::qWait(1000);
+
+        snapshots.clear();
+        qint64 cpuStart = cpuTime();
+        QElapsedTimer timer;
+        timer.start();
+        QTest::qWait(MeasureMs);
+        double cpu = static_cast<double>(cpuTime() - cpuStart);
+        double percent = cpu * 100 / timer.elapsed() / Tunnels;
+
+        qDebug() << "CPU:" << cpu << "ms in" << timer.elapsed() << "ms,"
+                 << percent << "% of a core per tunnel," << snapshots.size() << "status polls";
+        QVERIFY(snapshots.size() >= Tunnels * (MeasureMs / 1000 - 1));
+        QVERIFY(percent < MaxPercentPerTunnel);
+    }
+
+    // Every tunnel but the primary goes away once stopped
+    void disconnectAll() {
+        QSignalSpy removed(m_tunnels, SIGNAL(tunnelRemoved(OpenVPN*)));
+        m_tunnels->disconnectAll();
+        QTRY_COMPARE_WITH_TIMEOUT(m_tunnels->getStatus(), OpenVPN::Disconnected, 10000);
+        QTRY_COMPARE_WITH_TIMEOUT(removed.size(), Tunnels - 1, 5000);
+        QCOMPARE(m_tunnels->tunnels().size(), 1);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    if (argc > 1 && qstrcmp(argv[1], "--config") == 0) {
+        return standInOpenVPN(app.arguments());
+    }
+
+    TestTunnels test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_tunnels.moc"
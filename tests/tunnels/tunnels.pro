@@ -0,0 +1,35 @@
+include(../tests.pri)
+
+# OpenVPN's status strings come from QApplication::tr()
+QT += network widgets
+
+TARGET = tst_tunnels
+
+SOURCES += \
+    tst_tunnels.cpp \
+    $$SRC/tunnelmanager.cpp \
+    $$SRC/reconnector.cpp \
+    $$SRC/netwatch.cpp \
+    $$SRC/statuspoller.cpp \
+    $$SRC/statussnapshot.cpp \
+    $$SRC/openvpn.cpp \
+    $$SRC/openvpnio.cpp \
+    $$SRC/logentry.cpp \
+    $$SRC/securebuffer.cpp
+
+HEADERS += \
+    $$SRC/tunnelmanager.h \
+    $$SRC/reconnector.h \
+    $$SRC/netwatch.h \
+    $$SRC/statuspoller.h \
+    $$SRC/statussnapshot.h \
+    $$SRC/openvpn.h \
+    $$SRC/openvpnio.h \
+    $$SRC/logentry.h \
+    $$SRC/securebuffer.h \
+    $$SRC/spscqueue.h
+
+# Crypto++
+LIBPATH += C:/CryptoPP/release
+INCLUDEPATH += C:/CryptoPP/include
+LIBS += -lcryptopp